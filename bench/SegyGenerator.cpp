@@ -0,0 +1,251 @@
+#include "SegyGenerator.hpp"
+#include "SegyReader.hpp"
+#include "SegyUtil.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+const int32_t kOriginX = 500000;
+const int32_t kOriginY = 6000000;
+const int32_t kBinSize = 25;
+
+struct TraceGeometry {
+    int32_t ffid, chan, cdp, source;
+    int32_t sou_x, sou_y, sou_elev;
+    int32_t rec_x, rec_y, rec_elev;
+    int32_t cdp_x, cdp_y, iline, xline;
+};
+
+// Рельеф: плавная функция координат, чтобы высоты повторялись для одной точки
+int32_t elevationAt(int32_t x, int32_t y) {
+    return 100 + static_cast<int32_t>(((x / 50) * 7 + (y / 50) * 13) % 41);
+}
+
+void setMidpoint(TraceGeometry& g) {
+    g.cdp_x = static_cast<int32_t>((static_cast<int64_t>(g.sou_x) + g.rec_x) / 2);
+    g.cdp_y = static_cast<int32_t>((static_cast<int64_t>(g.sou_y) + g.rec_y) / 2);
+    g.iline = (g.cdp_y - kOriginY) / kBinSize + 1;
+    g.xline = (g.cdp_x - kOriginX) / kBinSize + 1;
+    g.cdp = g.iline * 10000 + g.xline;
+}
+
+TraceGeometry line2D(uint64_t trace, int channels) {
+    const int32_t station_spacing = 25;
+    TraceGeometry g;
+    int64_t shot = static_cast<int64_t>(trace / channels);
+    int32_t chan = static_cast<int32_t>(trace % channels);
+    int64_t sou_station = channels / 2 + shot * 2;
+    int64_t rec_station = sou_station - channels / 2 + chan;
+    g.ffid = static_cast<int32_t>(shot + 1);
+    g.chan = chan + 1;
+    g.source = static_cast<int32_t>(sou_station);
+    g.sou_x = kOriginX + static_cast<int32_t>(sou_station * station_spacing);
+    g.sou_y = kOriginY;
+    g.rec_x = kOriginX + static_cast<int32_t>(rec_station * station_spacing);
+    g.rec_y = kOriginY;
+    g.sou_elev = elevationAt(g.sou_x, g.sou_y);
+    g.rec_elev = elevationAt(g.rec_x, g.rec_y);
+    g.cdp_x = (g.sou_x + g.rec_x) / 2;
+    g.cdp_y = kOriginY;
+    g.cdp = static_cast<int32_t>(sou_station + rec_station);
+    g.iline = 1;
+    g.xline = g.cdp;
+    return g;
+}
+
+TraceGeometry orthogonal3D(uint64_t trace, int channels) {
+    // Ортогональная система: линии приёма вдоль X через 200 м (ПП через 50 м),
+    // линии возбуждения вдоль Y через 300 м (ПВ через 50 м), шаблон 8 линий приёма
+    const int rec_lines_active = 8;
+    const int32_t rec_line_spacing = 200, rec_interval = 50;
+    const int32_t src_line_spacing = 300, src_interval = 50;
+    const int shots_per_line = 80;
+    const int channels_per_line = std::max(1, channels / rec_lines_active);
+    const int32_t margin = rec_lines_active * rec_line_spacing;
+
+    TraceGeometry g;
+    int64_t shot = static_cast<int64_t>(trace / channels);
+    int32_t chan = static_cast<int32_t>(trace % channels);
+    int64_t src_line = shot / shots_per_line;
+    int32_t src_point = static_cast<int32_t>(shot % shots_per_line);
+
+    g.ffid = static_cast<int32_t>(shot + 1);
+    g.chan = chan + 1;
+    g.source = static_cast<int32_t>(src_line * 1000 + src_point + 1);
+    g.sou_x = kOriginX + margin + static_cast<int32_t>(src_line * src_line_spacing);
+    g.sou_y = kOriginY + margin + src_point * src_interval;
+
+    int32_t line_in_patch = chan / channels_per_line;
+    int32_t chan_in_line = chan % channels_per_line;
+    int32_t nearest_line = (g.sou_y - kOriginY) / rec_line_spacing;
+    g.rec_y = kOriginY + (nearest_line - rec_lines_active / 2 + line_in_patch) * rec_line_spacing;
+    int32_t rec_station = (g.sou_x - kOriginX) / rec_interval - channels_per_line / 2 + chan_in_line;
+    g.rec_x = kOriginX + rec_station * rec_interval;
+
+    g.sou_elev = elevationAt(g.sou_x, g.sou_y);
+    g.rec_elev = elevationAt(g.rec_x, g.rec_y);
+    setMidpoint(g);
+    return g;
+}
+
+TraceGeometry randomGeometry(uint64_t trace, int channels, std::mt19937& rng, TraceGeometry& shot_state) {
+    const uint32_t extent = 20000;
+    TraceGeometry g = shot_state;
+    int32_t chan = static_cast<int32_t>(trace % channels);
+    if (chan == 0) {
+        g.ffid = static_cast<int32_t>(trace / channels + 1);
+        g.source = g.ffid;
+        g.sou_x = kOriginX + static_cast<int32_t>(rng() % extent);
+        g.sou_y = kOriginY + static_cast<int32_t>(rng() % extent);
+        g.sou_elev = elevationAt(g.sou_x, g.sou_y);
+        shot_state = g;
+    }
+    g.chan = chan + 1;
+    g.rec_x = kOriginX + static_cast<int32_t>(rng() % extent);
+    g.rec_y = kOriginY + static_cast<int32_t>(rng() % extent);
+    g.rec_elev = elevationAt(g.rec_x, g.rec_y);
+    setMidpoint(g);
+    return g;
+}
+
+void putField(uint8_t* header, const char* key, int32_t value) {
+    int offset = SegyReader::header_field_offset(key);
+    if (offset > 0) {
+        set_i32_be(header, offset, value);
+    }
+}
+
+void encodeSample(uint8_t* dst, int format_code, float value) {
+    switch (format_code) {
+        case 1: put_u32_be(dst, ieee_to_ibm(value)); break;
+        case 2: put_u32_be(dst, static_cast<uint32_t>(static_cast<int32_t>(value * 1000.0f))); break;
+        case 3: set_i16_be(dst, 1, static_cast<int16_t>(value * 1000.0f)); break;
+        case 5: {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            put_u32_be(dst, bits);
+            break;
+        }
+        case 8: dst[0] = static_cast<uint8_t>(static_cast<int8_t>(value * 100.0f)); break;
+        default: break; // остальные форматы заполняются нулями
+    }
+}
+
+} // namespace
+
+uint64_t tracesForFileSize(uint64_t target_bytes, int num_samples, int format_code) {
+    size_t sample_size = SegyReader::sample_size_for_format(format_code);
+    if (sample_size == 0) sample_size = 4;
+    uint64_t trace_size = 240 + static_cast<uint64_t>(num_samples) * sample_size;
+    if (target_bytes <= 3600 + trace_size) return 1;
+    return (target_bytes - 3600) / trace_size;
+}
+
+uint64_t writeSyntheticSegy(const std::string& path, const SegyGeneratorConfig& config) {
+    size_t sample_size = SegyReader::sample_size_for_format(config.format_code);
+    if (sample_size == 0) {
+        throw std::invalid_argument("Unsupported sample format code: " + std::to_string(config.format_code));
+    }
+    if (config.num_samples <= 0 || config.num_samples > 65535 || config.channels_per_shot <= 0) {
+        throw std::invalid_argument("Invalid synthetic SEG-Y configuration");
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot create file: " + path);
+    }
+
+    // Текстовый заголовок (ASCII, 40 строк по 80 символов)
+    std::string text(3200, ' ');
+    std::string line1 = std::string("C 1 SYNTHETIC SEG-Y ") + geometryName(config.geometry) +
+                        " SEED " + std::to_string(config.seed);
+    text.replace(0, line1.size(), line1);
+    out.write(text.data(), text.size());
+
+    std::vector<uint8_t> binary(400, 0);
+    set_i16_be(binary.data(), 17, static_cast<int16_t>(config.sample_interval_us));
+    set_i16_be(binary.data(), 21, static_cast<int16_t>(static_cast<uint16_t>(config.num_samples)));
+    set_i16_be(binary.data(), 25, static_cast<int16_t>(config.format_code));
+    out.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+
+    // Один затухающий импульс на все трассы; для каждой трассы сдвигается по времени
+    std::vector<float> wavelet(config.num_samples);
+    for (int i = 0; i < config.num_samples; ++i) {
+        double t = static_cast<double>(i) / config.num_samples;
+        wavelet[i] = static_cast<float>(std::sin(60.0 * t) * std::exp(-3.0 * t));
+    }
+
+    const size_t data_size = static_cast<size_t>(config.num_samples) * sample_size;
+    std::vector<uint8_t> trace(240 + data_size);
+    std::mt19937 rng(config.seed);
+    TraceGeometry shot_state = {};
+
+    for (uint64_t i = 0; i < config.num_traces; ++i) {
+        TraceGeometry g;
+        switch (config.geometry) {
+            case SyntheticGeometry::Line2D: g = line2D(i, config.channels_per_shot); break;
+            case SyntheticGeometry::Orthogonal3D: g = orthogonal3D(i, config.channels_per_shot); break;
+            default: g = randomGeometry(i, config.channels_per_shot, rng, shot_state); break;
+        }
+
+        std::fill(trace.begin(), trace.begin() + 240, 0);
+        uint8_t* header = trace.data();
+        putField(header, "FieldRecord", g.ffid);
+        putField(header, "TraceNumber", g.chan);
+        putField(header, "CDP", g.cdp);
+        putField(header, "EnergySourcePoint", g.source);
+        putField(header, "SourceX", g.sou_x);
+        putField(header, "SourceY", g.sou_y);
+        putField(header, "SourceElevation", g.sou_elev);
+        putField(header, "ReceiverX", g.rec_x);
+        putField(header, "ReceiverY", g.rec_y);
+        putField(header, "ReceiverElevation", g.rec_elev);
+        putField(header, "CDP_X", g.cdp_x);
+        putField(header, "CDP_Y", g.cdp_y);
+        putField(header, "ILINE_3D", g.iline);
+        putField(header, "CROSSLINE_3D", g.xline);
+        set_i16_be(header, 115, static_cast<int16_t>(static_cast<uint16_t>(config.num_samples)));
+        set_i16_be(header, 117, static_cast<int16_t>(config.sample_interval_us));
+
+        size_t shift = static_cast<size_t>(g.chan) % config.num_samples;
+        uint8_t* samples = trace.data() + 240;
+        for (int s = 0; s < config.num_samples; ++s) {
+            encodeSample(samples + s * sample_size, config.format_code,
+                         wavelet[(s + shift) % config.num_samples]);
+        }
+
+        out.write(reinterpret_cast<const char*>(trace.data()), trace.size());
+    }
+
+    if (!out) {
+        throw std::runtime_error("Failed to write file: " + path);
+    }
+    return 3600 + config.num_traces * trace.size();
+}
+
+bool parseGeometry(const std::string& name, SyntheticGeometry& geometry) {
+    if (name == "line" || name == "2d") {
+        geometry = SyntheticGeometry::Line2D;
+    } else if (name == "ortho" || name == "3d") {
+        geometry = SyntheticGeometry::Orthogonal3D;
+    } else if (name == "random") {
+        geometry = SyntheticGeometry::Random;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* geometryName(SyntheticGeometry geometry) {
+    switch (geometry) {
+        case SyntheticGeometry::Line2D: return "line";
+        case SyntheticGeometry::Orthogonal3D: return "ortho";
+        default: return "random";
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Геометрия синтетической съёмки
+enum class SyntheticGeometry {
+    Line2D,        // 2D профиль: пункты взрыва и приёма на одной линии
+    Orthogonal3D,  // 3D ортогональная система: линии приёма по X, линии возбуждения по Y
+    Random         // случайные источники и приёмники внутри прямоугольника
+};
+
+struct SegyGeneratorConfig {
+    uint64_t num_traces = 100000;
+    int num_samples = 1000;
+    int sample_interval_us = 2000;
+    int format_code = 1;               // код формата данных SEG-Y (1, 2, 3, 5, 8, ...)
+    int channels_per_shot = 480;
+    SyntheticGeometry geometry = SyntheticGeometry::Orthogonal3D;
+    uint32_t seed = 12345;
+};
+
+/**
+ * @brief Записывает воспроизводимый синтетический SEG-Y файл.
+ *
+ * Значения заголовков пишутся по тем же байтовым смещениям, которые читает
+ * SegyReader::get_header_value_i32, поэтому сканер видит согласованную геометрию
+ * (FFID, каналы, координаты источников/приёмников, CDP и inline/crossline).
+ * Одинаковая конфигурация всегда даёт побайтно одинаковый файл.
+ * @return Размер записанного файла в байтах.
+ */
+uint64_t writeSyntheticSegy(const std::string& path, const SegyGeneratorConfig& config);
+
+// Количество трасс, при котором файл имеет размер около target_bytes
+uint64_t tracesForFileSize(uint64_t target_bytes, int num_samples, int format_code);
+
+bool parseGeometry(const std::string& name, SyntheticGeometry& geometry);
+const char* geometryName(SyntheticGeometry geometry);
@@ -0,0 +1,430 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "segyscanner.h"
+#include "maptiles.h"
+#include "scanarena.h"
+#include "segyread/Kernels.hpp"
+#include "SegyGenerator.hpp"
+
+namespace {
+
+struct BenchConfig {
+    std::string mode = "all";          // micro, e2e, all
+    std::string work_dir = "scansegy_bench_data";
+    SegyGeneratorConfig generator;
+    uint64_t size_mb = 0;              // если задан, определяет количество трасс
+    int files = 4;                     // количество файлов для end-to-end режима
+    int repeat = 3;
+    bool keep = false;
+};
+
+struct BenchResult {
+    std::string name;
+    double seconds;
+    uint64_t traces;
+    uint64_t bytes;
+};
+
+std::vector<BenchResult> results;
+
+// Лучшее время из config.repeat запусков
+double timeBest(int repeat, const std::function<void()>& body) {
+    double best = 0.0;
+    for (int r = 0; r < repeat; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (r == 0 || elapsed < best) best = elapsed;
+    }
+    return best;
+}
+
+void record(const std::string& name, double seconds, uint64_t traces, uint64_t bytes) {
+    results.push_back({name, seconds, traces, bytes});
+}
+
+void printResults() {
+    std::cout << std::endl
+              << std::left << std::setw(28) << "benchmark"
+              << std::right << std::setw(12) << "time_s"
+              << std::setw(16) << "traces/s"
+              << std::setw(12) << "MB/s" << std::endl;
+    for (const auto& r : results) {
+        double secs = std::max(r.seconds, 1e-9);
+        std::cout << std::left << std::setw(28) << r.name
+                  << std::right << std::fixed << std::setprecision(4) << std::setw(12) << r.seconds
+                  << std::setprecision(0) << std::setw(16) << (r.traces / secs)
+                  << std::setprecision(1) << std::setw(12) << (r.bytes / secs / (1024.0 * 1024.0))
+                  << std::endl;
+    }
+}
+
+void printUsage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --mode <micro|e2e|all>     Benchmarks to run (default: all)" << std::endl;
+    std::cout << "  --traces <N>               Traces per generated file (default: 100000)" << std::endl;
+    std::cout << "  --size-mb <N>              Target file size in MB (overrides --traces)" << std::endl;
+    std::cout << "  --samples <N>              Samples per trace (default: 1000)" << std::endl;
+    std::cout << "  --format <N>               SEG-Y sample format code: 1, 2, 3, 5, 8 (default: 1)" << std::endl;
+    std::cout << "  --geometry <line|ortho|random>  Survey geometry (default: ortho)" << std::endl;
+    std::cout << "  --channels <N>             Channels per shot (default: 480)" << std::endl;
+    std::cout << "  --seed <N>                 Generator seed (default: 12345)" << std::endl;
+    std::cout << "  --files <N>                Files for end-to-end mode (default: 4)" << std::endl;
+    std::cout << "  --repeat <N>               Repetitions per microbenchmark, best is reported (default: 3)" << std::endl;
+    std::cout << "  --dir <path>               Working directory; files go to a new run_<N> subdirectory" << std::endl;
+    std::cout << "                             (default: scansegy_bench_data)" << std::endl;
+    std::cout << "  --keep                     Keep generated files" << std::endl;
+    std::cout << "  -h, --help                 Show this help message" << std::endl;
+}
+
+} // namespace
+
+// Доступ к приватным стадиям SegyScanner для микробенчмарков
+class SegyScannerBench {
+public:
+    static void runMicro(const BenchConfig& config) {
+        namespace fs = std::filesystem;
+        fs::create_directories(config.work_dir);
+        std::string path = config.work_dir + "/micro.sgy";
+
+        uint64_t file_bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        file_bytes = writeSyntheticSegy(path, config.generator);
+        double gen_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        record("generate", gen_time, config.generator.num_traces, file_bytes);
+
+        const uint64_t traces = config.generator.num_traces;
+
+        // Чтение заголовков с диска
+        double t = timeBest(config.repeat, [&]() { SegyReader reader(path); });
+        record("header_read", t, traces, file_bytes);
+
+        SegyReaderOptions direct;
+        direct.direct_io = true;
+        bool direct_active = false;
+        t = timeBest(config.repeat, [&]() { direct_active = SegyReader(path, direct).direct_io_active(); });
+        record(direct_active ? "header_read_direct" : "header_read_direct(fallback)", t, traces, file_bytes);
+
+        // Произвольный доступ к трассам: открытие без заголовков, холодный и повторный проход
+        {
+            SegyReaderOptions lazy;
+            lazy.read_headers = false;
+            SegyReader random_reader(path, lazy);
+            const size_t count = std::min<size_t>(random_reader.num_traces(), 10000);
+            std::vector<size_t> order(count);
+            uint64_t state = config.generator.seed;
+            for (auto& index : order) {
+                state = state * 6364136223846793005ull + 1442695040888963407ull;
+                index = static_cast<size_t>((state >> 33) % random_reader.num_traces());
+            }
+            const uint64_t trace_bytes = random_reader.num_samples() * random_reader.bytes_per_sample();
+            auto start_random = std::chrono::steady_clock::now();
+            for (size_t index : order) random_reader.getTrace(index);
+            double cold = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_random).count();
+            record("trace_random", cold, count, count * trace_bytes);
+            t = timeBest(config.repeat, [&]() {
+                for (size_t index : order) random_reader.getTrace(index);
+            });
+            record("trace_random_cached", t, count, count * trace_bytes);
+            TraceCacheStats stats = random_reader.trace_cache_stats();
+            std::cout << "Trace cache: " << stats.hits << " hits, " << stats.misses << " misses ("
+                      << std::fixed << std::setprecision(1) << stats.hit_rate() * 100.0 << "% hit rate), "
+                      << stats.cached_traces << " traces cached" << std::endl;
+        }
+        
+        // Преобразование сэмплов IBM float ядром, выбранным по cpuid
+        std::cout << "Kernels: " << segyKernels().isa << std::endl;
+        {
+            const size_t num_samples = size_t(1) << 22;
+            std::vector<uint8_t> ibm(num_samples * 4);
+            uint32_t state = static_cast<uint32_t>(config.generator.seed);
+            for (auto& byte : ibm) {
+                state = state * 1664525u + 1013904223u;
+                byte = static_cast<uint8_t>(state >> 24);
+            }
+            std::vector<float> samples(num_samples);
+            t = timeBest(config.repeat, [&]() { segyKernels().ibm_to_float(ibm.data(), samples.data(), num_samples); });
+            record("ibm_to_float", t, num_samples, ibm.size());
+        }
+
+        // Декодирование полей из уже прочитанных заголовков
+        SegyReader reader(path);
+        std::vector<TraceData> rows;
+        t = timeBest(config.repeat, [&]() { rows = decodeTraceHeaders(reader); });
+        record("field_decode", t, traces, traces * 240);
+
+        const uint64_t row_bytes = rows.size() * sizeof(TraceData);
+        t = timeBest(config.repeat, [&]() { computeHeaderRanges(rows); });
+        record("calculateRanges", t, rows.size(), row_bytes);
+
+        // Точные счетчики или HyperLogLog и t-digest по всем 14 полям
+        SketchMap sketches;
+        t = timeBest(config.repeat, [&]() {
+            sketches.clear();
+            sketchColumns(reinterpret_cast<const int32_t*>(rows.data()), rows.size(),
+                          HeaderColumns::kBuiltinColumns, rangeFieldNames(), sketches);
+        });
+        record("field_sketches", t, rows.size(), row_bytes);
+
+        GatherSegmentation segmentation;
+        t = timeBest(config.repeat, [&]() { segmentation = segmentGathers(rows); });
+        record("segment_gathers", t, rows.size(), row_bytes);
+
+        std::vector<SourceInfo> sources;
+        t = timeBest(config.repeat, [&]() { sources = uniqueSources(rows); });
+        record("dedupe_sou", t, rows.size(), row_bytes);
+
+        std::vector<ReceiverInfo> receivers;
+        t = timeBest(config.repeat, [&]() { receivers = uniqueReceivers(rows); });
+        record("dedupe_rec", t, rows.size(), row_bytes);
+
+        // То же с картой в арене файла, как в scanSegyFile
+        uint64_t arena_heap_calls = 0;
+        t = timeBest(config.repeat, [&]() {
+            ScanArena arena;
+            receivers = uniqueReceivers(rows, arena.resource());
+            arena_heap_calls = arena.heap_allocations();
+        });
+        record("dedupe_rec_arena", t, rows.size(), row_bytes);
+        std::cout << "Receiver map arena: " << arena_heap_calls << " heap allocations for "
+                  << receivers.size() << " receivers" << std::endl;
+
+        std::vector<CdpInfo> cdps;
+        t = timeBest(config.repeat, [&]() { cdps = uniqueCdps(rows); });
+        record("dedupe_cdp", t, rows.size(), row_bytes);
+
+        // Пирамида тайлов карт по уникальным позициям
+        std::vector<TileSource> tile_sources(3);
+        tile_sources[0].name = "sou";
+        for (const auto& s : sources) tile_sources[0].positions.push_back({s.sou_x, s.sou_y});
+        tile_sources[1].name = "rec";
+        for (const auto& r : receivers) tile_sources[1].positions.push_back({r.rec_x, r.rec_y});
+        tile_sources[2].name = "cdp";
+        for (const auto& c : cdps) tile_sources[2].positions.push_back({c.cdp_x, c.cdp_y});
+        const uint64_t positions = sources.size() + receivers.size() + cdps.size();
+        t = timeBest(config.repeat, [&]() { buildTilePyramid(tile_sources); });
+        record("build_tiles", t, positions, positions * sizeof(Coord));
+
+        // Сжатые столбцы заголовков: кодирование, декодирование и операторы по блокам
+        HeaderColumns columns;
+        t = timeBest(config.repeat, [&]() { columns = HeaderColumns(rows); });
+        record("columns_encode", t, rows.size(), row_bytes);
+        std::cout << "Header columns: " << row_bytes / (1024 * 1024) << " MB raw, "
+                  << columns.memoryBytes() / (1024 * 1024) << " MB compressed ("
+                  << std::fixed << std::setprecision(1)
+                  << static_cast<double>(row_bytes) / std::max<size_t>(columns.memoryBytes(), 1) << "x)" << std::endl;
+
+        t = timeBest(config.repeat, [&]() { columns.decode(); });
+        record("columns_decode", t, rows.size(), row_bytes);
+
+        t = timeBest(config.repeat, [&]() { computeHeaderRanges(columns); });
+        record("calculateRanges_columns", t, rows.size(), row_bytes);
+
+        t = timeBest(config.repeat, [&]() { uniqueSources(columns); });
+        record("dedupe_sou_columns", t, rows.size(), row_bytes);
+
+        t = timeBest(config.repeat, [&]() { uniqueReceivers(columns); });
+        record("dedupe_rec_columns", t, rows.size(), row_bytes);
+
+        t = timeBest(config.repeat, [&]() { uniqueCdps(columns); });
+        record("dedupe_cdp_columns", t, rows.size(), row_bytes);
+
+        // Поиск дубликатов трасс: отпечатки заголовков и проход по хеш-множеству
+        TraceFingerprints fingerprints;
+        t = timeBest(config.repeat, [&]() { fingerprints = fingerprintTraces(rows, {}); });
+        record("fingerprints", t, rows.size(), row_bytes);
+
+        t = timeBest(config.repeat, [&]() { findDuplicates({{&fingerprints, &columns}}); });
+        record("find_duplicates", t, rows.size(), rows.size() * sizeof(uint64_t));
+
+        // Выборка 10% трасс по FFID и копирование их в новый SEG-Y файл в ядре
+        {
+            const int32_t first_ffid = rows.front().ffid;
+            const int32_t last_ffid = rows.back().ffid;
+            const std::vector<IndexPredicate> predicates = {
+                {"FFID", first_ffid, first_ffid + (last_ffid - first_ffid) / 10}};
+            std::vector<TraceRange> ranges;
+            t = timeBest(config.repeat, [&]() { ranges = selectTraceRanges(columns, rangeFieldNames(), predicates); });
+            record("extract_select", t, rows.size(), row_bytes);
+
+            ExtractStats stats;
+            t = timeBest(config.repeat, [&]() {
+                SegyExtractWriter writer(config.work_dir + "/micro_extract.sgy");
+                writer.append(path, ranges);
+                writer.commit();
+                stats = writer.stats();
+            });
+            record("extract_copy", t, stats.traces, stats.bytes);
+            std::cout << "Extract: " << stats.traces << " traces in " << stats.runs << " runs ("
+                      << stats.method << ")" << std::endl;
+        }
+
+        SegyScanner scanner;
+        const std::string filename = "micro";
+        const std::string tables_dir = config.work_dir + "/tables";
+        fs::create_directories(tables_dir);
+
+        t = timeBest(config.repeat, [&]() { scanner.generateSourceTable(tables_dir, filename, sources); });
+        record("generateSourceTable", t, sources.size(), fs::file_size(tables_dir + "/micro_sou.txt"));
+
+        t = timeBest(config.repeat, [&]() { scanner.generateReceiverTable(tables_dir, filename, receivers); });
+        record("generateReceiverTable", t, receivers.size(), fs::file_size(tables_dir + "/micro_rec.txt"));
+
+        t = timeBest(config.repeat, [&]() { scanner.generateCdpTable(tables_dir, filename, cdps); });
+        record("generateCdpTable", t, cdps.size(), fs::file_size(tables_dir + "/micro_cdp.txt"));
+
+        scanner.all_file_info_[filename] = makeFileInfo(path, reader);
+        scanner.header_ranges_[filename] = computeHeaderRanges(rows);
+        std::vector<std::string> processed = {filename};
+        t = timeBest(config.repeat, [&]() {
+            scanner.generateInfoTable(tables_dir, processed);
+            scanner.generateRangesTable(tables_dir, processed);
+        });
+        uint64_t table_bytes = fs::file_size(tables_dir + "/info.txt") + fs::file_size(tables_dir + "/ranges.txt");
+        record("info_ranges_tables", t, rows.size(), table_bytes);
+    }
+
+    static void runEndToEnd(const BenchConfig& config) {
+        namespace fs = std::filesystem;
+        std::string dir = config.work_dir + "/e2e";
+        fs::create_directories(dir);
+
+        uint64_t total_bytes = 0;
+        for (int i = 0; i < config.files; ++i) {
+            SegyGeneratorConfig file_config = config.generator;
+            file_config.seed = config.generator.seed + i;
+            total_bytes += writeSyntheticSegy(dir + "/survey_" + std::to_string(i) + ".sgy", file_config);
+        }
+        const uint64_t total_traces = config.generator.num_traces * config.files;
+
+        double t = timeBest(config.repeat, [&]() {
+            SegyScanner scanner;
+            if (scanner.process(dir) != 0) {
+                throw std::runtime_error("SegyScanner::process failed on " + dir);
+            }
+        });
+        record("end_to_end(" + std::to_string(config.files) + " files)", t, total_traces, total_bytes);
+    }
+};
+
+int main(int argc, char* argv[]) {
+    BenchConfig config;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for option: " + arg);
+            }
+            return argv[++i];
+        };
+
+        try {
+            if (arg == "-h" || arg == "--help") {
+                printUsage(argv[0]);
+                return 0;
+            } else if (arg == "--mode") {
+                config.mode = next();
+            } else if (arg == "--traces") {
+                config.generator.num_traces = std::stoull(next());
+            } else if (arg == "--size-mb") {
+                config.size_mb = std::stoull(next());
+            } else if (arg == "--samples") {
+                config.generator.num_samples = std::stoi(next());
+            } else if (arg == "--format") {
+                config.generator.format_code = std::stoi(next());
+            } else if (arg == "--geometry") {
+                if (!parseGeometry(next(), config.generator.geometry)) {
+                    throw std::invalid_argument("Unknown geometry: " + std::string(argv[i]));
+                }
+            } else if (arg == "--channels") {
+                config.generator.channels_per_shot = std::stoi(next());
+            } else if (arg == "--seed") {
+                config.generator.seed = static_cast<uint32_t>(std::stoul(next()));
+            } else if (arg == "--files") {
+                config.files = std::stoi(next());
+            } else if (arg == "--repeat") {
+                config.repeat = std::max(1, std::stoi(next()));
+            } else if (arg == "--dir") {
+                config.work_dir = next();
+            } else if (arg == "--keep") {
+                config.keep = true;
+            } else {
+                std::cerr << "Error: Unknown option: " << arg << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (config.mode != "micro" && config.mode != "e2e" && config.mode != "all") {
+        std::cerr << "Error: Unknown mode: " << config.mode << std::endl;
+        return 1;
+    }
+
+    if (config.size_mb > 0) {
+        config.generator.num_traces = tracesForFileSize(config.size_mb * 1024 * 1024,
+                                                        config.generator.num_samples,
+                                                        config.generator.format_code);
+    }
+
+    // Файлы пишутся в новый подкаталог run_<N>, и удаляется только он: --dir может
+    // указывать на каталог с чужими данными
+    namespace fs = std::filesystem;
+    const std::string base_dir = config.work_dir;
+    std::error_code ec;
+    const bool created_base = !fs::exists(base_dir, ec);
+    try {
+        fs::create_directories(base_dir);
+        for (int run = 1;; ++run) {
+            config.work_dir = base_dir + "/run_" + std::to_string(run);
+            if (fs::create_directory(config.work_dir)) break;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    auto cleanup = [&]() {
+        if (config.keep) {
+            std::cout << "Generated files kept in " << config.work_dir << std::endl;
+            return;
+        }
+        fs::remove_all(config.work_dir, ec);
+        // Каталог --dir удаляется, только если его создал бенчмарк и он пуст
+        if (created_base) fs::remove(base_dir, ec);
+    };
+
+    std::cout << "Synthetic SEG-Y: " << config.generator.num_traces << " traces, "
+              << config.generator.num_samples << " samples, format " << config.generator.format_code
+              << ", geometry " << geometryName(config.generator.geometry)
+              << ", seed " << config.generator.seed << std::endl;
+
+    try {
+        if (config.mode == "micro" || config.mode == "all") {
+            SegyScannerBench::runMicro(config);
+        }
+        if (config.mode == "e2e" || config.mode == "all") {
+            SegyScannerBench::runEndToEnd(config);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        cleanup();
+        return 1;
+    }
+
+    printResults();
+    cleanup();
+    return 0;
+}
@@ -80,6 +80,8 @@ struct CdpInfo {
     int32_t cdp;
     int32_t cdp_x;
     int32_t cdp_y;
+    int32_t iline;
+    int32_t xline;
     
     bool operator<(const CdpInfo& other) const {
         // Для уникальности CDP сравниваем только координаты (X, Y)
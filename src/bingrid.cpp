@@ -0,0 +1,183 @@
+#include "bingrid.h"
+#include "segyscan.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace {
+
+const double kRadToDeg = 57.29577951308232;
+
+// Dense arrays are used only while the il/xl rectangle stays in proportion to the data
+const uint64_t kMaxDenseCells = 1ull << 25;
+const uint64_t kMinDenseBudget = 1ull << 20;
+
+double azimuthDegrees(double dx, double dy) {
+    double az = std::atan2(dx, dy) * kRadToDeg;
+    return az < 0.0 ? az + 360.0 : az;
+}
+
+void foldStats(BinGrid& grid, uint32_t fold) {
+    if (fold == 0) return;
+    if (grid.cells_occupied == 0) {
+        grid.fold_min = grid.fold_max = fold;
+    } else {
+        grid.fold_min = std::min(grid.fold_min, fold);
+        grid.fold_max = std::max(grid.fold_max, fold);
+    }
+    grid.cells_occupied++;
+    if (grid.fold_histogram.size() <= fold) grid.fold_histogram.resize(fold + 1, 0);
+    grid.fold_histogram[fold]++;
+}
+
+// Least-squares fit of x, y as linear functions of (iline, xline)
+void fitGrid(const std::vector<TraceData>& traces, BinGrid& grid) {
+    const double n = static_cast<double>(traces.size());
+    double mean_il = 0.0, mean_xl = 0.0, mean_x = 0.0, mean_y = 0.0;
+    for (const auto& t : traces) {
+        mean_il += t.iline;
+        mean_xl += t.xline;
+        mean_x += t.cdp_x;
+        mean_y += t.cdp_y;
+    }
+    mean_il /= n; mean_xl /= n; mean_x /= n; mean_y /= n;
+
+    double s_ii = 0.0, s_ij = 0.0, s_jj = 0.0, s_ix = 0.0, s_jx = 0.0, s_iy = 0.0, s_jy = 0.0;
+    for (const auto& t : traces) {
+        double i = t.iline - mean_il;
+        double j = t.xline - mean_xl;
+        double x = t.cdp_x - mean_x;
+        double y = t.cdp_y - mean_y;
+        s_ii += i * i; s_ij += i * j; s_jj += j * j;
+        s_ix += i * x; s_jx += j * x;
+        s_iy += i * y; s_jy += j * y;
+    }
+
+    double det = s_ii * s_jj - s_ij * s_ij;
+    if (!(det > 1e-9 * s_ii * s_jj)) return; // inline and crossline are collinear
+
+    grid.il_dx = (s_ix * s_jj - s_jx * s_ij) / det;
+    grid.xl_dx = (s_jx * s_ii - s_ix * s_ij) / det;
+    grid.il_dy = (s_iy * s_jj - s_jy * s_ij) / det;
+    grid.xl_dy = (s_jy * s_ii - s_iy * s_ij) / det;
+    grid.origin_x = mean_x + grid.il_dx * (grid.il_min - mean_il) + grid.xl_dx * (grid.xl_min - mean_xl);
+    grid.origin_y = mean_y + grid.il_dy * (grid.il_min - mean_il) + grid.xl_dy * (grid.xl_min - mean_xl);
+
+    grid.il_spacing = std::hypot(grid.il_dx, grid.il_dy);
+    grid.xl_spacing = std::hypot(grid.xl_dx, grid.xl_dy);
+    grid.inline_azimuth = azimuthDegrees(grid.xl_dx, grid.xl_dy);
+    grid.crossline_azimuth = azimuthDegrees(grid.il_dx, grid.il_dy);
+
+    double sum_sq = 0.0, max_sq = 0.0;
+    for (const auto& t : traces) {
+        double di = t.iline - grid.il_min;
+        double dj = t.xline - grid.xl_min;
+        double ex = t.cdp_x - (grid.origin_x + grid.il_dx * di + grid.xl_dx * dj);
+        double ey = t.cdp_y - (grid.origin_y + grid.il_dy * di + grid.xl_dy * dj);
+        double sq = ex * ex + ey * ey;
+        sum_sq += sq;
+        max_sq = std::max(max_sq, sq);
+    }
+    grid.rms_residual = std::sqrt(sum_sq / n);
+    grid.max_residual = std::sqrt(max_sq);
+    grid.valid = true;
+
+    // Integer coordinates put up to ~0.7 units of rounding into the residuals.
+    // Cells must also be far enough apart that neighbours cannot share a position.
+    double tolerance = std::max(1.5, 0.05 * std::min(grid.il_spacing, grid.xl_spacing));
+    grid.regular = grid.max_residual <= tolerance &&
+                   std::min(grid.il_spacing, grid.xl_spacing) > 2.0 * tolerance;
+}
+
+// Coverage through an (iline, xline) -> fold hash when the grid is irregular or too sparse
+void hashedCoverage(const std::vector<TraceData>& traces, BinGrid& grid, std::pmr::memory_resource* memory) {
+    std::pmr::unordered_map<uint64_t, uint32_t> fold(memory);
+    fold.reserve(traces.size() / 4 + 1);
+    for (const auto& t : traces) {
+        uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(t.iline)) << 32) | static_cast<uint32_t>(t.xline);
+        fold[key]++;
+    }
+    for (const auto& cell : fold) {
+        foldStats(grid, cell.second);
+    }
+}
+
+} // namespace
+
+BinGrid analyzeBinGrid(const std::vector<TraceData>& traces, std::vector<CdpInfo>* cdps,
+                       std::pmr::memory_resource* memory) {
+    BinGrid grid;
+    grid.num_traces = traces.size();
+    if (traces.empty()) {
+        if (cdps) cdps->clear();
+        return grid;
+    }
+
+    grid.il_min = grid.il_max = traces[0].iline;
+    grid.xl_min = grid.xl_max = traces[0].xline;
+    for (const auto& t : traces) {
+        grid.il_min = std::min(grid.il_min, t.iline);
+        grid.il_max = std::max(grid.il_max, t.iline);
+        grid.xl_min = std::min(grid.xl_min, t.xline);
+        grid.xl_max = std::max(grid.xl_max, t.xline);
+    }
+    const uint64_t num_il = static_cast<uint64_t>(static_cast<int64_t>(grid.il_max) - grid.il_min) + 1;
+    const uint64_t num_xl = static_cast<uint64_t>(static_cast<int64_t>(grid.xl_max) - grid.xl_min) + 1;
+    grid.cells_total = num_il * num_xl;
+
+    if (num_il > 1 && num_xl > 1) {
+        fitGrid(traces, grid);
+    }
+    if (!grid.valid) {
+        if (cdps) *cdps = uniqueCdps(traces, memory);
+        return grid;
+    }
+
+    const uint64_t budget = std::min(kMaxDenseCells, std::max(kMinDenseBudget, 4 * grid.num_traces));
+    if (!grid.regular || grid.cells_total > budget) {
+        hashedCoverage(traces, grid, memory);
+        if (cdps) *cdps = uniqueCdps(traces, memory);
+        return grid;
+    }
+
+    // Regular grid: fold and first CDP per cell are plain array writes
+    grid.dense = true;
+    std::vector<uint32_t> fold(grid.cells_total, 0);
+    std::vector<CdpInfo> first;
+    if (cdps) first.resize(grid.cells_total);
+    bool single_position = true;
+
+    for (const auto& t : traces) {
+        size_t cell = static_cast<size_t>(t.iline - grid.il_min) * num_xl + static_cast<size_t>(t.xline - grid.xl_min);
+        if (cdps) {
+            if (fold[cell] == 0) {
+                first[cell] = CdpInfo{t.cdp, t.cdp_x, t.cdp_y, t.iline, t.xline};
+            } else if (first[cell].cdp_x != t.cdp_x || first[cell].cdp_y != t.cdp_y) {
+                single_position = false;
+            }
+        }
+        fold[cell]++;
+    }
+    for (uint32_t f : fold) {
+        foldStats(grid, f);
+    }
+
+    if (cdps) {
+        cdps->clear();
+        if (single_position) {
+            cdps->reserve(grid.cells_occupied);
+            for (size_t cell = 0; cell < fold.size(); ++cell) {
+                if (fold[cell] > 0) cdps->push_back(first[cell]);
+            }
+            std::sort(cdps->begin(), cdps->end());
+            // Positions must be unique across cells too, otherwise the coordinate dedupe decides
+            for (size_t i = 1; i < cdps->size() && single_position; ++i) {
+                if (!((*cdps)[i - 1] < (*cdps)[i])) single_position = false;
+            }
+        }
+        if (!single_position) {
+            *cdps = uniqueCdps(traces, memory);
+        }
+    }
+    return grid;
+}
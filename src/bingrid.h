@@ -0,0 +1,51 @@
+#ifndef BINGRID_H
+#define BINGRID_H
+
+// 3D bin grid inference from the decoded ILINE/XLINE and CDP_X/Y columns.
+// A least-squares fit of (iline, xline) -> (x, y) gives origin, spacing and
+// azimuths; when it is regular, coverage/fold and CDP dedupe use a dense
+// (iline, xline) array instead of coordinate maps.
+
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+#include "basetypes.h"
+
+struct TraceData;
+
+struct BinGrid {
+    bool valid = false;     // both inline and crossline vary and the fit is not degenerate
+    bool regular = false;   // residuals small enough for (iline, xline) addressing
+    bool dense = false;     // coverage and CDPs were computed through the dense array
+
+    int32_t il_min = 0, il_max = 0;
+    int32_t xl_min = 0, xl_max = 0;
+
+    // x = origin_x + il_dx * (il - il_min) + xl_dx * (xl - xl_min), same for y
+    double origin_x = 0.0, origin_y = 0.0;
+    double il_dx = 0.0, il_dy = 0.0;   // coordinate step per inline number
+    double xl_dx = 0.0, xl_dy = 0.0;   // coordinate step per crossline number
+    double il_spacing = 0.0;           // distance between adjacent inlines
+    double xl_spacing = 0.0;           // distance between adjacent crosslines
+    double inline_azimuth = 0.0;       // direction along an inline (increasing XLINE), degrees from +Y
+    double crossline_azimuth = 0.0;    // direction along a crossline (increasing ILINE), degrees from +Y
+    double rms_residual = 0.0;
+    double max_residual = 0.0;
+
+    // Coverage of the il/xl rectangle
+    uint64_t num_traces = 0;
+    uint64_t cells_total = 0;
+    uint64_t cells_occupied = 0;
+    uint32_t fold_min = 0;
+    uint32_t fold_max = 0;
+    std::vector<uint64_t> fold_histogram;  // index: fold, value: number of occupied cells
+};
+
+// Fits the grid and computes coverage. When cdps is not null it is filled with the
+// same result as uniqueCdps(traces): through the dense array when the grid is
+// regular and every cell has a single CDP position, otherwise through uniqueCdps.
+// memory holds the temporary coverage hash and CDP map.
+BinGrid analyzeBinGrid(const std::vector<TraceData>& traces, std::vector<CdpInfo>* cdps = nullptr,
+                       std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+#endif // BINGRID_H
@@ -0,0 +1,189 @@
+#include "discovery.h"
+#include "segyread/CompressedInput.hpp"
+#include "segyread/SegyReader.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Directory listing and header sniffing wait on metadata/network latency rather than CPU
+const unsigned kDefaultIoThreads = 16;
+
+} // namespace
+
+bool hasSegyExtension(const std::string& filepath) {
+    // "a.sgy.gz" / "a.segy.zst" are scanned through a decompressor
+    std::string ext = fs::path(stripCompressionExtension(filepath)).extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == ".sgy" || ext == ".segy";
+}
+
+bool sniffSegyFile(const std::string& filepath, bool strict, std::string* reason) {
+    auto reject = [reason](const std::string& why) {
+        if (reason) *reason = why;
+        return false;
+    };
+
+    std::error_code ec;
+    uint64_t file_size = fs::file_size(filepath, ec);
+    if (ec) return reject("cannot read file size");
+
+    unsigned char binary_header[400];
+    Compression compression = detectCompression(filepath);
+    if (compression != Compression::None) {
+        if (!isCompressionSupported(compression)) {
+            return reject(std::string("built without ") + compressionName(compression) + " support");
+        }
+        try {
+            auto input = openCompressedInput(filepath, compression, 1);
+            if (input->skip(3200) != 3200 ||
+                input->read(reinterpret_cast<char*>(binary_header), sizeof(binary_header)) != sizeof(binary_header)) {
+                return reject("shorter than the SEG-Y file headers");
+            }
+        } catch (const std::exception& e) {
+            return reject(e.what());
+        }
+    } else {
+        if (file_size <= 3600) return reject("shorter than the SEG-Y file headers");
+        std::ifstream file(filepath, std::ios::binary);
+        file.seekg(3200);
+        file.read(reinterpret_cast<char*>(binary_header), sizeof(binary_header));
+        if (file.gcount() != static_cast<std::streamsize>(sizeof(binary_header))) {
+            return reject("cannot read binary header");
+        }
+    }
+
+    SegyLayout layout;
+    try {
+        layout = SegyReader::parse_layout(reinterpret_cast<const char*>(binary_header));
+    } catch (const std::exception& e) {
+        return reject(e.what());
+    }
+    if (strict && SegyReader::sample_size_for_format(layout.format_code) == 0) {
+        return reject("unknown data sample format code " + std::to_string(layout.format_code));
+    }
+
+    // Для сжатых файлов размер распакованных данных заранее неизвестен; при переменном
+    // числе расширенных текстовых заголовков неизвестно смещение первой трассы
+    if (compression == Compression::None && layout.data_offset != 0) {
+        const uint64_t count = layout.countTraces(file_size);
+        if (count == 0) return reject("smaller than one trace");
+        if (strict && layout.declared_traces == 0 && layout.trailer_records == 0 &&
+            (file_size - layout.data_offset) % layout.traceSize() != 0) {
+            return reject("size is not a whole number of traces");
+        }
+    }
+    return true;
+}
+
+std::vector<std::string> discoverSegyFiles(const std::string& root, const DiscoveryOptions& options,
+                                           std::vector<std::pair<std::string, std::string>>* rejected) {
+    std::vector<std::string> candidates;
+
+    if (fs::is_regular_file(root)) {
+        candidates.push_back(root);
+    } else if (fs::is_directory(root)) {
+        std::vector<fs::path> skip_dirs;
+        for (const auto& dir : options.skip_dirs) {
+            skip_dirs.push_back(fs::path(dir).lexically_normal());
+        }
+
+        // Параллельный обход: общая очередь каталогов, рабочие потоки берут каталог,
+        // добавляют найденные подкаталоги в очередь и файлы-кандидаты в список
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<fs::path> queue = {fs::path(root)};
+        size_t active = 0;
+
+        auto worker = [&]() {
+            for (;;) {
+                fs::path dir;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [&] { return !queue.empty() || active == 0; });
+                    if (queue.empty()) return;
+                    dir = std::move(queue.front());
+                    queue.pop_front();
+                    ++active;
+                }
+
+                std::vector<fs::path> subdirs;
+                std::vector<std::string> files;
+                std::error_code ec;
+                for (fs::directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec), end;
+                     !ec && it != end; it.increment(ec)) {
+                    std::error_code status_ec;
+                    // Символические ссылки на каталоги не обходим (возможны циклы)
+                    fs::file_status status = it->symlink_status(status_ec);
+                    if (fs::is_symlink(status)) status = it->status(status_ec);
+                    if (status_ec) continue;
+
+                    if (fs::is_directory(status) && !fs::is_symlink(it->symlink_status(status_ec))) {
+                        fs::path normal = it->path().lexically_normal();
+                        if (options.recursive && std::find(skip_dirs.begin(), skip_dirs.end(), normal) == skip_dirs.end()) {
+                            subdirs.push_back(it->path());
+                        }
+                    } else if (fs::is_regular_file(status)) {
+                        std::string path = it->path().string();
+                        if (options.any_extension || hasSegyExtension(path)) {
+                            files.push_back(std::move(path));
+                        }
+                    }
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    queue.insert(queue.end(), subdirs.begin(), subdirs.end());
+                    candidates.insert(candidates.end(), files.begin(), files.end());
+                    --active;
+                }
+                cv.notify_all();
+            }
+        };
+
+        unsigned num_walkers = options.recursive ? (options.threads > 0 ? options.threads : kDefaultIoThreads) : 1;
+        std::vector<std::thread> walkers;
+        for (unsigned i = 1; i < num_walkers; ++i) {
+            walkers.emplace_back(worker);
+        }
+        worker();
+        for (auto& walker : walkers) {
+            walker.join();
+        }
+    } else {
+        throw std::runtime_error("Input path does not exist: " + root);
+    }
+
+    // Сниффинг заголовков параллельно: на сетевых ФС время уходит на открытие и чтение
+    std::vector<char> accepted(candidates.size(), 0);
+    std::vector<std::string> reasons(candidates.size());
+    int num_sniffers = static_cast<int>(options.threads > 0 ? options.threads : kDefaultIoThreads);
+    #pragma omp parallel for num_threads(num_sniffers) schedule(dynamic, 16) if (candidates.size() > 16)
+    for (long i = 0; i < static_cast<long>(candidates.size()); ++i) {
+        // Файлы без расширения SEG-Y принимаются только при полном совпадении размера
+        bool strict = !hasSegyExtension(candidates[i]);
+        accepted[i] = sniffSegyFile(candidates[i], strict, &reasons[i]) ? 1 : 0;
+    }
+
+    std::vector<std::string> files;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (accepted[i]) {
+            files.push_back(candidates[i]);
+        } else if (rejected && hasSegyExtension(candidates[i])) {
+            rejected->emplace_back(candidates[i], reasons[i]);
+        }
+    }
+
+    // Deterministic order for tables, maps and sharding
+    std::sort(files.begin(), files.end());
+    if (rejected) std::sort(rejected->begin(), rejected->end());
+    return files;
+}
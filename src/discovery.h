@@ -0,0 +1,32 @@
+#ifndef DISCOVERY_H
+#define DISCOVERY_H
+
+// SEG-Y file discovery: optional parallel recursive walk and binary header
+// sniffing, so candidates are accepted by content rather than by name.
+
+#include <string>
+#include <utility>
+#include <vector>
+
+struct DiscoveryOptions {
+    bool recursive = false;      // walk subdirectories
+    bool any_extension = false;  // also sniff files without a .sgy/.segy extension
+    unsigned threads = 0;        // directory walkers and sniffers (0 - default for I/O-bound work)
+    std::vector<std::string> skip_dirs;  // directories never entered (e.g. the segyscan output)
+};
+
+// .sgy / .segy, case-insensitive, optionally followed by .gz / .zst
+bool hasSegyExtension(const std::string& filepath);
+
+// Checks the binary header for plausibility: sample interval and sample count are set,
+// and the file holds at least one full trace. With strict, the data sample format
+// code must be known and the file size must be a whole number of traces (used for
+// files without a SEG-Y extension). reason receives the rejection cause.
+bool sniffSegyFile(const std::string& filepath, bool strict = false, std::string* reason = nullptr);
+
+// Files under root (or root itself if it is a file) that pass sniffing, sorted by path.
+// Files with a SEG-Y extension that fail sniffing are reported in rejected (path, reason).
+std::vector<std::string> discoverSegyFiles(const std::string& root, const DiscoveryOptions& options = DiscoveryOptions(),
+                                           std::vector<std::pair<std::string, std::string>>* rejected = nullptr);
+
+#endif // DISCOVERY_H
@@ -0,0 +1,243 @@
+#include "duplicates.h"
+#include "segyscan.h"
+#include "Hash.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <omp.h>
+
+namespace {
+
+// Bytes 1-8 of a trace header hold the trace sequence numbers within the line and the
+// file, which merging renumbers: the raw header comparison starts after them
+const size_t kSequenceBytes = 8;
+
+// Lock-free open-addressing set of 63-bit fingerprints. Bit 0 of a slot marks a
+// fingerprint inserted more than once; an empty slot is 0.
+class FingerprintSet {
+public:
+    explicit FingerprintSet(uint64_t count) {
+        // Load factor at most 2/3: short linear probes at 12-24 bytes per trace
+        bits_ = 4;
+        while ((uint64_t(1) << bits_) < count + count / 2) ++bits_;
+        mask_ = (uint64_t(1) << bits_) - 1;
+        slots_.reset(new std::atomic<uint64_t>[mask_ + 1]);
+        const int64_t size = static_cast<int64_t>(mask_ + 1);
+        #pragma omp parallel for schedule(static)
+        for (int64_t i = 0; i < size; ++i) slots_[i].store(0, std::memory_order_relaxed);
+    }
+
+    void insert(uint64_t hash) {
+        const uint64_t key = keyOf(hash);
+        for (uint64_t slot = hash >> (64 - bits_);; slot = (slot + 1) & mask_) {
+            uint64_t value = slots_[slot].load(std::memory_order_relaxed);
+            if (value == 0) {
+                if (slots_[slot].compare_exchange_strong(value, key, std::memory_order_relaxed)) return;
+                // Another thread took the slot: value now holds its key
+            }
+            if ((value & ~uint64_t(1)) == key) {
+                if ((value & 1) == 0) slots_[slot].fetch_or(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+
+    // Read-only after all inserts
+    bool repeated(uint64_t hash) const {
+        const uint64_t key = keyOf(hash);
+        for (uint64_t slot = hash >> (64 - bits_);; slot = (slot + 1) & mask_) {
+            const uint64_t value = slots_[slot].load(std::memory_order_relaxed);
+            if (value == 0) return false;
+            if ((value & ~uint64_t(1)) == key) return (value & 1) != 0;
+        }
+    }
+
+private:
+    static uint64_t keyOf(uint64_t hash) {
+        const uint64_t key = hash & ~uint64_t(1);
+        return key == 0 ? 2 : key;
+    }
+
+    int bits_;
+    uint64_t mask_;
+    std::unique_ptr<std::atomic<uint64_t>[]> slots_;
+};
+
+struct TraceRef {
+    size_t file;
+    uint64_t trace;
+};
+
+// Confirms fingerprint matches: decoded header fields, then the raw trace headers and
+// sample bytes re-read from the files
+class TraceComparer {
+public:
+    explicit TraceComparer(const std::vector<DuplicateInput>& files)
+        : files_(files), blocks_(files.size()), readers_(files.size()) {}
+
+    // false: not a duplicate; *unverified: the raw headers and sample bytes could not be compared
+    bool same(const TraceRef& a, const TraceRef& b, bool* unverified) {
+        *unverified = false;
+        // Decoded fields first: cached per block, they reject most hash collisions without I/O.
+        // Copied: both traces may be in the same file, whose cached block the second lookup replaces
+        int32_t fields_a[HeaderColumns::kBuiltinColumns];
+        const int32_t* cached_a = row(a);
+        if (cached_a) std::copy(cached_a, cached_a + HeaderColumns::kBuiltinColumns, fields_a);
+        const int32_t* fields_b = row(b);
+        if (cached_a && fields_b && !std::equal(fields_a, fields_a + HeaderColumns::kBuiltinColumns, fields_b)) {
+            return false;
+        }
+
+        SegyReader* ra = reader(a.file);
+        SegyReader* rb = reader(b.file);
+        if (!ra || !rb) {
+            *unverified = true;
+            return true;
+        }
+        // The whole 240-byte header except the sequence numbers, not only the decoded fields
+        const std::vector<char> header_a = ra->readTraceHeader(a.trace);
+        const std::vector<char> header_b = rb->readTraceHeader(b.trace);
+        if (!std::equal(header_a.begin() + kSequenceBytes, header_a.end(), header_b.begin() + kSequenceBytes)) {
+            return false;
+        }
+        if (!files_[a.file].fingerprints->samples) return true;
+        return ra->readTraceSamples(a.trace) == rb->readTraceSamples(b.trace);
+    }
+
+private:
+    // Header fields of a trace as 14 int32. Duplicates come in runs, so the last decoded
+    // block of every file is kept instead of decoding a block per field lookup.
+    const int32_t* row(const TraceRef& trace) {
+        const HeaderColumns* columns = files_[trace.file].columns;
+        if (!columns || trace.trace >= columns->num_traces()) return nullptr;
+        Block& cached = blocks_[trace.file];
+        const size_t block = static_cast<size_t>(trace.trace / kHeaderBlockSize);
+        if (cached.rows.empty() || cached.index != block) {
+            cached.rows.resize(kHeaderBlockSize);
+            columns->decodeBlock(block, cached.rows.data());
+            cached.index = block;
+        }
+        return reinterpret_cast<const int32_t*>(&cached.rows[trace.trace % kHeaderBlockSize]);
+    }
+
+    // nullptr for files without random access (compressed)
+    SegyReader* reader(size_t file) {
+        auto& entry = readers_[file];
+        if (!entry.opened) {
+            entry.opened = true;
+            const std::string& path = files_[file].fingerprints->path;
+            if (detectCompression(path) == Compression::None) {
+                SegyReaderOptions options;
+                options.read_headers = false;
+                options.trace_cache_bytes = 0;
+                options.prefetch_traces = 0;
+                entry.reader.reset(new SegyReader(path, options));
+            }
+        }
+        return entry.reader.get();
+    }
+
+    struct Entry {
+        bool opened = false;
+        std::unique_ptr<SegyReader> reader;
+    };
+    struct Block {
+        size_t index = 0;
+        std::vector<TraceData> rows;
+    };
+    const std::vector<DuplicateInput>& files_;
+    std::vector<Block> blocks_;
+    std::vector<Entry> readers_;
+};
+
+} // namespace
+
+DuplicateMode parseDuplicateMode(const std::string& name) {
+    if (name == "headers") return DuplicateMode::Headers;
+    if (name == "samples") return DuplicateMode::Samples;
+    throw std::invalid_argument("Unknown duplicate detection mode: " + name + " (expected headers or samples)");
+}
+
+TraceFingerprints fingerprintTraces(const std::vector<TraceData>& traces, const std::vector<uint64_t>& sample_hashes) {
+    TraceFingerprints result;
+    result.samples = !sample_hashes.empty();
+    if (result.samples && sample_hashes.size() != traces.size()) {
+        throw std::logic_error("Sample hashes do not match the trace count");
+    }
+    result.hashes.resize(traces.size());
+
+    const int64_t n = static_cast<int64_t>(traces.size());
+    #pragma omp parallel for schedule(static)
+    for (int64_t i = 0; i < n; ++i) {
+        // All built-in fields in TraceData order, little-endian independent of the host byte order
+        uint8_t key[HeaderColumns::kBuiltinColumns * 4];
+        const int32_t* row = reinterpret_cast<const int32_t*>(&traces[i]);
+        size_t pos = 0;
+        for (size_t c = 0; c < HeaderColumns::kBuiltinColumns; ++c) {
+            const uint32_t value = static_cast<uint32_t>(row[c]);
+            for (int b = 0; b < 4; ++b) key[pos++] = static_cast<uint8_t>(value >> (8 * b));
+        }
+        // The sample fingerprint seeds the header hash: one 64-bit value covers both
+        result.hashes[i] = xxhash64(key, sizeof(key), result.samples ? sample_hashes[i] : 0);
+    }
+    return result;
+}
+
+std::vector<FileDuplicates> findDuplicates(const std::vector<DuplicateInput>& files) {
+    std::vector<FileDuplicates> result(files.size());
+    uint64_t total = 0;
+    for (size_t f = 0; f < files.size(); ++f) {
+        result[f].num_traces = files[f].fingerprints->hashes.size();
+        total += result[f].num_traces;
+    }
+    if (total < 2) return result;
+
+    // Pass 1: every fingerprint into the set; the ones inserted twice are marked
+    FingerprintSet set(total);
+    for (const auto& file : files) {
+        const std::vector<uint64_t>& hashes = file.fingerprints->hashes;
+        const int64_t n = static_cast<int64_t>(hashes.size());
+        #pragma omp parallel for schedule(static)
+        for (int64_t i = 0; i < n; ++i) set.insert(hashes[i]);
+    }
+
+    // Pass 2: traces with a repeated fingerprint, in file and trace order
+    TraceComparer comparer(files);
+    std::unordered_map<uint64_t, std::vector<TraceRef>> originals;
+    for (size_t f = 0; f < files.size(); ++f) {
+        const std::vector<uint64_t>& hashes = files[f].fingerprints->hashes;
+        const int64_t n = static_cast<int64_t>(hashes.size());
+        std::vector<uint8_t> repeated(hashes.size());
+        #pragma omp parallel for schedule(static)
+        for (int64_t i = 0; i < n; ++i) repeated[i] = set.repeated(hashes[i]);
+
+        FileDuplicates& dups = result[f];
+        for (uint64_t i = 0; i < hashes.size(); ++i) {
+            if (!repeated[i]) continue;
+            const TraceRef trace{f, i};
+            // Usually one original per fingerprint; more only on a 64-bit hash collision
+            std::vector<TraceRef>& candidates = originals[hashes[i]];
+            bool found = false;
+            for (const TraceRef& original : candidates) {
+                bool unverified = false;
+                if (!comparer.same(original, trace, &unverified)) continue;
+                found = true;
+                ++dups.duplicates;
+                if (unverified) ++dups.unverified;
+                DuplicateRun* last = dups.runs.empty() ? nullptr : &dups.runs.back();
+                if (last && last->original_file == original.file &&
+                    last->first_trace + last->num_traces == i &&
+                    last->original_first_trace + last->num_traces == original.trace) {
+                    ++last->num_traces;
+                } else {
+                    dups.runs.push_back({i, 1, original.file, original.trace});
+                }
+                break;
+            }
+            if (!found) candidates.push_back(trace);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,65 @@
+#ifndef DUPLICATES_H
+#define DUPLICATES_H
+
+// Duplicate trace detection for merged deliveries (a shot copied twice, overlapping
+// file boundaries). During the scan every trace gets a 64-bit XXH64 fingerprint of its
+// key header fields: all built-in fields, channel (Chan) included, so the traces of one
+// shot differ even without receiver coordinates. Optionally the fingerprint also covers
+// the trace's sample bytes, hashed by the reader in the same pass. Fingerprints of all
+// files go into one compact lock-free hash set. Only traces whose fingerprint was seen
+// before are confirmed: decoded fields, then the raw 240-byte headers without the
+// sequence numbers in bytes 1-8 (merging renumbers them), then sample bytes.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct TraceData;
+class HeaderColumns;
+
+enum class DuplicateMode {
+    Off,
+    Headers,  // key header fields only
+    Samples   // key header fields and sample bytes
+};
+
+// "headers", "samples"; std::invalid_argument otherwise
+DuplicateMode parseDuplicateMode(const std::string& name);
+
+struct TraceFingerprints {
+    std::string path;               // file re-read to compare sample bytes
+    bool samples = false;           // fingerprints cover the sample bytes
+    std::vector<uint64_t> hashes;   // one per trace
+};
+
+// sample_hashes: SegyReader::sample_hashes(), empty for header-only fingerprints
+TraceFingerprints fingerprintTraces(const std::vector<TraceData>& traces, const std::vector<uint64_t>& sample_hashes);
+
+// Consecutive duplicates of consecutive traces of one original file
+struct DuplicateRun {
+    uint64_t first_trace;           // 0-based, as in the query output
+    uint64_t num_traces;
+    size_t original_file;           // index into the findDuplicates input
+    uint64_t original_first_trace;
+};
+
+struct FileDuplicates {
+    uint64_t num_traces = 0;
+    uint64_t duplicates = 0;
+    // Duplicates whose raw headers and sample bytes could not be re-read (compressed
+    // files): confirmed by the decoded header fields and the fingerprint only
+    uint64_t unverified = 0;
+    std::vector<DuplicateRun> runs;
+};
+
+struct DuplicateInput {
+    const TraceFingerprints* fingerprints;
+    const HeaderColumns* columns;   // decoded header fields of the same traces
+};
+
+// Files in scan order: the first occurrence of a trace is the original, every later
+// equal trace (in the same or a later file) is a duplicate of it
+std::vector<FileDuplicates> findDuplicates(const std::vector<DuplicateInput>& files);
+
+#endif // DUPLICATES_H
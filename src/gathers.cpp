@@ -0,0 +1,127 @@
+#include "gathers.h"
+#include "segyscan.h"
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+namespace {
+
+// Keys are judged only after this many traces, so a short first gather does not disable them
+const uint64_t kMinTracesForDensity = 1024;
+
+bool sameSource(const SourceRun& run, const TraceData& trace) {
+    return run.sou_x == trace.sou_x && run.sou_y == trace.sou_y && run.ffid == trace.ffid &&
+           run.source == trace.source && run.sou_elev == trace.sou_elev;
+}
+
+void pushSourceRun(std::vector<SourceRun>& runs, const TraceData& trace) {
+    if (!runs.empty() && sameSource(runs.back(), trace)) {
+        runs.back().num_traces++;
+    } else {
+        runs.push_back(SourceRun{trace.ffid, trace.source, trace.sou_x, trace.sou_y, trace.sou_elev, 1});
+    }
+}
+
+} // namespace
+
+void GatherSegmenter::KeyRuns::push(int32_t key, uint64_t trace_index) {
+    if (!gathers.empty() && gathers.back().key == key) {
+        gathers.back().num_traces++;
+    } else {
+        gathers.push_back(GatherInfo{trace_index, 1, key});
+    }
+}
+
+void GatherSegmenter::checkDensity(KeyRuns& runs) const {
+    // Fewer than two traces per run on average: the key does not form ensembles
+    if (num_traces_ >= kMinTracesForDensity && runs.gathers.size() * 2 > num_traces_) {
+        runs.active = false;
+        std::vector<GatherInfo>().swap(runs.gathers);
+    }
+}
+
+void GatherSegmenter::push(const TraceData& trace) {
+    if (ffid_.active) ffid_.push(trace.ffid, num_traces_);
+    if (cdp_.active) cdp_.push(trace.cdp, num_traces_);
+    pushSourceRun(source_runs_, trace);
+    ++num_traces_;
+
+    // Checked on power-of-two trace counts: cheap, and a dead key is dropped early
+    if ((num_traces_ & (num_traces_ - 1)) == 0) {
+        if (ffid_.active) checkDensity(ffid_);
+        if (cdp_.active) checkDensity(cdp_);
+    }
+}
+
+GatherSegmentation GatherSegmenter::finish() {
+    GatherSegmentation result;
+    result.source_runs = std::move(source_runs_);
+
+    auto forms_ensembles = [&](const KeyRuns& runs) {
+        return runs.active && !runs.gathers.empty() && runs.gathers.size() * 2 <= num_traces_;
+    };
+    bool use_ffid = forms_ensembles(ffid_);
+    bool use_cdp = forms_ensembles(cdp_);
+    if (use_ffid && use_cdp) {
+        use_cdp = cdp_.gathers.size() < ffid_.gathers.size();
+        use_ffid = !use_cdp;
+    }
+    if (use_ffid) {
+        result.key = "FFID";
+        result.gathers = std::move(ffid_.gathers);
+    } else if (use_cdp) {
+        result.key = "CDP";
+        result.gathers = std::move(cdp_.gathers);
+    }
+
+    *this = GatherSegmenter();
+    return result;
+}
+
+GatherSegmentation segmentGathers(const std::vector<TraceData>& traces) {
+    GatherSegmenter segmenter;
+    for (const auto& trace : traces) {
+        segmenter.push(trace);
+    }
+    return segmenter.finish();
+}
+
+std::vector<SourceRun> encodeSourceRuns(const std::vector<TraceData>& traces) {
+    std::vector<SourceRun> runs;
+    for (const auto& trace : traces) {
+        pushSourceRun(runs, trace);
+    }
+    return runs;
+}
+
+std::vector<SourceInfo> uniqueSources(const std::vector<SourceRun>& runs, std::pmr::memory_resource* memory) {
+    std::pmr::map<std::pair<int32_t, int32_t>, std::tuple<int32_t, int32_t, int32_t>> unique_sources(memory); // (x, y) -> (ffid, source, max_elevation)
+
+    for (const auto& run : runs) {
+        auto key = std::make_pair(run.sou_x, run.sou_y);
+        auto it = unique_sources.find(key);
+
+        if (it == unique_sources.end()) {
+            // Новый источник: первые FFID и номер источника
+            unique_sources[key] = std::make_tuple(run.ffid, run.source, run.sou_elev);
+        } else {
+            // Источник уже существует - обновляем высоту до максимальной
+            auto& elev = std::get<2>(it->second);
+            elev = std::max(elev, run.sou_elev);
+        }
+    }
+
+    std::vector<SourceInfo> sources;
+    sources.reserve(unique_sources.size());
+    for (const auto& source : unique_sources) {
+        SourceInfo info;
+        info.sou_x = source.first.first;
+        info.sou_y = source.first.second;
+        auto& [ffid, source_num, elev] = source.second;
+        info.ffid = ffid;
+        info.source = source_num;
+        info.sou_elev = elev;
+        sources.push_back(info);
+    }
+    return sources;
+}
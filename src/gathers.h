@@ -0,0 +1,76 @@
+#ifndef GATHERS_H
+#define GATHERS_H
+
+// Ensemble (gather) boundaries and run-length encoded source columns.
+// Shot-sorted files repeat FFID and source fields for every channel; CDP-sorted
+// files repeat the CDP. A single streaming pass records where those keys change,
+// so gather indexes come for free and source aggregation works per run, not per trace.
+
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include "basetypes.h"
+
+struct TraceData;
+
+// One ensemble: consecutive traces sharing the gather key
+struct GatherInfo {
+    uint64_t first_trace;
+    uint64_t num_traces;
+    int32_t key;
+};
+
+// Run of consecutive traces with identical source fields
+struct SourceRun {
+    int32_t ffid;
+    int32_t source;
+    int32_t sou_x;
+    int32_t sou_y;
+    int32_t sou_elev;
+    uint64_t num_traces;
+};
+
+struct GatherSegmentation {
+    std::string key;                   // "FFID", "CDP" or empty when the traces form no ensembles
+    std::vector<GatherInfo> gathers;   // boundaries of the key, in trace order
+    std::vector<SourceRun> source_runs;
+};
+
+/**
+ * Streaming segmenter: push traces in file order, then finish().
+ *
+ * FFID and CDP runs are tracked together; a key stops being tracked once its runs
+ * average fewer than two traces (e.g. CDP in a shot-sorted file), so memory stays
+ * proportional to the number of real gathers. finish() picks the key with fewer
+ * runs, preferring FFID.
+ */
+class GatherSegmenter {
+public:
+    void push(const TraceData& trace);
+    GatherSegmentation finish();
+
+private:
+    struct KeyRuns {
+        bool active = true;
+        std::vector<GatherInfo> gathers;
+        void push(int32_t key, uint64_t trace_index);
+    };
+    void checkDensity(KeyRuns& runs) const;
+
+    uint64_t num_traces_ = 0;
+    KeyRuns ffid_;
+    KeyRuns cdp_;
+    std::vector<SourceRun> source_runs_;
+};
+
+GatherSegmentation segmentGathers(const std::vector<TraceData>& traces);
+
+// Source runs alone, without gather tracking
+std::vector<SourceRun> encodeSourceRuns(const std::vector<TraceData>& traces);
+
+// Unique sources from source runs: same result as uniqueSources(traces), one probe per run
+std::vector<SourceInfo> uniqueSources(const std::vector<SourceRun>& runs,
+                                      std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+#endif // GATHERS_H
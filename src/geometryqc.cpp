@@ -0,0 +1,162 @@
+#include "geometryqc.h"
+#include "segyscan.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// Traces are converted to structure-of-arrays blocks so the attribute
+// loops below vectorize; histogram binning stays scalar
+const size_t kBlockSize = 1024;
+
+const double kRadToDeg = 57.29577951308232;
+
+} // namespace
+
+void AttributeStats::merge(const AttributeStats& other) {
+    if (other.count == 0) return;
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    min_val = std::min(min_val, other.min_val);
+    max_val = std::max(max_val, other.max_val);
+    sum += other.sum;
+    count += other.count;
+}
+
+void GeometryStats::merge(const GeometryStats& other) {
+    if (offset_bin_width == 0.0) {
+        offset_bin_width = other.offset_bin_width;
+        midpoint_tolerance = other.midpoint_tolerance;
+    }
+    if (other.num_traces() > 0 && (other.offset_bin_width != offset_bin_width ||
+                                   (!azimuth_histogram.empty() && other.azimuth_histogram.size() != azimuth_histogram.size()))) {
+        throw std::invalid_argument("Geometry statistics were built with different histogram options");
+    }
+    if (other.num_traces() > 0 && !std::isnan(other.midpoint_tolerance) && !std::isnan(midpoint_tolerance) &&
+        other.midpoint_tolerance != midpoint_tolerance) {
+        throw std::invalid_argument("Geometry statistics were built with different midpoint tolerances");
+    }
+    if (other.num_traces() > 0 && std::isnan(other.midpoint_tolerance)) {
+        midpoint_tolerance = NAN;
+    }
+    offset.merge(other.offset);
+    azimuth.merge(other.azimuth);
+    midpoint_error.merge(other.midpoint_error);
+    midpoint_exceeded += other.midpoint_exceeded;
+    zero_offset += other.zero_offset;
+
+    // Bins past the cap (partials written before it) go to the overflow bin
+    const size_t bins = std::min(other.offset_histogram.size(), kMaxOffsetBins + 1);
+    if (offset_histogram.size() < bins) {
+        offset_histogram.resize(bins, 0);
+    }
+    for (size_t i = 0; i < other.offset_histogram.size(); ++i) {
+        offset_histogram[std::min(i, kMaxOffsetBins)] += other.offset_histogram[i];
+    }
+    if (azimuth_histogram.empty()) {
+        azimuth_histogram.assign(other.azimuth_histogram.size(), 0);
+    }
+    for (size_t i = 0; i < other.azimuth_histogram.size(); ++i) {
+        azimuth_histogram[i] += other.azimuth_histogram[i];
+    }
+}
+
+GeometryStats computeGeometryStats(const std::vector<TraceData>& traces, const GeometryOptions& options) {
+    if (options.offset_bin_width <= 0.0 || options.azimuth_bins <= 0) {
+        throw std::invalid_argument("Invalid geometry histogram options");
+    }
+
+    GeometryStats stats;
+    stats.offset_bin_width = options.offset_bin_width;
+    stats.midpoint_tolerance = options.midpoint_tolerance;
+    stats.azimuth_histogram.assign(options.azimuth_bins, 0);
+    if (traces.empty()) return stats;
+
+    const double tolerance = options.midpoint_tolerance;
+    const double sector = 360.0 / options.azimuth_bins;
+
+    std::vector<double> dx(kBlockSize), dy(kBlockSize), offset(kBlockSize), error(kBlockSize);
+    std::vector<double> sx(kBlockSize), sy(kBlockSize), rx(kBlockSize), ry(kBlockSize), cx(kBlockSize), cy(kBlockSize);
+
+    double off_min = INFINITY, off_max = -INFINITY, off_sum = 0.0;
+    double err_min = INFINITY, err_max = -INFINITY, err_sum = 0.0;
+    uint64_t exceeded = 0;
+
+    for (size_t start = 0; start < traces.size(); start += kBlockSize) {
+        const size_t n = std::min(kBlockSize, traces.size() - start);
+        const TraceData* block = traces.data() + start;
+
+        for (size_t i = 0; i < n; ++i) {
+            sx[i] = block[i].sou_x;
+            sy[i] = block[i].sou_y;
+            rx[i] = block[i].rec_x;
+            ry[i] = block[i].rec_y;
+            cx[i] = block[i].cdp_x;
+            cy[i] = block[i].cdp_y;
+        }
+
+        #pragma omp simd
+        for (size_t i = 0; i < n; ++i) {
+            dx[i] = rx[i] - sx[i];
+            dy[i] = ry[i] - sy[i];
+            offset[i] = std::sqrt(dx[i] * dx[i] + dy[i] * dy[i]);
+            double ex = cx[i] - 0.5 * (sx[i] + rx[i]);
+            double ey = cy[i] - 0.5 * (sy[i] + ry[i]);
+            error[i] = std::sqrt(ex * ex + ey * ey);
+        }
+
+        #pragma omp simd reduction(min:off_min, err_min) reduction(max:off_max, err_max) reduction(+:off_sum, err_sum, exceeded)
+        for (size_t i = 0; i < n; ++i) {
+            off_min = std::min(off_min, offset[i]);
+            off_max = std::max(off_max, offset[i]);
+            off_sum += offset[i];
+            err_min = std::min(err_min, error[i]);
+            err_max = std::max(err_max, error[i]);
+            err_sum += error[i];
+            exceeded += error[i] > tolerance ? 1 : 0;
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            const double position = offset[i] / options.offset_bin_width;
+            const size_t bin = position < static_cast<double>(GeometryStats::kMaxOffsetBins)
+                                   ? static_cast<size_t>(position) : GeometryStats::kMaxOffsetBins;
+            if (bin >= stats.offset_histogram.size()) {
+                stats.offset_histogram.resize(bin + 1, 0);
+            }
+            stats.offset_histogram[bin]++;
+
+            if (offset[i] == 0.0) {
+                stats.zero_offset++;
+                continue;
+            }
+            double az = std::atan2(dx[i], dy[i]) * kRadToDeg;
+            if (az < 0.0) az += 360.0;
+            if (az >= 360.0) az -= 360.0;
+            size_t s = std::min(static_cast<size_t>(az / sector), stats.azimuth_histogram.size() - 1);
+            stats.azimuth_histogram[s]++;
+
+            if (stats.azimuth.count == 0) {
+                stats.azimuth.min_val = stats.azimuth.max_val = az;
+            } else {
+                stats.azimuth.min_val = std::min(stats.azimuth.min_val, az);
+                stats.azimuth.max_val = std::max(stats.azimuth.max_val, az);
+            }
+            stats.azimuth.sum += az;
+            stats.azimuth.count++;
+        }
+    }
+
+    stats.offset.min_val = off_min;
+    stats.offset.max_val = off_max;
+    stats.offset.sum = off_sum;
+    stats.offset.count = traces.size();
+    stats.midpoint_error.min_val = err_min;
+    stats.midpoint_error.max_val = err_max;
+    stats.midpoint_error.sum = err_sum;
+    stats.midpoint_error.count = traces.size();
+    stats.midpoint_exceeded = exceeded;
+    return stats;
+}
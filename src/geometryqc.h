@@ -0,0 +1,57 @@
+#ifndef GEOMETRYQC_H
+#define GEOMETRYQC_H
+
+// Derived geometry attributes computed during the header scan:
+// source-receiver offset, azimuth and the distance between CDP_X/Y and the
+// source-receiver midpoint. Statistics are mergeable across files.
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+struct TraceData;
+
+struct GeometryOptions {
+    double midpoint_tolerance = 1.0;   // max allowed |CDP - midpoint|, coordinate units
+    double offset_bin_width = 100.0;   // offset histogram bin, coordinate units
+    int azimuth_bins = 36;             // rose diagram sectors over 0-360 degrees
+};
+
+// Min/max/sum accumulator of one attribute
+struct AttributeStats {
+    double min_val = 0.0;
+    double max_val = 0.0;
+    double sum = 0.0;
+    uint64_t count = 0;
+
+    double mean() const { return count > 0 ? sum / static_cast<double>(count) : 0.0; }
+    void merge(const AttributeStats& other);
+};
+
+struct GeometryStats {
+    AttributeStats offset;
+    AttributeStats azimuth;          // degrees clockwise from +Y, zero-offset traces excluded
+    AttributeStats midpoint_error;
+    // Offsets beyond kMaxOffsetBins bins (one garbage coordinate gives ~2^31) are counted
+    // in the overflow bin kMaxOffsetBins instead of growing the histogram
+    static const size_t kMaxOffsetBins = 1000;
+
+    uint64_t midpoint_exceeded = 0;  // traces with midpoint error above the tolerance
+    uint64_t zero_offset = 0;
+    // Tolerance midpoint_exceeded was counted with; NaN if unknown (partials before version 7)
+    double midpoint_tolerance = NAN;
+
+    double offset_bin_width = 0.0;
+    // bin i: [i * width, (i + 1) * width); bin kMaxOffsetBins: [kMaxOffsetBins * width, max]
+    std::vector<uint64_t> offset_histogram;
+    std::vector<uint64_t> azimuth_histogram;  // sector i: [i * 360 / n, (i + 1) * 360 / n)
+
+    uint64_t num_traces() const { return offset.count; }
+    // Histograms and midpoint_exceeded must have been built with the same options;
+    // throws std::invalid_argument otherwise
+    void merge(const GeometryStats& other);
+};
+
+GeometryStats computeGeometryStats(const std::vector<TraceData>& traces, const GeometryOptions& options = GeometryOptions());
+
+#endif // GEOMETRYQC_H
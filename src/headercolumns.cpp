@@ -0,0 +1,487 @@
+#include "headercolumns.h"
+#include "segyscan.h"
+#include <algorithm>
+#include <cstring>
+#include <omp.h>
+#include <map>
+#include <tuple>
+
+namespace {
+
+// Packed values are little-endian bit streams; 8 bytes hold any value of up to 32 bits
+// at any bit offset within its first byte
+inline uint64_t loadLE64(const uint8_t* p) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+inline void storeLE64(uint8_t* p, uint64_t word) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    std::memcpy(p, &word, sizeof(word));
+}
+
+inline uint8_t bitWidth(uint64_t value) {
+    return value ? static_cast<uint8_t>(64 - __builtin_clzll(value)) : 0;
+}
+
+// out must have room for 8 bytes past the packed values
+void pack(const uint32_t* values, size_t count, uint8_t width, uint8_t* out) {
+    if (width == 0) return;
+    uint64_t word = 0;
+    unsigned filled = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t value = values[i];
+        word |= value << filled;
+        filled += width;
+        if (filled >= 64) {
+            storeLE64(out, word);
+            out += 8;
+            filled -= 64;
+            word = filled ? value >> (width - filled) : 0;
+        }
+    }
+    if (filled) storeLE64(out, word);
+}
+
+// Branch-free per value, so the loop vectorizes for every width
+void unpack(const uint8_t* in, size_t count, uint8_t width, uint32_t* out) {
+    const uint64_t mask = (uint64_t(1) << width) - 1;
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t bit = i * width;
+        out[i] = static_cast<uint32_t>((loadLE64(in + (bit >> 3)) >> (bit & 7)) & mask);
+    }
+}
+
+// At most this many values per block are stored aside instead of widening the block
+const size_t kMaxExceptions = 64;
+// 16-bit slot and 32-bit value
+const uint64_t kExceptionBits = 48;
+
+// Values in [low, low + 2^width) are packed, the others become exceptions
+struct Packing {
+    int64_t low = 0;
+    uint8_t width = 32;
+    uint64_t bits = UINT64_MAX;
+};
+
+// Cheapest packing of count values, as in patched frame of reference: for a window
+// anchored at the minimum, at the maximum or centred on the middle value, the values
+// needing more bits than the window width become exceptions. A histogram of the
+// needed widths prices every width in one pass, without sorting.
+Packing choosePacking(const int64_t* units, size_t count, bool with_exceptions = true) {
+    Packing best;
+    const auto [min_it, max_it] = std::minmax_element(units, units + count);
+    const int64_t min_unit = *min_it, max_unit = *max_it;
+    const uint64_t full_span = static_cast<uint64_t>(max_unit - min_unit);
+    if (full_span <= UINT32_MAX) {
+        best.low = min_unit;
+        best.width = bitWidth(full_span);
+        best.bits = count * best.width;
+    }
+    // Выбросы могут сэкономить, только если блок уже шире пары бит
+    if (!with_exceptions || best.width <= 2 || full_span > UINT32_MAX) return best;
+
+    // Spans fit in 32 bits here, so widths are 0..33; two histogram copies per anchor
+    // keep consecutive increments of the same bucket independent
+    const int64_t middle = units[count / 2];
+    uint32_t above[2][34] = {}, below[2][34] = {}, around[2][34] = {};
+    for (size_t i = 0; i < count; ++i) {
+        const size_t copy = i & 1;
+        above[copy][bitWidth(static_cast<uint64_t>(units[i] - min_unit))]++;
+        below[copy][bitWidth(static_cast<uint64_t>(max_unit - units[i]))]++;
+        // Signed width of the distance to the middle value (0 for the value itself)
+        const int64_t d = units[i] - middle;
+        around[copy][bitWidth(static_cast<uint64_t>(d ^ (d >> 63))) + (d != 0)]++;
+    }
+
+    size_t k_above = 0, k_below = 0, k_around = around[0][33] + around[1][33];
+    for (int width = 32; width-- > 0;) {
+        k_above += above[0][width + 1] + above[1][width + 1];
+        k_below += below[0][width + 1] + below[1][width + 1];
+        k_around += around[0][width + 1] + around[1][width + 1];
+        if (width >= best.width) continue;
+        const size_t k = std::min({k_above, k_below, k_around});
+        if (k > kMaxExceptions) break;
+        const uint64_t bits = count * width + k * kExceptionBits;
+        if (bits >= best.bits) continue;
+        const int64_t window = int64_t(1) << width;
+        if (k == k_above) {
+            best.low = min_unit;
+        } else if (k == k_below) {
+            best.low = max_unit - (window - 1);
+        } else {
+            best.low = width == 0 ? middle : middle - window / 2;
+        }
+        best.width = static_cast<uint8_t>(width);
+        best.bits = bits;
+    }
+    return best;
+}
+
+} // namespace
+
+CompressedColumn::CompressedColumn(const int32_t* column, size_t count, size_t stride) {
+    for (size_t first = 0; first < count; first += kHeaderBlockSize) {
+        appendBlock(column + first * stride, std::min(kHeaderBlockSize, count - first), stride);
+    }
+    shrink();
+}
+
+void CompressedColumn::appendBlock(const int32_t* column, size_t n, size_t stride) {
+    int64_t values[kHeaderBlockSize], deltas[kHeaderBlockSize];
+    uint32_t packed[kHeaderBlockSize];
+    if (n == 0) return;
+    for (size_t i = 0; i < n; ++i) {
+        values[i] = column[i * stride];
+    }
+    count_ += n;
+
+    ColumnBlock block{};
+    block.first = static_cast<int32_t>(values[0]);
+    block.min_val = block.max_val = block.first;
+    for (size_t i = 1; i < n; ++i) {
+        block.min_val = std::min(block.min_val, static_cast<int32_t>(values[i]));
+        block.max_val = std::max(block.max_val, static_cast<int32_t>(values[i]));
+        deltas[i - 1] = values[i] - values[i - 1];
+    }
+    // Payload keeps 8 zero bytes of padding past the packed values of the last block
+    block.offset = payload_.empty() ? 0 : payload_.size() - 8;
+    block.exceptions = static_cast<uint32_t>(exception_slots_.size());
+    if (block.min_val == block.max_val) {
+        block.reference = block.min_val;
+        blocks_.push_back(block);
+        return;
+    }
+
+    // Смещения от минимума блока или разности соседних значений - что короче.
+    // Offsets from the minimum are only searched for exceptions if differences need over 2 bits
+    const Packing delta_packing = choosePacking(deltas, n - 1);
+    Packing packing = choosePacking(values, n, delta_packing.bits > 2 * n);
+    block.delta = delta_packing.bits < packing.bits;
+    if (block.delta) packing = delta_packing;
+    const int64_t* units = block.delta ? deltas : values;
+    const size_t num_units = block.delta ? n - 1 : n;
+
+    block.width = packing.width;
+    // Modulo 2^32: differences of int32 values may not fit in int32
+    block.reference = static_cast<int32_t>(static_cast<uint32_t>(packing.low));
+    const uint64_t mask = (uint64_t(1) << block.width) - 1;
+    for (size_t i = 0; i < num_units; ++i) {
+        const int64_t unit = units[i];
+        if (unit >= packing.low && static_cast<uint64_t>(unit - packing.low) <= mask) {
+            packed[i] = static_cast<uint32_t>(unit - packing.low);
+        } else {
+            packed[i] = 0;
+            exception_slots_.push_back(static_cast<uint16_t>(i));
+            exception_values_.push_back(static_cast<uint32_t>(unit));
+        }
+    }
+    block.num_exceptions = static_cast<uint16_t>(exception_slots_.size() - block.exceptions);
+
+    const uint64_t packed_bytes = (num_units * block.width + 7) / 8;
+    payload_.resize(block.offset + packed_bytes + 8, 0);
+    pack(packed, num_units, block.width, payload_.data() + block.offset);
+    blocks_.push_back(block);
+}
+
+void CompressedColumn::shrink() {
+    if (payload_.empty()) payload_.resize(8, 0);
+    blocks_.shrink_to_fit();
+    payload_.shrink_to_fit();
+    exception_slots_.shrink_to_fit();
+    exception_values_.shrink_to_fit();
+}
+
+size_t CompressedColumn::blockRows(size_t index) const {
+    return std::min(kHeaderBlockSize, count_ - index * kHeaderBlockSize);
+}
+
+size_t CompressedColumn::decodeBlock(size_t index, int32_t* out) const {
+    const ColumnBlock& block = blocks_[index];
+    const size_t n = blockRows(index);
+    if (block.min_val == block.max_val) {
+        std::fill(out, out + n, block.min_val);
+        return n;
+    }
+
+    // Разности кладутся со сдвигом на одну позицию: out[0] - первое значение
+    uint32_t* values = reinterpret_cast<uint32_t*>(out);
+    uint32_t* units = block.delta ? values + 1 : values;
+    const size_t num_units = block.delta ? n - 1 : n;
+    const uint32_t reference = static_cast<uint32_t>(block.reference);
+    if (block.width) {
+        unpack(payload_.data() + block.offset, num_units, block.width, units);
+    } else {
+        std::fill(units, units + num_units, 0u);
+    }
+    for (size_t e = block.exceptions; e < block.exceptions + block.num_exceptions; ++e) {
+        units[exception_slots_[e]] = exception_values_[e] - reference;
+    }
+
+    if (!block.delta) {
+        for (size_t i = 0; i < n; ++i) {
+            values[i] += reference;
+        }
+        return n;
+    }
+    // Префиксная сумма по модулю 2^32: переполнение промежуточных значений безопасно
+    uint32_t acc = static_cast<uint32_t>(block.first);
+    values[0] = acc;
+    for (size_t i = 1; i < n; ++i) {
+        acc += values[i] + reference;
+        values[i] = acc;
+    }
+    return n;
+}
+
+int32_t CompressedColumn::at(size_t row) const {
+    const size_t index = row / kHeaderBlockSize;
+    const size_t i = row % kHeaderBlockSize;
+    const ColumnBlock& block = blocks_[index];
+    if (block.min_val == block.max_val) return block.min_val;
+    if (i == 0) return block.first;
+    if (!block.delta && block.num_exceptions == 0) {
+        const uint64_t bit = i * block.width;
+        const uint64_t mask = (uint64_t(1) << block.width) - 1;
+        const uint64_t value = (loadLE64(payload_.data() + block.offset + (bit >> 3)) >> (bit & 7)) & mask;
+        return static_cast<int32_t>(static_cast<uint32_t>(block.reference) + static_cast<uint32_t>(value));
+    }
+    int32_t values[kHeaderBlockSize];
+    decodeBlock(index, values);
+    return values[i];
+}
+
+size_t CompressedColumn::memoryBytes() const {
+    return sizeof(*this) + blocks_.capacity() * sizeof(ColumnBlock) + payload_.capacity() +
+           exception_slots_.capacity() * sizeof(uint16_t) + exception_values_.capacity() * sizeof(uint32_t);
+}
+
+HeaderColumns::HeaderColumns(const std::vector<TraceData>& traces, const std::vector<int32_t>& custom_values, size_t num_custom)
+    : num_traces_(traces.size()) {
+    if (custom_values.size() < traces.size() * num_custom) num_custom = 0;
+
+    columns_.resize(kBuiltinColumns + num_custom);
+    const int32_t* rows = reinterpret_cast<const int32_t*>(traces.data());
+    // Block-major: the rows of one block stay in cache while all their columns are encoded
+    const int num_threads = std::max(1, std::min(omp_get_max_threads(), static_cast<int>(columns_.size())));
+    #pragma omp parallel num_threads(num_threads)
+    {
+        const size_t thread = static_cast<size_t>(omp_get_thread_num());
+        const size_t step = static_cast<size_t>(omp_get_num_threads());
+        for (size_t first = 0; first < num_traces_; first += kHeaderBlockSize) {
+            const size_t n = std::min(kHeaderBlockSize, num_traces_ - first);
+            for (size_t c = thread; c < columns_.size(); c += step) {
+                if (c < kBuiltinColumns) {
+                    columns_[c].appendBlock(rows + first * kBuiltinColumns + c, n, kBuiltinColumns);
+                } else {
+                    columns_[c].appendBlock(custom_values.data() + first * num_custom + (c - kBuiltinColumns), n, num_custom);
+                }
+            }
+        }
+        for (size_t c = thread; c < columns_.size(); c += step) {
+            columns_[c].shrink();
+        }
+    }
+}
+
+size_t HeaderColumns::decodeBlock(size_t block, TraceData* rows) const {
+    int32_t values[kHeaderBlockSize];
+    int32_t* out = reinterpret_cast<int32_t*>(rows);
+    size_t n = 0;
+    for (size_t c = 0; c < kBuiltinColumns; ++c) {
+        n = columns_[c].decodeBlock(block, values);
+        for (size_t i = 0; i < n; ++i) {
+            out[i * kBuiltinColumns + c] = values[i];
+        }
+    }
+    return n;
+}
+
+std::vector<TraceData> HeaderColumns::decode() const {
+    std::vector<TraceData> traces(num_traces_);
+    #pragma omp parallel for schedule(static)
+    for (long long b = 0; b < static_cast<long long>(num_blocks()); ++b) {
+        decodeBlock(static_cast<size_t>(b), traces.data() + b * kHeaderBlockSize);
+    }
+    return traces;
+}
+
+size_t HeaderColumns::memoryBytes() const {
+    size_t bytes = sizeof(*this);
+    for (const auto& column : columns_) {
+        bytes += column.memoryBytes();
+    }
+    return bytes;
+}
+
+// --- Operators on compressed columns ---
+// Column indexes follow TraceData (see rangeFieldNames)
+
+namespace {
+
+enum BuiltinColumn {
+    kFfid, kChan, kCdp, kSource, kSouX, kSouY, kSouElev,
+    kRecX, kRecY, kRecElev, kCdpX, kCdpY, kIline, kXline
+};
+
+} // namespace
+
+RangeMap computeHeaderRanges(const HeaderColumns& columns) {
+    RangeMap ranges;
+    if (columns.num_traces() == 0) return ranges;
+
+    // Block min/max are exact: no values are decoded
+    const auto& names = rangeFieldNames();
+    for (size_t c = 0; c < HeaderColumns::kBuiltinColumns; ++c) {
+        const CompressedColumn& column = columns.column(c);
+        Range range(column.block(0).min_val, column.block(0).max_val);
+        for (size_t b = 1; b < column.num_blocks(); ++b) {
+            range.min_val = std::min(range.min_val, column.block(b).min_val);
+            range.max_val = std::max(range.max_val, column.block(b).max_val);
+        }
+        ranges[names[c]] = range;
+    }
+    return ranges;
+}
+
+std::vector<SourceInfo> uniqueSources(const HeaderColumns& columns, std::pmr::memory_resource* memory) {
+    if (columns.num_traces() == 0) return {};
+    const BuiltinColumn fields[] = {kFfid, kSource, kSouX, kSouY, kSouElev};
+    int32_t values[5][kHeaderBlockSize];
+    std::vector<SourceRun> runs;
+
+    auto push = [&runs](int32_t ffid, int32_t source, int32_t x, int32_t y, int32_t elev, uint64_t count) {
+        if (!runs.empty()) {
+            SourceRun& last = runs.back();
+            if (last.sou_x == x && last.sou_y == y && last.ffid == ffid && last.source == source && last.sou_elev == elev) {
+                last.num_traces += count;
+                return;
+            }
+        }
+        runs.push_back(SourceRun{ffid, source, x, y, elev, count});
+    };
+
+    for (size_t b = 0; b < columns.num_blocks(); ++b) {
+        const size_t n = columns.column(kSouX).blockRows(b);
+        bool constant = true;
+        for (BuiltinColumn field : fields) {
+            constant = constant && columns.column(field).constant(b);
+        }
+        // Весь блок - один и тот же источник (все каналы одного ПВ)
+        if (constant) {
+            push(columns.column(kFfid).block(b).min_val, columns.column(kSource).block(b).min_val,
+                 columns.column(kSouX).block(b).min_val, columns.column(kSouY).block(b).min_val,
+                 columns.column(kSouElev).block(b).min_val, n);
+            continue;
+        }
+        for (size_t f = 0; f < 5; ++f) {
+            columns.column(fields[f]).decodeBlock(b, values[f]);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            push(values[0][i], values[1][i], values[2][i], values[3][i], values[4][i], 1);
+        }
+    }
+    return uniqueSources(runs, memory);
+}
+
+std::vector<ReceiverInfo> uniqueReceivers(const HeaderColumns& columns, std::pmr::memory_resource* memory) {
+    if (columns.num_traces() == 0) return {};
+    std::pmr::map<std::pair<int32_t, int32_t>, int32_t> unique_receivers(memory); // (x, y) -> max_elevation
+    int32_t xs[kHeaderBlockSize], ys[kHeaderBlockSize], elevs[kHeaderBlockSize];
+
+    auto last = unique_receivers.end();
+    auto add = [&](int32_t x, int32_t y, int32_t elev) {
+        auto key = std::make_pair(x, y);
+        if (last == unique_receivers.end() || last->first != key) {
+            last = unique_receivers.emplace(key, elev).first;
+        }
+        last->second = std::max(last->second, elev);
+    };
+
+    const CompressedColumn& rec_x = columns.column(kRecX);
+    const CompressedColumn& rec_y = columns.column(kRecY);
+    const CompressedColumn& rec_elev = columns.column(kRecElev);
+    for (size_t b = 0; b < columns.num_blocks(); ++b) {
+        // Один приемник на весь блок: максимум высоты известен без декодирования
+        if (rec_x.constant(b) && rec_y.constant(b)) {
+            add(rec_x.block(b).min_val, rec_y.block(b).min_val, rec_elev.block(b).max_val);
+            continue;
+        }
+        const size_t n = rec_x.decodeBlock(b, xs);
+        rec_y.decodeBlock(b, ys);
+        rec_elev.decodeBlock(b, elevs);
+        for (size_t i = 0; i < n; ++i) {
+            add(xs[i], ys[i], elevs[i]);
+        }
+    }
+
+    std::vector<ReceiverInfo> receivers;
+    receivers.reserve(unique_receivers.size());
+    for (const auto& receiver : unique_receivers) {
+        ReceiverInfo info;
+        info.rec_x = receiver.first.first;
+        info.rec_y = receiver.first.second;
+        info.rec_elev = receiver.second;
+        receivers.push_back(info);
+    }
+    return receivers;
+}
+
+std::vector<CdpInfo> uniqueCdps(const HeaderColumns& columns, std::pmr::memory_resource* memory) {
+    if (columns.num_traces() == 0) return {};
+    std::pmr::map<std::pair<int32_t, int32_t>, std::tuple<int32_t, int32_t, int32_t>> unique_cdps(memory); // (x, y) -> (cdp_number, iline, xline)
+    int32_t xs[kHeaderBlockSize], ys[kHeaderBlockSize];
+    int32_t numbers[kHeaderBlockSize], ilines[kHeaderBlockSize], xlines[kHeaderBlockSize];
+
+    const CompressedColumn& cdp_x = columns.column(kCdpX);
+    const CompressedColumn& cdp_y = columns.column(kCdpY);
+    std::pair<int32_t, int32_t> last_key;
+    bool has_last = false;
+    for (size_t b = 0; b < columns.num_blocks(); ++b) {
+        const size_t first_row = b * kHeaderBlockSize;
+        // Одна CDP на весь блок: важна только первая трасса
+        if (cdp_x.constant(b) && cdp_y.constant(b)) {
+            auto key = std::make_pair(cdp_x.block(b).min_val, cdp_y.block(b).min_val);
+            if (!has_last || key != last_key) {
+                unique_cdps.emplace(key, std::make_tuple(columns.column(kCdp).at(first_row),
+                                                         columns.column(kIline).at(first_row),
+                                                         columns.column(kXline).at(first_row)));
+                last_key = key;
+                has_last = true;
+            }
+            continue;
+        }
+        const size_t n = cdp_x.decodeBlock(b, xs);
+        cdp_y.decodeBlock(b, ys);
+        columns.column(kCdp).decodeBlock(b, numbers);
+        columns.column(kIline).decodeBlock(b, ilines);
+        columns.column(kXline).decodeBlock(b, xlines);
+        for (size_t i = 0; i < n; ++i) {
+            auto key = std::make_pair(xs[i], ys[i]);
+            if (has_last && key == last_key) continue;
+            unique_cdps.emplace(key, std::make_tuple(numbers[i], ilines[i], xlines[i]));
+            last_key = key;
+            has_last = true;
+        }
+    }
+
+    std::vector<CdpInfo> cdps;
+    cdps.reserve(unique_cdps.size());
+    for (const auto& cdp : unique_cdps) {
+        CdpInfo info;
+        info.cdp_x = cdp.first.first;
+        info.cdp_y = cdp.first.second;
+        auto& [cdp_num, iline, xline] = cdp.second;
+        info.cdp = cdp_num;
+        info.iline = iline;
+        info.xline = xline;
+        cdps.push_back(info);
+    }
+    return cdps;
+}
@@ -0,0 +1,94 @@
+#ifndef HEADERCOLUMNS_H
+#define HEADERCOLUMNS_H
+
+// Compressed resident trace headers.
+// Decoded headers cost 56 bytes per trace as TraceData rows, but most columns barely
+// change from trace to trace: channel numbers step by one, FFID is constant over a shot
+// and coordinates move by small deltas. Each column is stored in blocks of
+// kHeaderBlockSize values, either as offsets from the block minimum (frame of reference)
+// or as differences between neighbours, bit-packed to the narrowest width. A few values
+// outside that width (the channel reset at a shot boundary) are stored as exceptions,
+// so they do not widen the whole block. Blocks keep their min/max, so ranges need no
+// decoding and constant blocks are handled whole.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct TraceData;
+
+const size_t kHeaderBlockSize = 1024;
+
+struct ColumnBlock {
+    int32_t min_val;
+    int32_t max_val;
+    int32_t first;            // first value of the block
+    int32_t reference;        // packed values are offsets from it: of the values, or of neighbour differences (delta)
+    uint64_t offset;          // first byte of the packed values in the column payload
+    uint32_t exceptions;      // first exception of the block in the column exception lists
+    uint16_t num_exceptions;
+    uint8_t width;            // bits per packed value, 0..32
+    bool delta;
+};
+
+class CompressedColumn {
+public:
+    CompressedColumn() = default;
+    // column[i * stride] is the value of row i
+    CompressedColumn(const int32_t* column, size_t count, size_t stride = 1);
+
+    size_t size() const { return count_; }
+    size_t num_blocks() const { return blocks_.size(); }
+    const ColumnBlock& block(size_t index) const { return blocks_[index]; }
+    // A block of one repeated value: min_val is every value in it
+    bool constant(size_t index) const { return blocks_[index].min_val == blocks_[index].max_val; }
+    size_t blockRows(size_t index) const;
+
+    // Writes the values of one block to out (up to kHeaderBlockSize); returns the row count
+    size_t decodeBlock(size_t index, int32_t* out) const;
+    int32_t at(size_t row) const;
+    size_t memoryBytes() const;
+
+private:
+    friend class HeaderColumns;
+    // Appends the next block of n rows (all blocks but the last are full)
+    void appendBlock(const int32_t* column, size_t n, size_t stride);
+    void shrink();
+
+    size_t count_ = 0;
+    std::vector<ColumnBlock> blocks_;
+    std::vector<uint8_t> payload_;  // padded by 8 bytes for unaligned 64-bit loads
+    std::vector<uint16_t> exception_slots_;   // packed value index within the block
+    std::vector<uint32_t> exception_values_;  // value or difference, modulo 2^32
+};
+
+/**
+ * Trace headers of one file as compressed columns: the 14 TraceData fields in
+ * rangeFieldNames() order, followed by the custom fields.
+ */
+class HeaderColumns {
+public:
+    static const size_t kBuiltinColumns = 14;
+
+    HeaderColumns() = default;
+    // custom_values: traces x num_custom, row-major (FileScanResult::custom_values)
+    explicit HeaderColumns(const std::vector<TraceData>& traces,
+                           const std::vector<int32_t>& custom_values = std::vector<int32_t>(),
+                           size_t num_custom = 0);
+
+    size_t num_traces() const { return num_traces_; }
+    size_t num_blocks() const { return (num_traces_ + kHeaderBlockSize - 1) / kHeaderBlockSize; }
+    size_t num_columns() const { return columns_.size(); }
+    const CompressedColumn& column(size_t index) const { return columns_[index]; }
+
+    // Rows of one block as TraceData; returns the row count
+    size_t decodeBlock(size_t block, TraceData* rows) const;
+    std::vector<TraceData> decode() const;
+    size_t memoryBytes() const;
+
+private:
+    size_t num_traces_ = 0;
+    std::vector<CompressedColumn> columns_;
+};
+
+#endif // HEADERCOLUMNS_H
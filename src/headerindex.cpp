@@ -0,0 +1,349 @@
+#include "headerindex.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+
+const char kMagic[8] = {'S', 'S', 'H', 'I', 'D', 'X', '0', '1'};
+const uint32_t kVersion = 1;
+
+// Arrays are converted in chunks of this many elements
+const size_t kChunkElements = 1u << 16;
+
+// Little-endian encoding independent of the host
+template <typename T>
+void storeLE(char* dst, T value) {
+    auto bits = static_cast<typename std::make_unsigned<T>::type>(value);
+    for (size_t i = 0; i < sizeof(T); ++i) dst[i] = static_cast<char>((bits >> (8 * i)) & 0xFF);
+}
+
+template <typename T>
+T loadLE(const char* src) {
+    typename std::make_unsigned<T>::type bits = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        bits |= static_cast<typename std::make_unsigned<T>::type>(static_cast<uint8_t>(src[i])) << (8 * i);
+    }
+    return static_cast<T>(bits);
+}
+
+template <typename T>
+void writeScalar(std::ofstream& out, T value) {
+    char bytes[sizeof(T)];
+    storeLE(bytes, value);
+    out.write(bytes, sizeof(T));
+}
+
+template <typename T>
+void writeArray(std::ofstream& out, const std::vector<T>& values) {
+    std::vector<char> buffer(std::min(values.size(), kChunkElements) * sizeof(T));
+    for (size_t start = 0; start < values.size(); start += kChunkElements) {
+        size_t count = std::min(kChunkElements, values.size() - start);
+        for (size_t i = 0; i < count; ++i) storeLE(buffer.data() + i * sizeof(T), values[start + i]);
+        out.write(buffer.data(), static_cast<std::streamsize>(count * sizeof(T)));
+    }
+}
+
+struct IndexFile {
+    std::ifstream in;
+    std::string path;
+    HeaderIndex index;         // field, num_traces, values and offsets
+    uint64_t num_entries = 0;
+    std::streamoff traces_pos = 0;
+
+    [[noreturn]] void corrupt() const {
+        throw std::runtime_error("Corrupt header index file: " + path);
+    }
+
+    template <typename T>
+    T scalar() {
+        char bytes[sizeof(T)];
+        in.read(bytes, sizeof(T));
+        if (in.gcount() != static_cast<std::streamsize>(sizeof(T))) corrupt();
+        return loadLE<T>(bytes);
+    }
+
+    template <typename T>
+    void array(std::vector<T>& values, uint64_t count) {
+        values.resize(count);
+        std::vector<char> buffer(std::min<uint64_t>(count, kChunkElements) * sizeof(T));
+        for (uint64_t start = 0; start < count; start += kChunkElements) {
+            size_t n = static_cast<size_t>(std::min<uint64_t>(kChunkElements, count - start));
+            in.read(buffer.data(), static_cast<std::streamsize>(n * sizeof(T)));
+            if (in.gcount() != static_cast<std::streamsize>(n * sizeof(T))) corrupt();
+            for (size_t i = 0; i < n; ++i) values[start + i] = loadLE<T>(buffer.data() + i * sizeof(T));
+        }
+    }
+
+    // Header and value directory; the trace list stays on disk
+    explicit IndexFile(const std::string& file_path) : in(file_path, std::ios::binary), path(file_path) {
+        if (!in.is_open()) {
+            throw std::runtime_error("Cannot open header index file: " + path);
+        }
+        in.seekg(0, std::ios::end);
+        const uint64_t file_size = static_cast<uint64_t>(in.tellg());
+        in.seekg(0);
+
+        char magic[sizeof(kMagic)];
+        in.read(magic, sizeof(magic));
+        if (in.gcount() != sizeof(magic) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+            throw std::runtime_error("Not a header index file: " + path);
+        }
+        uint32_t version = scalar<uint32_t>();
+        if (version != kVersion) {
+            throw std::runtime_error("Unsupported header index version " + std::to_string(version) + ": " + path);
+        }
+        uint32_t name_size = scalar<uint32_t>();
+        if (name_size > 1024) corrupt();
+        index.field.resize(name_size);
+        in.read(&index.field[0], name_size);
+        if (in.gcount() != static_cast<std::streamsize>(name_size)) corrupt();
+
+        index.num_traces = scalar<uint64_t>();
+        uint64_t num_values = scalar<uint64_t>();
+        num_entries = scalar<uint64_t>();
+        // Sizes checked against the file before reserving memory
+        const uint64_t header_size = static_cast<uint64_t>(in.tellg());
+        if (num_values > file_size / 12 || num_entries > file_size / 4 ||
+            header_size + num_values * 4 + (num_values + 1) * 8 + num_entries * 4 != file_size) {
+            corrupt();
+        }
+
+        array(index.values, num_values);
+        array(index.offsets, num_values + 1);
+        if (index.offsets.front() != 0 || index.offsets.back() != num_entries) corrupt();
+        traces_pos = in.tellg();
+    }
+
+    // Traces of the value slots [first_slot, last_slot)
+    std::vector<uint32_t> traces(size_t first_slot, size_t last_slot) {
+        std::vector<uint32_t> result;
+        uint64_t begin = index.offsets[first_slot];
+        uint64_t end = index.offsets[last_slot];
+        if (end < begin) corrupt();
+        in.seekg(traces_pos + static_cast<std::streamoff>(begin * 4));
+        array(result, end - begin);
+        return result;
+    }
+};
+
+// Value slots [first, last) with lo <= value <= hi
+std::pair<size_t, size_t> valueSlots(const std::vector<int32_t>& values, int32_t lo, int32_t hi) {
+    if (lo > hi) return {0, 0};
+    size_t first = std::lower_bound(values.begin(), values.end(), lo) - values.begin();
+    size_t last = std::upper_bound(values.begin(), values.end(), hi) - values.begin();
+    return {first, std::max(first, last)};
+}
+
+std::string upper(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    return s;
+}
+
+int32_t parseInt32(const std::string& text, const std::string& predicate) {
+    try {
+        size_t pos = 0;
+        long long value = std::stoll(text, &pos);
+        if (pos != text.size() || value < INT32_MIN || value > INT32_MAX) throw std::out_of_range(text);
+        return static_cast<int32_t>(value);
+    } catch (const std::exception&) {
+        throw std::invalid_argument("Invalid value in predicate: " + predicate);
+    }
+}
+
+} // namespace
+
+IndexPredicate parseIndexPredicate(const std::string& text) {
+    size_t eq = text.find('=');
+    if (eq == std::string::npos || eq == 0 || eq + 1 >= text.size()) {
+        throw std::invalid_argument("Predicate must be FIELD=VALUE or FIELD=LO-HI: " + text);
+    }
+    IndexPredicate predicate;
+    predicate.field = text.substr(0, eq);
+    std::string range = text.substr(eq + 1);
+    // The separator is the first '-' after the (possibly negative) lower bound
+    size_t dash = range.find('-', 1);
+    if (dash == std::string::npos) {
+        predicate.lo = predicate.hi = parseInt32(range, text);
+    } else {
+        predicate.lo = parseInt32(range.substr(0, dash), text);
+        predicate.hi = parseInt32(range.substr(dash + 1), text);
+    }
+    if (predicate.lo > predicate.hi) {
+        throw std::invalid_argument("Empty range in predicate: " + text);
+    }
+    return predicate;
+}
+
+std::string canonicalIndexField(const std::string& name, const std::vector<std::string>& available) {
+    std::string key = upper(name);
+    if (key == "ILINE_3D") key = "ILINE";
+    else if (key == "CROSSLINE_3D") key = "XLINE";
+    else if (key == "CHANNEL") key = "CHAN";
+    for (const auto& field : available) {
+        if (upper(field) == key) return field;
+    }
+    throw std::invalid_argument("Unknown header field: " + name);
+}
+
+HeaderIndex buildHeaderIndex(const std::string& field, const int32_t* column, size_t num_traces, size_t stride) {
+    if (num_traces > UINT32_MAX) {
+        throw std::runtime_error("Header index supports up to 2^32 traces per file");
+    }
+    HeaderIndex index;
+    index.field = field;
+    index.num_traces = num_traces;
+
+    bool ascending = true;
+    for (size_t i = 1; i < num_traces && ascending; ++i) {
+        ascending = column[(i - 1) * stride] <= column[i * stride];
+    }
+
+    index.traces.resize(num_traces);
+    if (ascending) {
+        // Sorted by this field (FFID in shot order, ILINE in a 3D cube): runs are the slots
+        for (size_t i = 0; i < num_traces; ++i) {
+            index.traces[i] = static_cast<uint32_t>(i);
+            int32_t value = column[i * stride];
+            if (i == 0 || value != index.values.back()) {
+                index.values.push_back(value);
+                index.offsets.push_back(i);
+            }
+        }
+        index.offsets.push_back(num_traces);
+        return index;
+    }
+
+    int32_t min_value = column[0], max_value = column[0];
+    for (size_t i = 1; i < num_traces; ++i) {
+        min_value = std::min(min_value, column[i * stride]);
+        max_value = std::max(max_value, column[i * stride]);
+    }
+    const uint64_t span = static_cast<uint64_t>(static_cast<int64_t>(max_value) - min_value) + 1;
+    if (span <= std::max<uint64_t>(num_traces, 1u << 16)) {
+        // Compact value range (channels, lines, FFIDs): count directly by value, no sort
+        std::vector<uint64_t> counts(span + 1, 0);
+        for (size_t i = 0; i < num_traces; ++i) {
+            counts[static_cast<uint64_t>(static_cast<int64_t>(column[i * stride]) - min_value) + 1]++;
+        }
+        for (uint64_t v = 0; v < span; ++v) {
+            if (counts[v + 1] > 0) index.values.push_back(static_cast<int32_t>(min_value + static_cast<int64_t>(v)));
+            counts[v + 1] += counts[v];
+        }
+        for (size_t i = 0; i < num_traces; ++i) {
+            index.traces[counts[static_cast<uint64_t>(static_cast<int64_t>(column[i * stride]) - min_value)]++] =
+                static_cast<uint32_t>(i);
+        }
+        // After the fill counts[v] is the end of value v's slot
+        index.offsets.push_back(0);
+        for (uint64_t v = 0; v < span; ++v) {
+            if (counts[v] > index.offsets.back()) index.offsets.push_back(counts[v]);
+        }
+        return index;
+    }
+
+    // Distinct values, then a counting sort of trace indices into their value slots
+    index.values.resize(num_traces);
+    for (size_t i = 0; i < num_traces; ++i) index.values[i] = column[i * stride];
+    std::sort(index.values.begin(), index.values.end());
+    index.values.erase(std::unique(index.values.begin(), index.values.end()), index.values.end());
+    index.values.shrink_to_fit();
+
+    std::vector<uint32_t> slots(num_traces);
+    index.offsets.assign(index.values.size() + 1, 0);
+    size_t slot = 0;
+    for (size_t i = 0; i < num_traces; ++i) {
+        int32_t value = column[i * stride];
+        // Neighbouring traces usually share the value: skip the binary search
+        if (index.values[slot] != value) {
+            slot = std::lower_bound(index.values.begin(), index.values.end(), value) - index.values.begin();
+        }
+        slots[i] = static_cast<uint32_t>(slot);
+        index.offsets[slot + 1]++;
+    }
+    for (size_t s = 1; s < index.offsets.size(); ++s) {
+        index.offsets[s] += index.offsets[s - 1];
+    }
+    std::vector<uint64_t> cursor(index.offsets.begin(), index.offsets.end() - 1);
+    for (size_t i = 0; i < num_traces; ++i) {
+        index.traces[cursor[slots[i]]++] = static_cast<uint32_t>(i);
+    }
+    return index;
+}
+
+std::vector<uint32_t> queryHeaderIndex(const HeaderIndex& index, int32_t lo, int32_t hi) {
+    auto slots = valueSlots(index.values, lo, hi);
+    std::vector<uint32_t> result(index.traces.begin() + index.offsets[slots.first],
+                                 index.traces.begin() + index.offsets[slots.second]);
+    if (slots.second - slots.first > 1) std::sort(result.begin(), result.end());
+    return result;
+}
+
+void writeHeaderIndex(const std::string& path, const HeaderIndex& index) {
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("Cannot create file: " + tmp_path);
+        }
+        out.write(kMagic, sizeof(kMagic));
+        writeScalar<uint32_t>(out, kVersion);
+        writeScalar<uint32_t>(out, static_cast<uint32_t>(index.field.size()));
+        out.write(index.field.data(), static_cast<std::streamsize>(index.field.size()));
+        writeScalar<uint64_t>(out, index.num_traces);
+        writeScalar<uint64_t>(out, index.values.size());
+        writeScalar<uint64_t>(out, index.traces.size());
+        writeArray(out, index.values);
+        writeArray(out, index.offsets);
+        writeArray(out, index.traces);
+        if (!out) {
+            throw std::runtime_error("Failed to write file: " + tmp_path);
+        }
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Cannot rename " + tmp_path + " to " + path + ": " + std::strerror(errno));
+    }
+}
+
+HeaderIndex readHeaderIndex(const std::string& path) {
+    IndexFile file(path);
+    file.index.traces = file.traces(0, file.index.values.size());
+    return std::move(file.index);
+}
+
+std::vector<uint32_t> queryHeaderIndexFile(const std::string& path, int32_t lo, int32_t hi) {
+    IndexFile file(path);
+    auto slots = valueSlots(file.index.values, lo, hi);
+    std::vector<uint32_t> result = file.traces(slots.first, slots.second);
+    if (slots.second - slots.first > 1) std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::string headerIndexFileName(const std::string& filename, const std::string& field) {
+    return filename + "." + field + ".idx";
+}
+
+std::vector<uint32_t> intersectTraces(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+    std::vector<uint32_t> result;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+    return result;
+}
+
+std::vector<TraceRange> traceRanges(const std::vector<uint32_t>& traces) {
+    std::vector<TraceRange> ranges;
+    for (uint32_t trace : traces) {
+        if (!ranges.empty() && ranges.back().first + ranges.back().count == trace) {
+            ranges.back().count++;
+        } else {
+            ranges.push_back(TraceRange{trace, 1});
+        }
+    }
+    return ranges;
+}
@@ -0,0 +1,59 @@
+#ifndef HEADERINDEX_H
+#define HEADERINDEX_H
+
+// Secondary indexes over trace header fields: each distinct value maps to the
+// traces holding it (CSR layout), so "FFID 1200-1300" or "ILINE 550" is answered
+// from a small persisted file instead of another pass over the SEG-Y file.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct HeaderIndex {
+    std::string field;
+    uint64_t num_traces = 0;
+    std::vector<int32_t> values;    // distinct values, ascending
+    std::vector<uint64_t> offsets;  // values.size() + 1 offsets into traces
+    std::vector<uint32_t> traces;   // 0-based trace indices grouped by value, ascending per value
+};
+
+// Consecutive traces [first, first + count)
+struct TraceRange {
+    uint64_t first;
+    uint64_t count;
+};
+
+// FIELD=VALUE or FIELD=LO-HI (values may be negative: "Sou_Elev=-20--5")
+struct IndexPredicate {
+    std::string field;
+    int32_t lo;
+    int32_t hi;
+};
+IndexPredicate parseIndexPredicate(const std::string& text);
+
+// Field name as stored (case-insensitive; ILINE_3D, CROSSLINE_3D and CHANNEL are
+// accepted for ILINE, XLINE and Chan). Throws std::invalid_argument if not in available.
+std::string canonicalIndexField(const std::string& name, const std::vector<std::string>& available);
+
+// column[i * stride] is the value of trace i. Trace numbers are 32-bit: throws
+// std::runtime_error for more than 2^32 traces (scanSegyFile skips the indexes instead).
+HeaderIndex buildHeaderIndex(const std::string& field, const int32_t* column, size_t num_traces, size_t stride = 1);
+
+// Traces with lo <= value <= hi, ascending
+std::vector<uint32_t> queryHeaderIndex(const HeaderIndex& index, int32_t lo, int32_t hi);
+
+// Persisted form; writes atomically (temporary file + rename)
+void writeHeaderIndex(const std::string& path, const HeaderIndex& index);
+HeaderIndex readHeaderIndex(const std::string& path);
+// Reads only the value directory and the matching slice of the trace list
+std::vector<uint32_t> queryHeaderIndexFile(const std::string& path, int32_t lo, int32_t hi);
+
+// "<file>.<FIELD>.idx"
+std::string headerIndexFileName(const std::string& filename, const std::string& field);
+
+// Both inputs ascending
+std::vector<uint32_t> intersectTraces(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b);
+// Ascending trace indices coalesced into ranges
+std::vector<TraceRange> traceRanges(const std::vector<uint32_t>& traces);
+
+#endif // HEADERINDEX_H
@@ -2,28 +2,108 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <cstdio>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
 #include "segyscanner.h"
+#include "profiler.h"
+#include "segyread/Kernels.hpp"
 
 void printUsage(const char* program_name) {
     std::cout << "Usage: " << program_name << " [options] <input_path>" << std::endl;
+    std::cout << "       " << program_name << " query <input_path> <FIELD=VALUE|FIELD=LO-HI>..." << std::endl;
     std::cout << "  input_path: Path to SEG-Y file or directory containing SEG-Y files" << std::endl;
-    std::cout << "              Supported extensions: .sgy, .segy" << std::endl;
+    std::cout << "              Supported extensions: .sgy, .segy, compressed as .gz, .zst or .zstd" << std::endl;
+    std::cout << "              (e.g. .sgy.gz); --sniff also accepts any other extension" << std::endl;
     std::cout << std::endl;
     std::cout << "Options:" << std::endl;
     std::cout << "  -sou        Generate source tables and maps" << std::endl;
     std::cout << "  -rec        Generate receiver tables and maps" << std::endl;
     std::cout << "  -cdp        Generate CDP tables and maps" << std::endl;
+    std::cout << "  --field <NAME:BYTE:WIDTH[:u][:scalar=BYTE]>" << std::endl;
+    std::cout << "              Scan an extra header field (repeatable); a built-in name such as" << std::endl;
+    std::cout << "              ILINE:221:4 moves that field to another byte location" << std::endl;
+    std::cout << "  --fields-file <file>" << std::endl;
+    std::cout << "              Read field definitions, one per line in --field syntax" << std::endl;
+    std::cout << "  --index <FIELD[,FIELD...]>" << std::endl;
+    std::cout << "              Persist secondary indexes of these fields (e.g. FFID,CDP,ILINE,XLINE,Chan)" << std::endl;
+    std::cout << "              to segyscan/index/ for the query subcommand" << std::endl;
+    std::cout << "  --gathers   Write <file>_gathers.txt: FFID or CDP ensembles with first trace and count" << std::endl;
+    std::cout << "  --tiles     Write zoomable map tiles and a browser viewer to segyscan/maps/tiles" << std::endl;
+    std::cout << "  --duplicates <headers|samples>" << std::endl;
+    std::cout << "              Find duplicate traces within and across files by their key header" << std::endl;
+    std::cout << "              fields, or header fields and sample bytes; writes dups.txt" << std::endl;
+    std::cout << "  --extract <out.sgy>" << std::endl;
+    std::cout << "              Copy the traces matching all --where predicates into a new SEG-Y" << std::endl;
+    std::cout << "              file with the textual and binary headers of the first input file" << std::endl;
+    std::cout << "  --where <FIELD=VALUE|FIELD=LO-HI>" << std::endl;
+    std::cout << "              Trace selection for --extract (repeatable, combined with AND)," << std::endl;
+    std::cout << "              e.g. --where FFID=1200-1300 --where Chan=1-48" << std::endl;
+    std::cout << "  --geometry  Compute offset, azimuth and CDP-vs-midpoint statistics" << std::endl;
+    std::cout << "  --midpoint-tol <value>" << std::endl;
+    std::cout << "              Midpoint error tolerance in coordinate units (default: 1, implies --geometry)" << std::endl;
+    std::cout << "  --offset-bin <value>" << std::endl;
+    std::cout << "              Offset histogram bin width (default: 100, implies --geometry)" << std::endl;
+    std::cout << "  -r, --recursive" << std::endl;
+    std::cout << "              Also scan SEG-Y files in subdirectories (walked in parallel)" << std::endl;
+    std::cout << "  --sniff     Accept files with any extension whose binary header and size" << std::endl;
+    std::cout << "              match a SEG-Y layout (e.g. .sgy.part or no extension)" << std::endl;
+    std::cout << "  --watch     Keep running and scan new files as they land in the directory" << std::endl;
+    std::cout << "              (top level only, cannot be combined with -r)" << std::endl;
+    std::cout << "  --watch-interval <sec>" << std::endl;
+    std::cout << "              Minimum time between info/ranges/maps updates (default: 5)" << std::endl;
+    std::cout << "  --shard <i>/<N>" << std::endl;
+    std::cout << "              Scan shard i (0-based) of N and write a partial result to" << std::endl;
+    std::cout << "              segyscan/partials/ instead of tables and maps" << std::endl;
+    std::cout << "  --merge     Combine all partial results into tables and maps" << std::endl;
+    std::cout << "  --direct-io Read headers with O_DIRECT, bypassing the page cache" << std::endl;
+    std::cout << "              (falls back to buffered reads where unsupported)" << std::endl;
+    std::cout << "  --progress <auto|bar|lines|off>" << std::endl;
+    std::cout << "              Header reading progress: bar with traces/s, MB/s and ETA, or" << std::endl;
+    std::cout << "              key=value lines for logs (default auto: bar on a terminal, lines otherwise)" << std::endl;
+    std::cout << "  --profile   Print per-stage timing, bytes read, traces and peak RSS" << std::endl;
+    std::cout << "  --profile-trace <file.json>" << std::endl;
+    std::cout << "              Also export a Chrome trace-event timeline (implies --profile)" << std::endl;
+    std::cout << "  --cpu-info  Show the CPU features and the kernels chosen for this machine" << std::endl;
+    std::cout << "              (SCANSEGY_ISA=generic|sse42|avx2|avx512 caps the level)" << std::endl;
     std::cout << "  -h, --help  Show this help message" << std::endl;
     std::cout << std::endl;
     std::cout << "  If no domain options are specified, all domains are generated." << std::endl;
     std::cout << "  Options can be combined: -sou -rec (sources and receivers only)" << std::endl;
     std::cout << std::endl;
+    std::cout << "Query:" << std::endl;
+    std::cout << "  Prints the 0-based trace ranges of each file matching all predicates," << std::endl;
+    std::cout << "  e.g. query data/ FFID=1200-1300 Chan=1-48 after a scan with --index FFID,Chan." << std::endl;
+    std::cout << "  Every predicate field must have been indexed." << std::endl;
+    std::cout << std::endl;
     std::cout << "Output:" << std::endl;
     std::cout << "  Creates 'segyscan' directory with:" << std::endl;
     std::cout << "    - tables/: Statistical tables for each file" << std::endl;
     std::cout << "    - maps/: Scatter plots of selected domains" << std::endl;
 }
 
+void printCpuInfo() {
+    const CpuDispatchInfo info = cpuDispatchInfo();
+    auto join = [](const std::vector<std::string>& items) {
+        std::string text;
+        for (const auto& item : items) text += (text.empty() ? "" : " ") + item;
+        return text.empty() ? std::string("-") : text;
+    };
+    std::cout << "CPU:       " << (info.cpu.empty() ? "unknown" : info.cpu) << std::endl;
+    std::cout << "Features:  " << join(info.features) << std::endl;
+    std::cout << "Built:     " << join(info.built) << std::endl;
+    if (!info.requested.empty()) {
+        std::cout << "Requested: " << info.requested << " (SCANSEGY_ISA)" << std::endl;
+    }
+    std::cout << "Selected:  " << info.selected << std::endl;
+    std::cout << "Kernels:" << std::endl;
+    for (const auto& name : segyKernelNames()) {
+        std::cout << "  " << name << ": " << info.selected << std::endl;
+    }
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         std::cerr << "Error: Invalid number of arguments" << std::endl;
@@ -31,8 +111,37 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    if (std::string(argv[1]) == "query") {
+        if (argc < 4) {
+            std::cerr << "Error: query requires an input path and at least one predicate" << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        SegyScanner scanner;
+        return scanner.query(argv[2], std::vector<std::string>(argv + 3, argv + argc));
+    }
+    
     std::set<std::string> domains;
     std::string input_path;
+    SegyReaderOptions reader_options;
+    bool watch = false;
+    int watch_interval_ms = 5000;
+    bool merge = false;
+    uint32_t shard_index = 0;
+    uint32_t shard_count = 0;
+    bool profile = false;
+    std::string profile_trace_path;
+    std::vector<HeaderFieldSpec> header_fields;
+    bool geometry = false;
+    DiscoveryOptions discovery_options;
+    std::vector<std::string> index_fields;
+    bool gathers = false;
+    bool tiles = false;
+    DuplicateMode duplicate_mode = DuplicateMode::Off;
+    GeometryOptions geometry_options;
+    ProgressMode progress_mode = ProgressMode::Auto;
+    std::string extract_path;
+    std::vector<std::string> where;
     
     // Parse arguments
     for (int i = 1; i < argc; ++i) {
@@ -41,12 +150,143 @@ int main(int argc, char* argv[]) {
         if (arg == "-h" || arg == "--help") {
             printUsage(argv[0]);
             return 0;
+        } else if (arg == "--cpu-info") {
+            printCpuInfo();
+            return 0;
         } else if (arg == "-sou") {
             domains.insert("sou");
         } else if (arg == "-rec") {
             domains.insert("rec");
         } else if (arg == "-cdp") {
             domains.insert("cdp");
+        } else if (arg == "--field" || arg == "--fields-file") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a value" << std::endl;
+                return 1;
+            }
+            try {
+                if (arg == "--field") {
+                    header_fields.push_back(parseHeaderFieldSpec(argv[++i]));
+                } else {
+                    std::vector<HeaderFieldSpec> loaded = loadHeaderFieldSpecs(argv[++i]);
+                    header_fields.insert(header_fields.end(), loaded.begin(), loaded.end());
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return 1;
+            }
+        } else if (arg == "--index") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --index requires a list of fields" << std::endl;
+                return 1;
+            }
+            std::stringstream list(argv[++i]);
+            std::string field;
+            while (std::getline(list, field, ',')) {
+                if (!field.empty()) index_fields.push_back(field);
+            }
+        } else if (arg == "--gathers") {
+            gathers = true;
+        } else if (arg == "--tiles") {
+            tiles = true;
+        } else if (arg == "--duplicates") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --duplicates requires a mode (headers or samples)" << std::endl;
+                return 1;
+            }
+            try {
+                duplicate_mode = parseDuplicateMode(argv[++i]);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return 1;
+            }
+        } else if (arg == "--extract" || arg == "--where") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a value" << std::endl;
+                return 1;
+            }
+            if (arg == "--extract") {
+                extract_path = argv[++i];
+            } else {
+                where.push_back(argv[++i]);
+            }
+        } else if (arg == "--geometry") {
+            geometry = true;
+        } else if (arg == "--midpoint-tol" || arg == "--offset-bin") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << arg << " requires a value" << std::endl;
+                return 1;
+            }
+            double value = 0.0;
+            try {
+                value = std::stod(argv[++i]);
+            } catch (const std::exception&) {
+                value = -1.0;
+            }
+            if (value < 0.0 || (arg == "--offset-bin" && value == 0.0)) {
+                std::cerr << "Error: Invalid " << arg << " value: " << argv[i] << std::endl;
+                return 1;
+            }
+            (arg == "--midpoint-tol" ? geometry_options.midpoint_tolerance : geometry_options.offset_bin_width) = value;
+            geometry = true;
+        } else if (arg == "--watch") {
+            watch = true;
+        } else if (arg == "--watch-interval") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --watch-interval requires a value in seconds" << std::endl;
+                return 1;
+            }
+            double seconds = 0.0;
+            try {
+                seconds = std::stod(argv[++i]);
+            } catch (const std::exception&) {
+                seconds = -1.0;
+            }
+            // Checked before the cast: a value outside the int range would be undefined behaviour
+            if (!std::isfinite(seconds) || seconds < 0.0 || seconds > INT_MAX / 1000) {
+                std::cerr << "Error: Invalid --watch-interval value: " << argv[i] << std::endl;
+                return 1;
+            }
+            watch_interval_ms = static_cast<int>(seconds * 1000);
+        } else if (arg == "--shard") {
+            unsigned index = 0, count = 0;
+            char tail = 0;
+            if (i + 1 >= argc || std::sscanf(argv[i + 1], "%u/%u%c", &index, &count, &tail) != 2 ||
+                count == 0 || index >= count) {
+                std::cerr << "Error: --shard expects <i>/<N> with 0 <= i < N" << std::endl;
+                return 1;
+            }
+            ++i;
+            shard_index = index;
+            shard_count = count;
+        } else if (arg == "-r" || arg == "--recursive") {
+            discovery_options.recursive = true;
+        } else if (arg == "--sniff") {
+            discovery_options.any_extension = true;
+        } else if (arg == "--merge") {
+            merge = true;
+        } else if (arg == "--direct-io") {
+            reader_options.direct_io = true;
+        } else if (arg == "--progress") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --progress requires a mode (auto, bar, lines or off)" << std::endl;
+                return 1;
+            }
+            try {
+                progress_mode = parseProgressMode(argv[++i]);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return 1;
+            }
+        } else if (arg == "--profile") {
+            profile = true;
+        } else if (arg == "--profile-trace") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --profile-trace requires a file name" << std::endl;
+                return 1;
+            }
+            profile = true;
+            profile_trace_path = argv[++i];
         } else if (arg[0] != '-') {
             // This is the input path
             input_path = arg;
@@ -63,6 +303,50 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    if ((shard_count > 0) + merge + watch > 1) {
+        std::cerr << "Error: --shard, --merge and --watch are mutually exclusive" << std::endl;
+        return 1;
+    }
+    
+    if (watch && discovery_options.recursive) {
+        // inotify watches only the input directory: files landing in subdirectories would be missed
+        std::cerr << "Error: --watch cannot be combined with -r/--recursive" << std::endl;
+        return 1;
+    }
+    
+    if (duplicate_mode != DuplicateMode::Off && (shard_count > 0 || merge)) {
+        // Partials carry aggregates only, not the per-trace fingerprints
+        std::cerr << "Error: --duplicates cannot be combined with --shard or --merge" << std::endl;
+        return 1;
+    }
+    
+    if (!extract_path.empty() && (shard_count > 0 || merge || watch)) {
+        std::cerr << "Error: --extract cannot be combined with --shard, --merge or --watch" << std::endl;
+        return 1;
+    }
+    
+    if (extract_path.empty() != where.empty()) {
+        std::cerr << "Error: --extract and --where must be used together" << std::endl;
+        return 1;
+    }
+    
+    // Index and predicate field names as stored, checked once the custom fields are known
+    std::vector<IndexPredicate> extract_predicates;
+    try {
+        std::vector<std::string> available = headerFieldNames(header_fields);
+        for (auto& field : index_fields) {
+            field = canonicalIndexField(field, available);
+        }
+        for (const auto& text : where) {
+            IndexPredicate predicate = parseIndexPredicate(text);
+            predicate.field = canonicalIndexField(predicate.field, available);
+            extract_predicates.push_back(predicate);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    
     // If no domains specified, use all
     if (domains.empty()) {
         domains.insert("sou");
@@ -70,9 +354,45 @@ int main(int argc, char* argv[]) {
         domains.insert("cdp");
     }
     
+    if (profile) {
+        Profiler::instance().enable();
+    }
+    
     try {
         SegyScanner scanner;
-        return scanner.process(input_path, domains);
+        scanner.setReaderOptions(reader_options);
+        scanner.setHeaderFields(header_fields);
+        scanner.setDiscoveryOptions(discovery_options);
+        scanner.setIndexFields(index_fields);
+        scanner.setGathers(gathers);
+        scanner.setTiles(tiles);
+        scanner.setDuplicateMode(duplicate_mode);
+        scanner.setProgressMode(progress_mode);
+        if (!extract_path.empty()) {
+            scanner.setExtract(extract_path, extract_predicates);
+        }
+        if (geometry) {
+            scanner.setGeometryOptions(geometry_options);
+        }
+        int status;
+        if (shard_count > 0) {
+            status = scanner.processShard(input_path, domains, shard_index, shard_count);
+        } else if (merge) {
+            status = scanner.mergeShards(input_path, domains);
+        } else if (watch) {
+            status = scanner.watch(input_path, domains, watch_interval_ms);
+        } else {
+            status = scanner.process(input_path, domains);
+        }
+        
+        if (profile) {
+            Profiler::instance().printSummary(std::cout);
+            if (!profile_trace_path.empty()) {
+                Profiler::instance().writeChromeTrace(profile_trace_path);
+                std::cout << "Profile timeline written to " << profile_trace_path << std::endl;
+            }
+        }
+        return status;
     } catch (const std::exception& e) {
         std::cerr << "Fatal error: " << e.what() << std::endl;
         return 1;
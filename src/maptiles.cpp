@@ -0,0 +1,718 @@
+#include "maptiles.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+const char kTileMagic[4] = {'S', 'S', 'T', 'L'};
+const uint8_t kTileVersion = 1;
+const size_t kTileHeaderSize = 20;
+const uint64_t kLeafCapacity = static_cast<uint64_t>(kTileGrid) * kTileGrid;
+
+// Work below this many items per thread is not worth splitting
+const size_t kMinParallelItems = 1u << 16;
+
+// Aggregated grid cell: positions are relative to the pyramid origin
+struct Cell {
+    uint64_t key;    // Morton code of the cell
+    double sum_x;
+    double sum_y;
+    uint64_t count;
+};
+
+// Spreads the 32 bits of v over the even bits of the result
+uint64_t spreadBits(uint32_t v) {
+    uint64_t x = v;
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+    x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+    x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+    x = (x | (x << 2)) & 0x3333333333333333ull;
+    x = (x | (x << 1)) & 0x5555555555555555ull;
+    return x;
+}
+
+uint32_t compactBits(uint64_t x) {
+    x &= 0x5555555555555555ull;
+    x = (x | (x >> 1)) & 0x3333333333333333ull;
+    x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+    x = (x | (x >> 4)) & 0x00FF00FF00FF00FFull;
+    x = (x | (x >> 8)) & 0x0000FFFF0000FFFFull;
+    x = (x | (x >> 16)) & 0x00000000FFFFFFFFull;
+    return static_cast<uint32_t>(x);
+}
+
+// Shifts of 64 bits and more leave nothing (the whole extent in one tile)
+uint64_t shiftKey(uint64_t key, int shift) {
+    return shift >= 64 ? 0 : key >> shift;
+}
+
+int numThreads(size_t items) {
+#ifdef _OPENMP
+    return static_cast<int>(std::max<size_t>(1, std::min<size_t>(static_cast<size_t>(omp_get_max_threads()),
+                                                                   items / kMinParallelItems)));
+#else
+    (void)items;
+    return 1;
+#endif
+}
+
+int threadNum() {
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+// LSD radix sort by bytes. Each pass counts digits per thread slice and scatters the
+// slices in parallel; bytes that are equal in all keys (high bits of a small extent) are skipped.
+void radixSort(std::vector<uint64_t>& keys, uint64_t varying_bits) {
+    const size_t n = keys.size();
+    if (n < 2) return;
+    std::vector<uint64_t> buffer(n);
+    const int num_threads = numThreads(n);
+    std::vector<size_t> offsets(static_cast<size_t>(num_threads) * 256);
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        if (((varying_bits >> shift) & 0xFF) == 0) continue;
+        std::fill(offsets.begin(), offsets.end(), 0);
+
+        #pragma omp parallel num_threads(num_threads)
+        {
+            const int t = threadNum();
+            const size_t begin = n * t / num_threads;
+            const size_t end = n * (t + 1) / num_threads;
+            size_t* local = &offsets[static_cast<size_t>(t) * 256];
+            for (size_t i = begin; i < end; ++i) {
+                local[(keys[i] >> shift) & 0xFF]++;
+            }
+            #pragma omp barrier
+            #pragma omp single
+            {
+                // Digit-major, then thread order: the sort stays stable
+                size_t offset = 0;
+                for (size_t digit = 0; digit < 256; ++digit) {
+                    for (int k = 0; k < num_threads; ++k) {
+                        size_t count = offsets[static_cast<size_t>(k) * 256 + digit];
+                        offsets[static_cast<size_t>(k) * 256 + digit] = offset;
+                        offset += count;
+                    }
+                }
+            }
+            for (size_t i = begin; i < end; ++i) {
+                buffer[local[(keys[i] >> shift) & 0xFF]++] = keys[i];
+            }
+        }
+        keys.swap(buffer);
+    }
+}
+
+// Start of each of num_chunks slices of n sorted items, moved forward to the start of
+// a group (equal group(i)), so no group spans two slices
+template <typename Group>
+std::vector<size_t> groupAlignedSlices(size_t n, int num_chunks, Group group) {
+    std::vector<size_t> starts(static_cast<size_t>(num_chunks) + 1, n);
+    starts[0] = 0;
+    for (int c = 1; c < num_chunks; ++c) {
+        size_t start = std::max(n * c / num_chunks, starts[c - 1]);
+        while (start > 0 && start < n && group(start) == group(start - 1)) ++start;
+        starts[c] = start;
+    }
+    return starts;
+}
+
+// Merges runs of sorted cells whose keys agree after the shift. Slices count their
+// groups first, so each writes its merged cells straight to its place in the output.
+template <typename CellAt>
+std::vector<Cell> mergeCells(size_t n, int shift, CellAt cell_at) {
+    const int num_chunks = numThreads(n);
+    auto group = [&](size_t i) { return shiftKey(cell_at(i).key, shift); };
+    std::vector<size_t> starts = groupAlignedSlices(n, num_chunks, group);
+
+    std::vector<size_t> offsets(static_cast<size_t>(num_chunks) + 1, 0);
+    #pragma omp parallel for schedule(static) num_threads(num_chunks)
+    for (int c = 0; c < num_chunks; ++c) {
+        size_t groups = 0;
+        for (size_t i = starts[c]; i < starts[c + 1]; ++i) {
+            if (i == starts[c] || group(i) != group(i - 1)) ++groups;
+        }
+        offsets[c + 1] = groups;
+    }
+    for (int c = 0; c < num_chunks; ++c) offsets[c + 1] += offsets[c];
+
+    std::vector<Cell> cells(offsets[num_chunks]);
+    #pragma omp parallel for schedule(static) num_threads(num_chunks)
+    for (int c = 0; c < num_chunks; ++c) {
+        size_t next = offsets[c];
+        for (size_t i = starts[c]; i < starts[c + 1]; ++i) {
+            Cell cell = cell_at(i);
+            cell.key = shiftKey(cell.key, shift);
+            if (next > offsets[c] && cells[next - 1].key == cell.key) {
+                Cell& last = cells[next - 1];
+                last.sum_x += cell.sum_x;
+                last.sum_y += cell.sum_y;
+                last.count += cell.count;
+            } else {
+                cells[next++] = cell;
+            }
+        }
+    }
+    return cells;
+}
+
+// Largest number of sorted codes in one tile (codes equal after the shift)
+uint64_t maxTileOccupancy(const std::vector<uint64_t>& codes, int shift) {
+    uint64_t best = 0;
+    uint64_t run = 0;
+    for (size_t i = 0; i < codes.size(); ++i) {
+        run = (i > 0 && shiftKey(codes[i], shift) == shiftKey(codes[i - 1], shift)) ? run + 1 : 1;
+        best = std::max(best, run);
+    }
+    return best;
+}
+
+template <typename T>
+void putLE(std::vector<uint8_t>& out, size_t pos, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) out[pos + i] = static_cast<uint8_t>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF);
+}
+
+template <typename T>
+T getLE(const std::vector<uint8_t>& in, size_t pos) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) value |= static_cast<uint64_t>(in[pos + i]) << (8 * i);
+    return static_cast<T>(value);
+}
+
+// point_at(i) -> (qx, qy, count) for i in [0, n)
+template <typename PointAt>
+MapTile encodeTile(uint32_t tile_x, uint32_t tile_y, int level, size_t n, PointAt point_at) {
+    MapTile tile{tile_x, tile_y, static_cast<uint32_t>(n), {}};
+    tile.data.reserve(kTileHeaderSize + 5 * n);  // counts are mostly one byte
+    tile.data.resize(kTileHeaderSize + 4 * n);
+    std::memcpy(tile.data.data(), kTileMagic, sizeof(kTileMagic));
+    putLE<uint8_t>(tile.data, 4, kTileVersion);
+    putLE<uint8_t>(tile.data, 5, static_cast<uint8_t>(level));
+    putLE<uint16_t>(tile.data, 6, 0);
+    putLE<uint32_t>(tile.data, 8, tile_x);
+    putLE<uint32_t>(tile.data, 12, tile_y);
+    putLE<uint32_t>(tile.data, 16, static_cast<uint32_t>(n));
+
+    std::vector<uint64_t> counts(n);
+    for (size_t i = 0; i < n; ++i) {
+        uint16_t qx, qy;
+        point_at(i, qx, qy, counts[i]);
+        putLE<uint16_t>(tile.data, kTileHeaderSize + 4 * i, qx);
+        putLE<uint16_t>(tile.data, kTileHeaderSize + 4 * i + 2, qy);
+    }
+    for (uint64_t count : counts) {
+        do {
+            uint8_t byte = count & 0x7F;
+            count >>= 7;
+            tile.data.push_back(count ? (byte | 0x80) : byte);
+        } while (count);
+    }
+    return tile;
+}
+
+// Splits a level's sorted items into tiles and encodes them in parallel
+template <typename TileOf, typename EncodeRange>
+TileLevel encodeLevel(size_t n, TileOf tile_of, EncodeRange encode_range) {
+    std::vector<size_t> bounds;
+    for (size_t i = 0; i < n; ++i) {
+        if (i == 0 || tile_of(i) != tile_of(i - 1)) bounds.push_back(i);
+    }
+    bounds.push_back(n);
+
+    TileLevel level;
+    level.num_points = n;
+    level.tiles.resize(bounds.size() - 1);
+    #pragma omp parallel for schedule(dynamic, 4) if (n > kMinParallelItems)
+    for (long t = 0; t < static_cast<long>(level.tiles.size()); ++t) {
+        level.tiles[t] = encode_range(bounds[t], bounds[t + 1]);
+    }
+    return level;
+}
+
+// Offset within a tile in 1/65536 of the tile size; scale = 65536 / tile size
+uint16_t quantize(double offset, double scale) {
+    double q = std::floor(offset * scale);
+    return static_cast<uint16_t>(std::min(65535.0, std::max(0.0, q)));
+}
+
+// Leaf positions: the offset is a whole number of units, exact while the tile is at most
+// 65536 units wide (only a max_level cap leaves wider leaves, which drop the low bits)
+uint16_t quantizeUnits(uint32_t offset, int tile_bits) {
+    return static_cast<uint16_t>(tile_bits <= 16 ? offset << (16 - tile_bits) : offset >> (tile_bits - 16));
+}
+
+TileLayer buildLayer(const TileSource& source, const TilePyramid& pyramid, int max_level) {
+    TileLayer layer;
+    layer.name = source.name;
+    layer.num_positions = source.positions.size();
+    const size_t n = source.positions.size();
+    if (n == 0) return layer;
+    const int bits = pyramid.extent_bits;
+
+    // Morton codes relative to the origin; bits that differ between codes decide the radix passes
+    std::vector<uint64_t> codes(n);
+    uint64_t any_set = 0;
+    uint64_t all_set = ~0ull;
+    #pragma omp parallel for schedule(static) reduction(|:any_set) reduction(&:all_set) if (n > kMinParallelItems)
+    for (long i = 0; i < static_cast<long>(n); ++i) {
+        const Coord& p = source.positions[i];
+        uint64_t code = spreadBits(static_cast<uint32_t>(p.x - pyramid.origin_x)) |
+                        (spreadBits(static_cast<uint32_t>(p.y - pyramid.origin_y)) << 1);
+        codes[i] = code;
+        any_set |= code;
+        all_set &= code;
+    }
+    radixSort(codes, any_set ^ all_set);
+
+    // Distinct positions with their multiplicity (a position may repeat across files)
+    std::vector<uint64_t> counts;
+    {
+        size_t unique = 0;
+        counts.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            if (unique > 0 && codes[unique - 1] == codes[i]) {
+                counts.back()++;
+            } else {
+                codes[unique++] = codes[i];
+                counts.push_back(1);
+            }
+        }
+        codes.resize(unique);
+        codes.shrink_to_fit();
+    }
+
+    // A leaf tile must be at most 65536 units wide for its u16 offsets to be exact positions
+    int leaf = std::min(max_level, std::max(0, bits - 16));
+    while (leaf < max_level && maxTileOccupancy(codes, 2 * (bits - leaf)) > kLeafCapacity) ++leaf;
+    layer.levels.resize(static_cast<size_t>(leaf) + 1);
+
+    // Leaf: exact positions
+    {
+        const int tile_bits = bits - leaf;
+        layer.levels[leaf] = encodeLevel(
+            codes.size(), [&](size_t i) { return shiftKey(codes[i], 2 * tile_bits); },
+            [&](size_t begin, size_t end) {
+                const uint64_t tile_key = shiftKey(codes[begin], 2 * tile_bits);
+                const uint32_t tile_x = compactBits(tile_key);
+                const uint32_t tile_y = compactBits(tile_key >> 1);
+                // Offsets within the tile are the low tile_bits bits of the coordinates
+                const uint32_t mask = tile_bits >= 32 ? 0xFFFFFFFFu : (1u << tile_bits) - 1;
+                return encodeTile(tile_x, tile_y, leaf, end - begin, [&](size_t k, uint16_t& qx, uint16_t& qy, uint64_t& count) {
+                    const uint64_t code = codes[begin + k];
+                    qx = quantizeUnits(compactBits(code) & mask, tile_bits);
+                    qy = quantizeUnits(compactBits(code >> 1) & mask, tile_bits);
+                    count = counts[begin + k];
+                });
+            });
+    }
+
+    // Aggregated levels, each merged from the next finer one
+    std::vector<Cell> cells;
+    int cells_shift = 0;  // cell size of `cells` is 2^cells_shift units
+    for (int z = leaf - 1; z >= 0; --z) {
+        const int tile_bits = bits - z;
+        const int cell_bits = std::max(0, tile_bits - 8);
+        if (z == leaf - 1) {
+            cells = mergeCells(codes.size(), 2 * cell_bits, [&](size_t i) {
+                const double c = static_cast<double>(counts[i]);
+                return Cell{codes[i], compactBits(codes[i]) * c, compactBits(codes[i] >> 1) * c, counts[i]};
+            });
+        } else {
+            std::vector<Cell> finer;
+            finer.swap(cells);
+            cells = mergeCells(finer.size(), 2 * (cell_bits - cells_shift), [&](size_t i) { return finer[i]; });
+        }
+        cells_shift = cell_bits;
+
+        const double tile_size = std::ldexp(1.0, tile_bits);
+        const double scale = std::ldexp(1.0, 16 - tile_bits);
+        layer.levels[z] = encodeLevel(
+            cells.size(), [&](size_t i) { return shiftKey(cells[i].key, 2 * (tile_bits - cell_bits)); },
+            [&](size_t begin, size_t end) {
+                const uint64_t tile_key = shiftKey(cells[begin].key, 2 * (tile_bits - cell_bits));
+                const uint32_t tile_x = compactBits(tile_key);
+                const uint32_t tile_y = compactBits(tile_key >> 1);
+                return encodeTile(tile_x, tile_y, z, end - begin, [&](size_t k, uint16_t& qx, uint16_t& qy, uint64_t& count) {
+                    const Cell& cell = cells[begin + k];
+                    const double c = static_cast<double>(cell.count);
+                    qx = quantize(cell.sum_x / c - tile_x * tile_size, scale);
+                    qy = quantize(cell.sum_y / c - tile_y * tile_size, scale);
+                    count = cell.count;
+                });
+            });
+    }
+    return layer;
+}
+
+void writeFile(const std::string& path, const std::string& content) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot create file: " + path);
+    }
+    out << content;
+    if (!out) {
+        throw std::runtime_error("Failed to write file: " + path);
+    }
+}
+
+std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+std::string tilesJson(const TilePyramid& pyramid) {
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"format\": \"SSTL\",\n"
+         << "  \"version\": " << static_cast<int>(kTileVersion) << ",\n"
+         << "  \"origin_x\": " << pyramid.origin_x << ",\n"
+         << "  \"origin_y\": " << pyramid.origin_y << ",\n"
+         << "  \"max_x\": " << pyramid.max_x << ",\n"
+         << "  \"max_y\": " << pyramid.max_y << ",\n"
+         << "  \"extent_bits\": " << pyramid.extent_bits << ",\n"
+         << "  \"grid\": " << kTileGrid << ",\n"
+         << "  \"layers\": [";
+    for (size_t l = 0; l < pyramid.layers.size(); ++l) {
+        const TileLayer& layer = pyramid.layers[l];
+        json << (l ? "," : "") << "\n    {\"name\": \"" << jsonEscape(layer.name) << "\", \"positions\": " << layer.num_positions
+             << ", \"levels\": [";
+        for (size_t z = 0; z < layer.levels.size(); ++z) {
+            const TileLevel& level = layer.levels[z];
+            // Tile list as flat [x0, y0, x1, y1, ...]: the viewer requests only existing tiles
+            json << (z ? "," : "") << "\n      {\"points\": " << level.num_points << ", \"tiles\": [";
+            for (size_t t = 0; t < level.tiles.size(); ++t) {
+                json << (t ? "," : "") << level.tiles[t].x << "," << level.tiles[t].y;
+            }
+            json << "]}";
+        }
+        json << "\n    ]}";
+    }
+    json << "\n  ]\n}\n";
+    return json.str();
+}
+
+// Static viewer: canvas with pan (drag) and zoom (wheel), loads the visible tiles of tiles.json
+const char* kViewerHtml = R"HTML(<!DOCTYPE html>
+<html>
+<head>
+<meta charset="utf-8">
+<title>segyscan survey map</title>
+<style>
+html, body { margin: 0; height: 100%; overflow: hidden; font: 13px sans-serif; }
+canvas { display: block; width: 100%; height: 100%; background: #fff; cursor: grab; }
+#panel { position: absolute; top: 8px; right: 8px; background: rgba(255,255,255,0.9); border: 1px solid #ccc; padding: 6px 10px; }
+#panel label { display: block; }
+#panel span.swatch { display: inline-block; width: 10px; height: 10px; margin: 0 4px; }
+#status { position: absolute; bottom: 6px; left: 8px; background: rgba(255,255,255,0.85); padding: 2px 6px; }
+</style>
+</head>
+<body>
+<canvas id="map"></canvas>
+<div id="panel"></div>
+<div id="status">Loading tiles.json...</div>
+<script>
+"use strict";
+const COLORS = { sou: "#d62728", rec: "#1f77b4", cdp: "#2ca02c" };
+const TITLES = { sou: "Sources", rec: "Receivers", cdp: "CDPs" };
+const canvas = document.getElementById("map");
+const ctx = canvas.getContext("2d");
+const statusLine = document.getElementById("status");
+let meta = null;
+let size = 1;                          // level 0 tile size in coordinate units
+const view = { cx: 0, cy: 0, scale: 1 };  // center relative to the origin, pixels per unit
+const cache = new Map();               // "layer/z/x_y" -> decoded tile, or null while loading
+let cursor = null;
+let redrawQueued = false;
+let loadError = null;
+
+function decodeTile(buffer) {
+  const dv = new DataView(buffer);
+  if (dv.getUint32(0, false) !== 0x5353544c) throw new Error("not a tile");
+  const level = dv.getUint8(5), tx = dv.getUint32(8, true), ty = dv.getUint32(12, true);
+  const n = dv.getUint32(16, true);
+  const xy = new Float64Array(2 * n);
+  const tileSize = size / Math.pow(2, level);
+  for (let i = 0; i < n; i++) {
+    xy[2 * i] = (tx + dv.getUint16(20 + 4 * i, true) / 65536) * tileSize;
+    xy[2 * i + 1] = (ty + dv.getUint16(22 + 4 * i, true) / 65536) * tileSize;
+  }
+  const counts = new Float64Array(n);
+  let p = 20 + 4 * n;
+  for (let i = 0; i < n; i++) {
+    let value = 0, scale = 1, b;
+    do { b = dv.getUint8(p++); value += (b & 127) * scale; scale *= 128; } while (b & 128);
+    counts[i] = value;
+  }
+  return { xy, counts };
+}
+
+function request(layer, z, x, y) {
+  const key = layer.name + "/" + z + "/" + x + "_" + y;
+  if (cache.has(key)) return cache.get(key);
+  cache.set(key, null);
+  fetch(key + ".bin")
+    .then(r => { if (!r.ok) throw new Error(r.status + " " + key); return r.arrayBuffer(); })
+    .then(buffer => { cache.set(key, decodeTile(buffer)); redraw(); })
+    .catch(e => { loadError = e; redraw(); });
+  return null;
+}
+
+function levelForView(layer) {
+  // Tiles of 512-1024 screen pixels: aggregation cells of 2-4 pixels keep redraws light
+  const z = Math.ceil(Math.log2(size * view.scale / 1024));
+  return Math.max(0, Math.min(layer.levels.length - 1, z));
+}
+
+function toScreen(ux, uy, w, h) {
+  return [(ux - view.cx) * view.scale + w / 2, h / 2 - (uy - view.cy) * view.scale];
+}
+
+function draw() {
+  redrawQueued = false;
+  const dpr = window.devicePixelRatio || 1;
+  const w = canvas.clientWidth, h = canvas.clientHeight;
+  if (canvas.width !== Math.round(w * dpr) || canvas.height !== Math.round(h * dpr)) {
+    canvas.width = Math.round(w * dpr);
+    canvas.height = Math.round(h * dpr);
+  }
+  ctx.setTransform(dpr, 0, 0, dpr, 0, 0);
+  ctx.clearRect(0, 0, w, h);
+  if (!meta) return;
+
+  const minX = view.cx - w / 2 / view.scale, maxX = view.cx + w / 2 / view.scale;
+  const minY = view.cy - h / 2 / view.scale, maxY = view.cy + h / 2 / view.scale;
+  let shown = 0, levelText = [];
+  for (const layer of meta.layers) {
+    if (!layer.visible || layer.levels.length === 0) continue;
+    const z = levelForView(layer);
+    levelText.push(layer.name + ":" + z);
+    const tileSize = size / Math.pow(2, z);
+    const x0 = Math.max(0, Math.floor(minX / tileSize)), x1 = Math.floor(maxX / tileSize);
+    const y0 = Math.max(0, Math.floor(minY / tileSize)), y1 = Math.floor(maxY / tileSize);
+    const drawn = new Set();
+    ctx.fillStyle = COLORS[layer.name] || "#444";
+    for (let x = x0; x <= x1; x++) {
+      for (let y = y0; y <= y1; y++) {
+        if (!layer.levels[z].present.has(x + "_" + y)) continue;
+        // Until a tile arrives, draw its nearest loaded ancestor
+        let tz = z, tx = x, ty = y, tile = request(layer, z, x, y);
+        while (!tile && tz > 0) {
+          tz--; tx >>= 1; ty >>= 1;
+          tile = cache.get(layer.name + "/" + tz + "/" + tx + "_" + ty) || null;
+        }
+        const key = tz + "/" + tx + "_" + ty;
+        if (!tile || drawn.has(key)) continue;
+        drawn.add(key);
+        for (let i = 0; i < tile.counts.length; i++) {
+          const [sx, sy] = toScreen(tile.xy[2 * i], tile.xy[2 * i + 1], w, h);
+          if (sx < -4 || sy < -4 || sx > w + 4 || sy > h + 4) continue;
+          const r = 1.5 + Math.min(3, Math.log2(tile.counts[i]) / 3);
+          ctx.fillRect(sx - r, sy - r, 2 * r, 2 * r);
+          shown++;
+        }
+      }
+    }
+  }
+  let text = shown + " points, level " + levelText.join(" ");
+  if (cursor) {
+    const ux = view.cx + (cursor[0] - w / 2) / view.scale, uy = view.cy - (cursor[1] - h / 2) / view.scale;
+    text += " | X " + Math.round(meta.origin_x + ux) + "  Y " + Math.round(meta.origin_y + uy);
+  }
+  if (loadError) {
+    text += " | " + loadError.message + (location.protocol === "file:" ?
+      " (browsers block file:// requests; serve this directory, e.g. python3 -m http.server)" : "");
+  }
+  statusLine.textContent = text;
+}
+
+function redraw() {
+  if (!redrawQueued) { redrawQueued = true; requestAnimationFrame(draw); }
+}
+
+function fit() {
+  const w = canvas.clientWidth, h = canvas.clientHeight;
+  const spanX = Math.max(1, meta.max_x - meta.origin_x), spanY = Math.max(1, meta.max_y - meta.origin_y);
+  view.cx = spanX / 2;
+  view.cy = spanY / 2;
+  view.scale = 0.9 * Math.min(w / spanX, h / spanY);
+}
+
+function buildPanel() {
+  const panel = document.getElementById("panel");
+  for (const layer of meta.layers) {
+    layer.visible = true;
+    for (const level of layer.levels) {
+      level.present = new Set();
+      for (let i = 0; i < level.tiles.length; i += 2) level.present.add(level.tiles[i] + "_" + level.tiles[i + 1]);
+    }
+    const label = document.createElement("label");
+    const box = document.createElement("input");
+    box.type = "checkbox";
+    box.checked = true;
+    box.onchange = () => { layer.visible = box.checked; redraw(); };
+    const swatch = document.createElement("span");
+    swatch.className = "swatch";
+    swatch.style.background = COLORS[layer.name] || "#444";
+    label.append(box, swatch, (TITLES[layer.name] || layer.name) + " (" + layer.positions + ")");
+    panel.append(label);
+  }
+}
+
+let drag = null;
+canvas.addEventListener("mousedown", e => { drag = [e.clientX, e.clientY]; canvas.style.cursor = "grabbing"; });
+window.addEventListener("mouseup", () => { drag = null; canvas.style.cursor = "grab"; });
+canvas.addEventListener("mousemove", e => {
+  cursor = [e.offsetX, e.offsetY];
+  if (drag) {
+    view.cx -= (e.clientX - drag[0]) / view.scale;
+    view.cy += (e.clientY - drag[1]) / view.scale;
+    drag = [e.clientX, e.clientY];
+  }
+  redraw();
+});
+canvas.addEventListener("wheel", e => {
+  e.preventDefault();
+  const w = canvas.clientWidth, h = canvas.clientHeight;
+  const factor = Math.exp(-e.deltaY * 0.002);
+  // Keep the point under the cursor in place
+  const ux = view.cx + (e.offsetX - w / 2) / view.scale, uy = view.cy - (e.offsetY - h / 2) / view.scale;
+  view.scale *= factor;
+  view.cx = ux - (e.offsetX - w / 2) / view.scale;
+  view.cy = uy + (e.offsetY - h / 2) / view.scale;
+  redraw();
+}, { passive: false });
+canvas.addEventListener("dblclick", () => { fit(); redraw(); });
+window.addEventListener("resize", redraw);
+
+fetch("tiles.json")
+  .then(r => r.json())
+  .then(json => {
+    meta = json;
+    size = Math.pow(2, meta.extent_bits);
+    buildPanel();
+    fit();
+    redraw();
+  })
+  .catch(e => {
+    statusLine.textContent = "Cannot load tiles.json: " + e.message +
+      (location.protocol === "file:" ? " (serve this directory, e.g. python3 -m http.server)" : "");
+  });
+</script>
+</body>
+</html>
+)HTML";
+
+} // namespace
+
+TilePyramid buildTilePyramid(const std::vector<TileSource>& sources, int max_level) {
+    TilePyramid pyramid;
+    int64_t min_x = std::numeric_limits<int64_t>::max(), min_y = std::numeric_limits<int64_t>::max();
+    int64_t max_x = std::numeric_limits<int64_t>::min(), max_y = std::numeric_limits<int64_t>::min();
+    bool any = false;
+    for (const auto& source : sources) {
+        for (const auto& p : source.positions) {
+            min_x = std::min<int64_t>(min_x, p.x);
+            min_y = std::min<int64_t>(min_y, p.y);
+            max_x = std::max<int64_t>(max_x, p.x);
+            max_y = std::max<int64_t>(max_y, p.y);
+        }
+        any = any || !source.positions.empty();
+    }
+    if (any) {
+        pyramid.origin_x = min_x;
+        pyramid.origin_y = min_y;
+        pyramid.max_x = max_x;
+        pyramid.max_y = max_y;
+        const uint64_t span = static_cast<uint64_t>(std::max(max_x - min_x, max_y - min_y));
+        while (pyramid.extent_bits < 32 && (1ull << pyramid.extent_bits) <= span) ++pyramid.extent_bits;
+    }
+
+    max_level = std::max(0, std::min(max_level, pyramid.extent_bits));
+    for (const auto& source : sources) {
+        pyramid.layers.push_back(buildLayer(source, pyramid, max_level));
+    }
+    return pyramid;
+}
+
+std::vector<TilePoint> decodeTile(const TilePyramid& pyramid, const MapTile& tile) {
+    if (tile.data.size() < kTileHeaderSize || std::memcmp(tile.data.data(), kTileMagic, sizeof(kTileMagic)) != 0) {
+        throw std::runtime_error("Invalid map tile");
+    }
+    const int level = getLE<uint8_t>(tile.data, 5);
+    const uint32_t n = getLE<uint32_t>(tile.data, 16);
+    const int tile_bits = pyramid.extent_bits - level;
+    if (tile.data.size() < kTileHeaderSize + 4 * static_cast<size_t>(n)) {
+        throw std::runtime_error("Truncated map tile");
+    }
+
+    std::vector<TilePoint> points(n);
+    size_t pos = kTileHeaderSize + 4 * static_cast<size_t>(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        const double qx = getLE<uint16_t>(tile.data, kTileHeaderSize + 4 * i);
+        const double qy = getLE<uint16_t>(tile.data, kTileHeaderSize + 4 * i + 2);
+        points[i].x = pyramid.origin_x + std::ldexp(tile.x + qx / 65536.0, tile_bits);
+        points[i].y = pyramid.origin_y + std::ldexp(tile.y + qy / 65536.0, tile_bits);
+        uint64_t count = 0;
+        for (int shift = 0;; shift += 7) {
+            if (pos >= tile.data.size()) throw std::runtime_error("Truncated map tile");
+            uint8_t byte = tile.data[pos++];
+            count |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) break;
+        }
+        points[i].count = count;
+    }
+    return points;
+}
+
+void writeTilePyramid(const std::string& dir, const TilePyramid& pyramid) {
+    namespace fs = std::filesystem;
+    struct TileFile {
+        std::string path;
+        const MapTile* tile;
+    };
+    // Tiles of an earlier pyramid (e.g. a previous watch mode pass) may not exist in this one
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    std::vector<TileFile> files;
+    for (const auto& layer : pyramid.layers) {
+        for (size_t z = 0; z < layer.levels.size(); ++z) {
+            const std::string level_dir = dir + "/" + layer.name + "/" + std::to_string(z);
+            fs::create_directories(level_dir);
+            for (const auto& tile : layer.levels[z].tiles) {
+                files.push_back({level_dir + "/" + std::to_string(tile.x) + "_" + std::to_string(tile.y) + ".bin", &tile});
+            }
+        }
+    }
+
+    std::vector<std::string> errors(files.size());
+    #pragma omp parallel for schedule(dynamic, 16) if (files.size() > 64)
+    for (long i = 0; i < static_cast<long>(files.size()); ++i) {
+        std::ofstream out(files[i].path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(files[i].tile->data.data()), static_cast<std::streamsize>(files[i].tile->data.size()));
+        if (!out) errors[i] = files[i].path;
+    }
+    for (const auto& error : errors) {
+        if (!error.empty()) throw std::runtime_error("Failed to write file: " + error);
+    }
+
+    writeFile(dir + "/tiles.json", tilesJson(pyramid));
+    writeFile(dir + "/index.html", kViewerHtml);
+}
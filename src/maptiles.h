@@ -0,0 +1,84 @@
+#ifndef MAPTILES_H
+#define MAPTILES_H
+
+// Level-of-detail tiles of survey positions for interactive maps.
+// A square extent around all positions is split as a quadtree: level z has 2^z x 2^z
+// tiles. Below the leaf level every tile aggregates its positions on a kTileGrid x
+// kTileGrid grid - one point per occupied cell at the mean position, with the number of
+// positions it stands for - so a tile never holds more than kTileGrid^2 points however
+// large the survey. Leaf tiles hold the positions themselves: a leaf is at most 65536
+// coordinate units wide, so its u16 offsets are exact. A viewer loads only the tiles in
+// view, at the level matching its zoom.
+//
+// Positions are sorted once by Morton code (quadtree order), so every tile and every
+// grid cell is a contiguous run and each level is one linear pass over the finer one.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "basetypes.h"
+
+const uint32_t kTileGrid = 256;
+const int kMaxTileLevel = 20;
+
+/**
+ * One encoded tile, written as <layer>/<level>/<x>_<y>.bin (little-endian):
+ *   char[4] "SSTL", u8 version, u8 level, u16 reserved, u32 x, u32 y, u32 num_points,
+ *   num_points x (u16 qx, u16 qy), num_points x LEB128 count
+ * qx, qy are the point position within the tile in 1/65536 of the tile size.
+ * Tile (0, 0) is at the lower left corner; y grows northwards.
+ */
+struct MapTile {
+    uint32_t x;
+    uint32_t y;
+    uint32_t num_points;
+    std::vector<uint8_t> data;
+};
+
+struct TileLevel {
+    uint64_t num_points = 0;
+    std::vector<MapTile> tiles;  // Morton order
+};
+
+struct TileLayer {
+    std::string name;
+    uint64_t num_positions = 0;
+    std::vector<TileLevel> levels;  // 0 .. leaf level
+};
+
+struct TilePyramid {
+    int64_t origin_x = 0;   // lower left corner of the level 0 tile
+    int64_t origin_y = 0;
+    int64_t max_x = 0;      // upper right corner of the positions
+    int64_t max_y = 0;
+    int extent_bits = 0;    // the level 0 tile is 2^extent_bits coordinate units wide
+    std::vector<TileLayer> layers;
+};
+
+// Positions of one map layer, e.g. the survey's unique sources
+struct TileSource {
+    std::string name;
+    std::vector<Coord> positions;
+};
+
+// All layers share one extent, so their tiles line up. The leaf level of a layer is the
+// first level whose tiles are at most 65536 units wide and hold at most kTileGrid^2
+// distinct positions, capped at max_level. Leaves cut short by the cap are wider and
+// their positions are rounded down to 2^(tile bits - 16) units.
+TilePyramid buildTilePyramid(const std::vector<TileSource>& sources, int max_level = kMaxTileLevel);
+
+struct TilePoint {
+    double x;
+    double y;
+    uint64_t count;
+};
+
+// Points of an encoded tile in survey coordinates
+std::vector<TilePoint> decodeTile(const TilePyramid& pyramid, const MapTile& tile);
+
+// <dir>/<layer>/<level>/<x>_<y>.bin, <dir>/tiles.json (extent, layers and tile lists)
+// and the static viewer <dir>/index.html. dir is removed first, so no tile of an
+// earlier pyramid is left behind.
+void writeTilePyramid(const std::string& dir, const TilePyramid& pyramid);
+
+#endif // MAPTILES_H
@@ -0,0 +1,207 @@
+#include "profiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+#include <sys/resource.h>
+
+namespace {
+
+long currentPeakRssKb() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    return usage.ru_maxrss;        // kilobytes on Linux
+#endif
+}
+
+std::string jsonEscape(const std::string& value) {
+    std::string result;
+    result.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '"': result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\n': result += "\\n"; break;
+            case '\t': result += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    result += buf;
+                } else {
+                    result += c;
+                }
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler() : enabled_(false), origin_(std::chrono::steady_clock::now()) {}
+
+int64_t Profiler::nowNs() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - origin_).count();
+}
+
+Profiler::ThreadBuffer& Profiler::threadBuffer() {
+    // Buffers are owned by the profiler so spans outlive worker threads
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        buffers_.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer()));
+        buffer = buffers_.back().get();
+        buffer->tid = static_cast<uint32_t>(buffers_.size());
+    }
+    return *buffer;
+}
+
+void Profiler::record(ProfileSpan span) {
+    ThreadBuffer& buffer = threadBuffer();
+    span.tid = buffer.tid;
+    buffer.spans.push_back(std::move(span));
+}
+
+std::vector<ProfileSpan> Profiler::collect() const {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    std::vector<ProfileSpan> spans;
+    for (const auto& buffer : buffers_) {
+        spans.insert(spans.end(), buffer->spans.begin(), buffer->spans.end());
+    }
+    std::sort(spans.begin(), spans.end(), [](const ProfileSpan& a, const ProfileSpan& b) {
+        return a.start_ns < b.start_ns;
+    });
+    return spans;
+}
+
+void Profiler::printSummary(std::ostream& out) const {
+    struct Totals {
+        uint64_t calls = 0;
+        int64_t wall_ns = 0;
+        uint64_t bytes = 0;
+        uint64_t traces = 0;
+        long peak_rss_kb = 0;
+    };
+
+    auto spans = collect();
+    if (spans.empty()) return;
+
+    // Rows in order of first appearance: per stage and file, then per-stage totals
+    std::vector<std::pair<std::string, std::string>> order;
+    std::map<std::pair<std::string, std::string>, Totals> rows;
+    std::vector<std::string> stage_order;
+    std::map<std::string, Totals> stages;
+
+    for (const auto& span : spans) {
+        auto key = std::make_pair(std::string(span.stage), span.file);
+        if (rows.find(key) == rows.end()) order.push_back(key);
+        if (stages.find(key.first) == stages.end()) stage_order.push_back(key.first);
+
+        for (Totals* t : {&rows[key], &stages[key.first]}) {
+            t->calls++;
+            t->wall_ns += span.end_ns - span.start_ns;
+            t->bytes += span.bytes;
+            t->traces += span.traces;
+            t->peak_rss_kb = std::max(t->peak_rss_kb, span.peak_rss_kb);
+        }
+    }
+
+    size_t file_width = 4;
+    for (const auto& key : order) file_width = std::max(file_width, key.second.size());
+
+    auto printRow = [&](const std::string& stage, const std::string& file, const Totals& t) {
+        double secs = t.wall_ns * 1e-9;
+        double mb = t.bytes / (1024.0 * 1024.0);
+        out << std::left << std::setw(20) << stage << " "
+            << std::setw(static_cast<int>(file_width)) << file << " "
+            << std::right << std::setw(6) << t.calls
+            << std::fixed << std::setprecision(3) << std::setw(11) << secs
+            << std::setprecision(1) << std::setw(11) << mb
+            << std::setw(10) << (secs > 0 && t.bytes ? mb / secs : 0.0)
+            << std::setw(12) << t.traces
+            << std::setw(12) << (secs > 0 && t.traces ? t.traces / secs : 0.0)
+            << std::setw(10) << t.peak_rss_kb / 1024.0
+            << std::endl;
+    };
+
+    out << std::endl << "Profile summary:" << std::endl;
+    out << std::left << std::setw(20) << "stage" << " "
+        << std::setw(static_cast<int>(file_width)) << "file" << " "
+        << std::right << std::setw(6) << "calls" << std::setw(11) << "wall_s"
+        << std::setw(11) << "read_MB" << std::setw(10) << "MB/s"
+        << std::setw(12) << "traces" << std::setw(12) << "traces/s"
+        << std::setw(10) << "rss_MB" << std::endl;
+
+    for (const auto& key : order) {
+        if (key.second.empty()) continue;
+        printRow(key.first, key.second, rows[key]);
+    }
+    for (const auto& stage : stage_order) {
+        printRow(stage, "*", stages[stage]);
+    }
+    out.unsetf(std::ios::floatfield);
+}
+
+void Profiler::writeChromeTrace(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot create file: " + path);
+    }
+
+    auto spans = collect();
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+    bool first = true;
+    for (const auto& span : spans) {
+        if (!first) file << "," << std::endl;
+        first = false;
+        file << "{\"name\":\"" << jsonEscape(span.stage) << "\",\"cat\":\"scan\",\"ph\":\"X\""
+             << ",\"pid\":1,\"tid\":" << span.tid
+             << std::fixed << std::setprecision(3)
+             << ",\"ts\":" << span.start_ns / 1000.0
+             << ",\"dur\":" << (span.end_ns - span.start_ns) / 1000.0
+             << ",\"args\":{\"file\":\"" << jsonEscape(span.file) << "\""
+             << ",\"bytes\":" << span.bytes
+             << ",\"traces\":" << span.traces
+             << ",\"peak_rss_kb\":" << span.peak_rss_kb << "}}";
+    }
+    file << std::endl << "]}" << std::endl;
+}
+
+ProfileScope::ProfileScope(const char* stage, const std::string& file)
+    : active_(Profiler::instance().enabled()), stage_(stage), start_ns_(0), bytes_(0), traces_(0) {
+    if (active_) {
+        file_ = file;
+        start_ns_ = Profiler::instance().nowNs();
+    }
+}
+
+ProfileScope::~ProfileScope() {
+    stop();
+}
+
+void ProfileScope::stop() {
+    if (!active_) return;
+    active_ = false;
+    Profiler& profiler = Profiler::instance();
+    ProfileSpan span;
+    span.stage = stage_;
+    span.file = std::move(file_);
+    span.start_ns = start_ns_;
+    span.end_ns = profiler.nowNs();
+    span.bytes = bytes_;
+    span.traces = traces_;
+    span.peak_rss_kb = currentPeakRssKb();
+    span.tid = 0;
+    profiler.record(std::move(span));
+}
@@ -0,0 +1,52 @@
+#ifndef SCANARENA_H
+#define SCANARENA_H
+
+// Arena for the transient state of one file scan or one table. Containers built along
+// the way (dedupe maps, coverage hashes, table rows) take their memory from a monotonic
+// buffer that grows geometrically from the heap. Frees are no-ops and everything is
+// returned at once when the arena is destroyed, so a file costs a handful of heap calls
+// instead of one per map node, and files scanned in parallel do not contend in the
+// global allocator. Not thread-safe: one arena per file and thread.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+class ScanArena {
+public:
+    explicit ScanArena(size_t initial_bytes = 64 * 1024) : buffer_(initial_bytes, &upstream_) {}
+    ScanArena(const ScanArena&) = delete;
+    ScanArena& operator=(const ScanArena&) = delete;
+
+    std::pmr::memory_resource* resource() { return &buffer_; }
+
+    // Heap calls made by the arena so far and the bytes they requested
+    uint64_t heap_allocations() const { return upstream_.allocations; }
+    uint64_t heap_bytes() const { return upstream_.bytes; }
+
+private:
+    // new/delete with counters, to check how often the arena goes to the heap
+    class CountingResource : public std::pmr::memory_resource {
+    public:
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+
+    private:
+        void* do_allocate(size_t size, size_t alignment) override {
+            ++allocations;
+            bytes += size;
+            return std::pmr::new_delete_resource()->allocate(size, alignment);
+        }
+        void do_deallocate(void* p, size_t size, size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+
+    CountingResource upstream_;
+    std::pmr::monotonic_buffer_resource buffer_;
+};
+
+#endif // SCANARENA_H
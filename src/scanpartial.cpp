@@ -0,0 +1,389 @@
+#include "scanpartial.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+const char kMagic[8] = {'S', 'S', 'C', 'N', 'P', 'R', 'T', '1'};
+// Version 2 adds geometry statistics, version 3 the bin grid, version 4 gathers,
+// version 5 widens max_time_ms to 64 bits, version 6 adds field sketches, version 7
+// the midpoint tolerance; older files are still readable
+const uint32_t kVersion = 7;
+
+// Little-endian encoding independent of the host
+class PartialWriter {
+public:
+    void u8(uint8_t v) { buffer_.push_back(static_cast<char>(v)); }
+    void u32(uint32_t v) {
+        for (int i = 0; i < 4; ++i) buffer_.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+    }
+    void u64(uint64_t v) {
+        for (int i = 0; i < 8; ++i) buffer_.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+    }
+    void i32(int32_t v) { u32(static_cast<uint32_t>(v)); }
+    void i64(int64_t v) { u64(static_cast<uint64_t>(v)); }
+    void f64(double v) {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        u64(bits);
+    }
+    void str(const std::string& s) {
+        u32(static_cast<uint32_t>(s.size()));
+        buffer_.insert(buffer_.end(), s.begin(), s.end());
+    }
+    const std::vector<char>& data() const { return buffer_; }
+
+private:
+    std::vector<char> buffer_;
+};
+
+class PartialReader {
+public:
+    PartialReader(const std::vector<char>& data, const std::string& path) : data_(data), path_(path), pos_(0) {}
+
+    uint8_t u8() { need(1); return static_cast<uint8_t>(data_[pos_++]); }
+    uint32_t u32() {
+        need(4);
+        uint32_t v = 0;
+        for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(static_cast<uint8_t>(data_[pos_++])) << (8 * i);
+        return v;
+    }
+    uint64_t u64() {
+        need(8);
+        uint64_t v = 0;
+        for (int i = 0; i < 8; ++i) v |= static_cast<uint64_t>(static_cast<uint8_t>(data_[pos_++])) << (8 * i);
+        return v;
+    }
+    int32_t i32() { return static_cast<int32_t>(u32()); }
+    int64_t i64() { return static_cast<int64_t>(u64()); }
+    double f64() {
+        uint64_t bits = u64();
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    std::string str() {
+        uint32_t size = u32();
+        need(size);
+        std::string s(data_.data() + pos_, size);
+        pos_ += size;
+        return s;
+    }
+    // Element count checked against the remaining bytes before reserving memory
+    uint64_t count(size_t element_size) {
+        uint64_t n = u64();
+        if (element_size > 0 && n > (data_.size() - pos_) / element_size) corrupt();
+        return n;
+    }
+
+private:
+    void need(size_t n) {
+        if (data_.size() - pos_ < n) corrupt();
+    }
+    [[noreturn]] void corrupt() {
+        throw std::runtime_error("Corrupt partial result file: " + path_);
+    }
+
+    const std::vector<char>& data_;
+    std::string path_;
+    size_t pos_;
+};
+
+void writeAttribute(PartialWriter& w, const AttributeStats& a) {
+    w.f64(a.min_val); w.f64(a.max_val); w.f64(a.sum); w.u64(a.count);
+}
+
+AttributeStats readAttribute(PartialReader& r) {
+    AttributeStats a;
+    a.min_val = r.f64(); a.max_val = r.f64(); a.sum = r.f64(); a.count = r.u64();
+    return a;
+}
+
+void writeSketch(PartialWriter& w, const FieldSketch& sketch) {
+    w.u8(sketch.exact() ? 1 : 0);
+    if (sketch.exact()) {
+        const auto counts = sketch.exact_counts();
+        w.u64(counts.size());
+        for (const auto& entry : counts) {
+            w.i32(entry.first); w.u64(entry.second);
+        }
+        return;
+    }
+    w.u64(sketch.count()); w.i32(sketch.min()); w.i32(sketch.max());
+    const auto& registers = sketch.distinct_sketch().registers();
+    w.u64(registers.size());
+    for (uint8_t rank : registers) w.u8(rank);
+    const TDigest& digest = sketch.percentile_sketch();
+    w.f64(digest.min()); w.f64(digest.max());
+    const auto centroids = digest.centroids();
+    w.u64(centroids.size());
+    for (const auto& c : centroids) {
+        w.f64(c.mean); w.f64(c.weight); w.u8(c.point ? 1 : 0);
+    }
+}
+
+FieldSketch readSketch(PartialReader& r) {
+    FieldSketch sketch;
+    if (r.u8() != 0) {
+        std::vector<std::pair<int32_t, uint64_t>> counts(r.count(12));
+        for (auto& entry : counts) {
+            entry.first = r.i32(); entry.second = r.u64();
+        }
+        sketch.restoreExact(counts);
+        return sketch;
+    }
+    uint64_t count = r.u64();
+    int32_t min_val = r.i32();
+    int32_t max_val = r.i32();
+    std::vector<uint8_t> registers(r.count(1));
+    for (auto& rank : registers) rank = r.u8();
+    HyperLogLog distinct;
+    distinct.restore(std::move(registers));
+    double digest_min = r.f64();
+    double digest_max = r.f64();
+    std::vector<TDigest::Centroid> centroids(r.count(17));
+    for (auto& c : centroids) {
+        c.mean = r.f64(); c.weight = r.f64(); c.point = r.u8() != 0;
+    }
+    TDigest percentiles;
+    percentiles.setCentroids(centroids, digest_min, digest_max);
+    sketch.restoreApproximate(count, min_val, max_val, std::move(distinct), std::move(percentiles));
+    return sketch;
+}
+
+} // namespace
+
+void writeScanPartial(const std::string& path, const ScanPartial& partial) {
+    PartialWriter w;
+    for (char c : kMagic) w.u8(static_cast<uint8_t>(c));
+    w.u32(kVersion);
+    w.u32(partial.shard_index);
+    w.u32(partial.shard_count);
+    w.u64(partial.files.size());
+
+    for (const auto& file : partial.files) {
+        const FileScanResult& r = file.result;
+        w.str(file.path);
+        w.str(r.file_info.filename);
+        w.u64(r.file_info.num_traces);
+        w.i32(r.file_info.num_samples);
+        w.i32(r.file_info.sample_interval_ms);
+        w.i64(r.file_info.max_time_ms);
+
+        w.u64(r.ranges.size());
+        for (const auto& range : r.ranges) {
+            w.str(range.first);
+            w.i32(range.second.min_val);
+            w.i32(range.second.max_val);
+        }
+
+        w.u8(static_cast<uint8_t>((file.has_sources ? 1 : 0) | (file.has_receivers ? 2 : 0) | (file.has_cdps ? 4 : 0)));
+
+        w.u64(r.sources.size());
+        for (const auto& s : r.sources) {
+            w.i32(s.ffid); w.i32(s.source); w.i32(s.sou_x); w.i32(s.sou_y); w.i32(s.sou_elev);
+        }
+        w.u64(r.receivers.size());
+        for (const auto& rec : r.receivers) {
+            w.i32(rec.rec_x); w.i32(rec.rec_y); w.i32(rec.rec_elev);
+        }
+        w.u64(r.cdps.size());
+        for (const auto& c : r.cdps) {
+            w.i32(c.cdp); w.i32(c.cdp_x); w.i32(c.cdp_y); w.i32(c.iline); w.i32(c.xline);
+        }
+
+        w.u8(r.has_geometry ? 1 : 0);
+        if (r.has_geometry) {
+            const GeometryStats& g = r.geometry;
+            writeAttribute(w, g.offset);
+            writeAttribute(w, g.azimuth);
+            writeAttribute(w, g.midpoint_error);
+            w.u64(g.midpoint_exceeded);
+            w.u64(g.zero_offset);
+            w.f64(g.offset_bin_width);
+            w.f64(g.midpoint_tolerance);
+            w.u64(g.offset_histogram.size());
+            for (uint64_t count : g.offset_histogram) w.u64(count);
+            w.u64(g.azimuth_histogram.size());
+            for (uint64_t count : g.azimuth_histogram) w.u64(count);
+        }
+
+        const BinGrid& grid = r.grid;
+        w.u8(static_cast<uint8_t>((grid.valid ? 1 : 0) | (grid.regular ? 2 : 0) | (grid.dense ? 4 : 0)));
+        if (grid.valid) {
+            w.i32(grid.il_min); w.i32(grid.il_max); w.i32(grid.xl_min); w.i32(grid.xl_max);
+            for (double v : {grid.origin_x, grid.origin_y, grid.il_dx, grid.il_dy, grid.xl_dx, grid.xl_dy,
+                             grid.il_spacing, grid.xl_spacing, grid.inline_azimuth, grid.crossline_azimuth,
+                             grid.rms_residual, grid.max_residual}) {
+                w.f64(v);
+            }
+            w.u64(grid.num_traces); w.u64(grid.cells_total); w.u64(grid.cells_occupied);
+            w.u32(grid.fold_min); w.u32(grid.fold_max);
+            w.u64(grid.fold_histogram.size());
+            for (uint64_t count : grid.fold_histogram) w.u64(count);
+        }
+
+        w.u8(r.has_gathers ? 1 : 0);
+        if (r.has_gathers) {
+            w.str(r.gathers.key);
+            w.u64(r.gathers.gathers.size());
+            for (const auto& g : r.gathers.gathers) {
+                w.u64(g.first_trace); w.u64(g.num_traces); w.i32(g.key);
+            }
+        }
+
+        w.u64(r.sketches.size());
+        for (const auto& sketch : r.sketches) {
+            w.str(sketch.first);
+            writeSketch(w, sketch.second);
+        }
+    }
+
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("Cannot create file: " + tmp_path);
+        }
+        out.write(w.data().data(), static_cast<std::streamsize>(w.data().size()));
+        if (!out) {
+            throw std::runtime_error("Failed to write file: " + tmp_path);
+        }
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Cannot rename " + tmp_path + " to " + path + ": " + std::strerror(errno));
+    }
+}
+
+ScanPartial readScanPartial(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        throw std::runtime_error("Cannot open partial result file: " + path);
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    PartialReader r(data, path);
+    for (char c : kMagic) {
+        if (r.u8() != static_cast<uint8_t>(c)) {
+            throw std::runtime_error("Not a scansegy partial result file: " + path);
+        }
+    }
+    uint32_t version = r.u32();
+    if (version < 1 || version > kVersion) {
+        throw std::runtime_error("Unsupported partial result version " + std::to_string(version) + ": " + path);
+    }
+
+    ScanPartial partial;
+    partial.shard_index = r.u32();
+    partial.shard_count = r.u32();
+    uint64_t num_files = r.count(1);
+    partial.files.resize(num_files);
+
+    for (auto& file : partial.files) {
+        FileScanResult& res = file.result;
+        file.path = r.str();
+        res.file_info.filename = r.str();
+        res.file_info.num_traces = r.u64();
+        res.file_info.num_samples = r.i32();
+        res.file_info.sample_interval_ms = r.i32();
+        res.file_info.max_time_ms = version >= 5 ? r.i64() : r.i32();
+
+        uint64_t num_ranges = r.count(12);
+        for (uint64_t i = 0; i < num_ranges; ++i) {
+            std::string name = r.str();
+            int32_t min_val = r.i32();
+            int32_t max_val = r.i32();
+            res.ranges[name] = Range(min_val, max_val);
+        }
+
+        uint8_t flags = r.u8();
+        file.has_sources = (flags & 1) != 0;
+        file.has_receivers = (flags & 2) != 0;
+        file.has_cdps = (flags & 4) != 0;
+
+        res.sources.resize(r.count(20));
+        for (auto& s : res.sources) {
+            s.ffid = r.i32(); s.source = r.i32(); s.sou_x = r.i32(); s.sou_y = r.i32(); s.sou_elev = r.i32();
+        }
+        res.receivers.resize(r.count(12));
+        for (auto& rec : res.receivers) {
+            rec.rec_x = r.i32(); rec.rec_y = r.i32(); rec.rec_elev = r.i32();
+        }
+        res.cdps.resize(r.count(20));
+        for (auto& c : res.cdps) {
+            c.cdp = r.i32(); c.cdp_x = r.i32(); c.cdp_y = r.i32(); c.iline = r.i32(); c.xline = r.i32();
+        }
+
+        res.has_geometry = version >= 2 && r.u8() != 0;
+        if (res.has_geometry) {
+            GeometryStats& g = res.geometry;
+            g.offset = readAttribute(r);
+            g.azimuth = readAttribute(r);
+            g.midpoint_error = readAttribute(r);
+            g.midpoint_exceeded = r.u64();
+            g.zero_offset = r.u64();
+            g.offset_bin_width = r.f64();
+            g.midpoint_tolerance = version >= 7 ? r.f64() : NAN;
+            g.offset_histogram.resize(r.count(8));
+            for (auto& count : g.offset_histogram) count = r.u64();
+            g.azimuth_histogram.resize(r.count(8));
+            for (auto& count : g.azimuth_histogram) count = r.u64();
+        }
+
+        uint8_t grid_flags = version >= 3 ? r.u8() : 0;
+        BinGrid& grid = res.grid;
+        grid.valid = (grid_flags & 1) != 0;
+        grid.regular = (grid_flags & 2) != 0;
+        grid.dense = (grid_flags & 4) != 0;
+        if (grid.valid) {
+            grid.il_min = r.i32(); grid.il_max = r.i32(); grid.xl_min = r.i32(); grid.xl_max = r.i32();
+            for (double* v : {&grid.origin_x, &grid.origin_y, &grid.il_dx, &grid.il_dy, &grid.xl_dx, &grid.xl_dy,
+                              &grid.il_spacing, &grid.xl_spacing, &grid.inline_azimuth, &grid.crossline_azimuth,
+                              &grid.rms_residual, &grid.max_residual}) {
+                *v = r.f64();
+            }
+            grid.num_traces = r.u64(); grid.cells_total = r.u64(); grid.cells_occupied = r.u64();
+            grid.fold_min = r.u32(); grid.fold_max = r.u32();
+            grid.fold_histogram.resize(r.count(8));
+            for (auto& count : grid.fold_histogram) count = r.u64();
+        }
+
+        res.has_gathers = version >= 4 && r.u8() != 0;
+        if (res.has_gathers) {
+            res.gathers.key = r.str();
+            res.gathers.gathers.resize(r.count(20));
+            for (auto& g : res.gathers.gathers) {
+                g.first_trace = r.u64(); g.num_traces = r.u64(); g.key = r.i32();
+            }
+        }
+
+        uint64_t num_sketches = version >= 6 ? r.count(13) : 0;
+        for (uint64_t i = 0; i < num_sketches; ++i) {
+            std::string name = r.str();
+            res.sketches[name] = readSketch(r);
+        }
+    }
+    return partial;
+}
+
+std::vector<std::string> selectShardFiles(std::vector<std::string> files, uint32_t shard_index, uint32_t shard_count) {
+    if (shard_count == 0 || shard_index >= shard_count) {
+        throw std::invalid_argument("Invalid shard " + std::to_string(shard_index) + "/" + std::to_string(shard_count));
+    }
+    std::sort(files.begin(), files.end());
+    std::vector<std::string> selected;
+    for (size_t i = shard_index; i < files.size(); i += shard_count) {
+        selected.push_back(files[i]);
+    }
+    return selected;
+}
+
+std::string scanPartialFileName(uint32_t shard_index, uint32_t shard_count) {
+    return "shard_" + std::to_string(shard_index) + "_of_" + std::to_string(shard_count) + ".sspart";
+}
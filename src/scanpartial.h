@@ -0,0 +1,37 @@
+#ifndef SCANPARTIAL_H
+#define SCANPARTIAL_H
+
+// Mergeable partial scan results for distributing a survey scan across nodes.
+// Each shard writes one compact binary file with file info, ranges and unique
+// position sets of its files; a merge step combines any number of them.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "segyscan.h"
+
+struct ScanPartialFile {
+    std::string path;          // input path as discovered (defines merge order)
+    bool has_sources = false;
+    bool has_receivers = false;
+    bool has_cdps = false;
+    FileScanResult result;     // traces are never stored
+};
+
+struct ScanPartial {
+    uint32_t shard_index = 0;
+    uint32_t shard_count = 1;
+    std::vector<ScanPartialFile> files;
+};
+
+// Writes atomically (temporary file + rename) so a merge never sees a torn partial
+void writeScanPartial(const std::string& path, const ScanPartial& partial);
+ScanPartial readScanPartial(const std::string& path);
+
+// Deterministic shard assignment: round-robin over the sorted file list
+std::vector<std::string> selectShardFiles(std::vector<std::string> files, uint32_t shard_index, uint32_t shard_count);
+
+// "shard_<i>_of_<N>.sspart"
+std::string scanPartialFileName(uint32_t shard_index, uint32_t shard_count);
+
+#endif // SCANPARTIAL_H
@@ -0,0 +1,380 @@
+#include "segyextract.h"
+#include "segyread/CompressedInput.hpp"
+#include "segyread/SegyUtil.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SEGYEXTRACT_HAVE_POSIX 1
+#endif
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+namespace {
+
+// Appends [first, first + count), joining it to the previous range when adjacent
+void appendRange(std::vector<TraceRange>& ranges, uint64_t first, uint64_t count) {
+    if (!ranges.empty() && ranges.back().first + ranges.back().count == first) {
+        ranges.back().count += count;
+    } else {
+        ranges.push_back({first, count});
+    }
+}
+
+} // namespace
+
+std::vector<TraceRange> selectTraceRanges(const HeaderColumns& columns, const std::vector<std::string>& names,
+                                          const std::vector<IndexPredicate>& predicates) {
+    std::vector<size_t> predicate_columns;
+    for (const auto& predicate : predicates) {
+        auto it = std::find(names.begin(), names.end(), predicate.field);
+        if (it == names.end() || static_cast<size_t>(it - names.begin()) >= columns.num_columns()) {
+            throw std::invalid_argument("Unknown header field in predicate: " + predicate.field);
+        }
+        predicate_columns.push_back(static_cast<size_t>(it - names.begin()));
+    }
+
+    std::vector<TraceRange> ranges;
+    std::vector<uint8_t> selected(kHeaderBlockSize);
+    std::vector<int32_t> values(kHeaderBlockSize);
+    for (size_t block = 0; block < columns.num_blocks(); ++block) {
+        const uint64_t first = static_cast<uint64_t>(block) * kHeaderBlockSize;
+        const size_t rows = static_cast<size_t>(std::min<uint64_t>(kHeaderBlockSize, columns.num_traces() - first));
+        bool none = false;
+        bool all = true;
+        for (size_t p = 0; p < predicates.size() && !none; ++p) {
+            const IndexPredicate& predicate = predicates[p];
+            const CompressedColumn& column = columns.column(predicate_columns[p]);
+            const ColumnBlock& stats = column.block(block);
+            if (stats.max_val < predicate.lo || stats.min_val > predicate.hi) {
+                none = true;
+            } else if (stats.min_val < predicate.lo || stats.max_val > predicate.hi) {
+                // The predicate cuts through the block: test the values
+                if (all) std::fill(selected.begin(), selected.begin() + rows, uint8_t(1));
+                all = false;
+                column.decodeBlock(block, values.data());
+                for (size_t i = 0; i < rows; ++i) {
+                    selected[i] &= static_cast<uint8_t>(values[i] >= predicate.lo && values[i] <= predicate.hi);
+                }
+            }
+        }
+        if (none) continue;
+        if (all) {
+            appendRange(ranges, first, rows);
+            continue;
+        }
+        for (size_t i = 0; i < rows;) {
+            if (!selected[i]) {
+                ++i;
+                continue;
+            }
+            size_t end = i + 1;
+            while (end < rows && selected[end]) ++end;
+            appendRange(ranges, first + i, end - i);
+            i = end;
+        }
+    }
+    return ranges;
+}
+
+namespace {
+
+const size_t kCopyBufferSize = 8u << 20;
+// Largest single copy_file_range/sendfile call (Linux copies at most about 2 GB per call)
+const uint64_t kMaxKernelCopy = 1u << 30;
+
+std::string systemError(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+// Textual, binary and extended textual headers (everything before the first trace)
+// read sequentially; read(dst, size) returns the bytes read, fewer only at the end
+std::vector<char> readFileHeaders(const std::string& path, const std::function<size_t(char*, size_t)>& read,
+                                  SegyLayout& layout) {
+    std::vector<char> headers(3600);
+    if (read(headers.data(), headers.size()) != headers.size()) {
+        throw std::runtime_error("File is shorter than the SEG-Y file headers: " + path);
+    }
+    layout = SegyReader::parse_layout(headers.data() + 3200);
+    if (layout.data_offset != 0) {
+        // Known from the binary header (rev 2 first trace offset or extended header count)
+        const size_t known = headers.size();
+        headers.resize(layout.data_offset);
+        if (read(headers.data() + known, headers.size() - known) != headers.size() - known) {
+            throw std::runtime_error("File ends inside its extended textual headers: " + path);
+        }
+        return headers;
+    }
+    // Extended textual headers up to ((SEG: EndText))
+    for (;;) {
+        const size_t offset = headers.size();
+        headers.resize(offset + 3200);
+        if (read(headers.data() + offset, 3200) != 3200) {
+            throw std::runtime_error("Extended textual headers are not terminated by ((SEG: EndText)): " + path);
+        }
+        if (SegyReader::is_end_text_record(headers.data() + offset)) break;
+    }
+    layout.data_offset = headers.size();
+    return headers;
+}
+
+} // namespace
+
+#ifdef SEGYEXTRACT_HAVE_POSIX
+
+SegyExtractWriter::SegyExtractWriter(const std::string& path) : path_(path), tmp_path_(path + ".tmp") {
+    fd_ = ::open(tmp_path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error(systemError("Cannot create file " + tmp_path_));
+    }
+}
+
+SegyExtractWriter::~SegyExtractWriter() {
+    if (fd_ >= 0) ::close(fd_);
+    if (!committed_) std::remove(tmp_path_.c_str());
+}
+
+void SegyExtractWriter::writeAll(const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd_, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(systemError("Failed to write " + tmp_path_));
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+void SegyExtractWriter::useHeaders(const std::string& source_path, std::vector<char> headers) {
+    SegyLayout layout = SegyReader::parse_layout(headers.data() + 3200);
+    layout.data_offset = headers.size();
+    if (!have_headers_) {
+        writeAll(headers.data(), headers.size());
+        layout_ = layout;
+        layout_source_ = source_path;
+        have_headers_ = true;
+        return;
+    }
+    if (layout.traceSize() != layout_.traceSize() || layout.format_code != layout_.format_code ||
+        layout.num_samples != layout_.num_samples) {
+        throw std::runtime_error("Trace layout of " + source_path + " (" + std::to_string(layout.num_samples) +
+                                 " samples, format " + std::to_string(layout.format_code) + ") differs from " +
+                                 layout_source_ + " (" + std::to_string(layout_.num_samples) + " samples, format " +
+                                 std::to_string(layout_.format_code) + ")");
+    }
+}
+
+void SegyExtractWriter::append(const std::string& source_path, const std::vector<TraceRange>& ranges) {
+    if (ranges.empty()) return;
+    if (fd_ < 0) {
+        throw std::logic_error("SegyExtractWriter::append after commit");
+    }
+    std::error_code ec;
+    if (std::filesystem::equivalent(source_path, path_, ec)) {
+        throw std::runtime_error("Extraction output is one of its inputs: " + path_);
+    }
+    if (detectCompression(source_path) != Compression::None) {
+        appendCompressed(source_path, ranges);
+        return;
+    }
+
+    int in_fd = ::open(source_path.c_str(), O_RDONLY);
+    if (in_fd < 0) {
+        throw std::runtime_error(systemError("Cannot open " + source_path));
+    }
+    try {
+#ifdef POSIX_FADV_SEQUENTIAL
+        posix_fadvise(in_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+        uint64_t position = 0;
+        auto read = [&](char* dst, size_t size) {
+            size_t done = 0;
+            while (done < size) {
+                ssize_t n = ::pread(in_fd, dst + done, size - done, static_cast<off_t>(position + done));
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0) throw std::runtime_error(systemError("Failed to read " + source_path));
+                if (n == 0) break;
+                done += static_cast<size_t>(n);
+            }
+            position += done;
+            return done;
+        };
+        SegyLayout layout;
+        std::vector<char> headers = readFileHeaders(source_path, read, layout);
+        useHeaders(source_path, std::move(headers));
+
+        struct stat st;
+        if (::fstat(in_fd, &st) != 0) {
+            throw std::runtime_error(systemError("Cannot stat " + source_path));
+        }
+        const uint64_t num_traces = layout.countTraces(static_cast<uint64_t>(st.st_size));
+        const uint64_t trace_size = layout.traceSize();
+        for (const auto& range : ranges) {
+            if (range.first + range.count > num_traces) {
+                throw std::runtime_error("Traces " + std::to_string(range.first) + "-" +
+                                         std::to_string(range.first + range.count - 1) + " are beyond the " +
+                                         std::to_string(num_traces) + " traces of " + source_path);
+            }
+            copyRange(in_fd, layout.data_offset + range.first * trace_size, range.count * trace_size);
+            stats_.traces += range.count;
+            stats_.bytes += range.count * trace_size;
+            ++stats_.runs;
+        }
+        ++stats_.files;
+    } catch (...) {
+        ::close(in_fd);
+        throw;
+    }
+    ::close(in_fd);
+}
+
+void SegyExtractWriter::copyRange(int in_fd, uint64_t offset, uint64_t length) {
+#ifdef __linux__
+    // In-kernel copies; both write at the output's file position like write() below.
+    // EXDEV, EINVAL and friends mean the pair of files does not support the call:
+    // fall back for this and all later runs.
+    if (method_ == CopyMethod::CopyFileRange) {
+        loff_t in_offset = static_cast<loff_t>(offset);
+        while (length > 0) {
+            ssize_t n = ::copy_file_range(in_fd, &in_offset, fd_, nullptr,
+                                          static_cast<size_t>(std::min(length, kMaxKernelCopy)), 0);
+            if (n > 0) {
+                length -= static_cast<uint64_t>(n);
+                continue;
+            }
+            if (n == 0) throw std::runtime_error("Unexpected end of input while copying to " + tmp_path_);
+            if (errno == EINTR) continue;
+            if (errno != EXDEV && errno != EINVAL && errno != ENOSYS && errno != EOPNOTSUPP && errno != EPERM) {
+                throw std::runtime_error(systemError("Failed to copy traces to " + tmp_path_));
+            }
+            method_ = CopyMethod::Sendfile;
+            stats_.method = "sendfile";
+            break;
+        }
+        offset = static_cast<uint64_t>(in_offset);
+    }
+    if (method_ == CopyMethod::Sendfile) {
+        off_t in_offset = static_cast<off_t>(offset);
+        while (length > 0) {
+            ssize_t n = ::sendfile(fd_, in_fd, &in_offset, static_cast<size_t>(std::min(length, kMaxKernelCopy)));
+            if (n > 0) {
+                length -= static_cast<uint64_t>(n);
+                continue;
+            }
+            if (n == 0) throw std::runtime_error("Unexpected end of input while copying to " + tmp_path_);
+            if (errno == EINTR) continue;
+            if (errno != EINVAL && errno != ENOSYS) {
+                throw std::runtime_error(systemError("Failed to copy traces to " + tmp_path_));
+            }
+            method_ = CopyMethod::ReadWrite;
+            stats_.method = "read/write";
+            break;
+        }
+        offset = static_cast<uint64_t>(in_offset);
+    }
+#else
+    method_ = CopyMethod::ReadWrite;
+    stats_.method = "read/write";
+#endif
+    if (length == 0) return;
+    buffer_.resize(kCopyBufferSize);
+    while (length > 0) {
+        const size_t chunk = static_cast<size_t>(std::min<uint64_t>(length, buffer_.size()));
+        ssize_t n = ::pread(in_fd, buffer_.data(), chunk, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) throw std::runtime_error(systemError("Failed to read traces for " + tmp_path_));
+        if (n == 0) throw std::runtime_error("Unexpected end of input while copying to " + tmp_path_);
+        writeAll(buffer_.data(), static_cast<size_t>(n));
+        offset += static_cast<uint64_t>(n);
+        length -= static_cast<uint64_t>(n);
+    }
+}
+
+void SegyExtractWriter::appendCompressed(const std::string& source_path, const std::vector<TraceRange>& ranges) {
+    // No random access into a compressed stream: decompress up to the last selected
+    // trace, skipping the gaps, and write the runs through the buffer
+    std::unique_ptr<CompressedInput> input = openCompressedInput(source_path, detectCompression(source_path));
+    auto read = [&](char* dst, size_t size) { return input->read(dst, size); };
+    SegyLayout layout;
+    std::vector<char> headers = readFileHeaders(source_path, read, layout);
+    useHeaders(source_path, std::move(headers));
+
+    const uint64_t trace_size = layout.traceSize();
+    uint64_t position = layout.data_offset;
+    buffer_.resize(kCopyBufferSize);
+    stats_.method = "read/write";
+    for (const auto& range : ranges) {
+        const uint64_t offset = layout.data_offset + range.first * trace_size;
+        if (offset < position || input->skip(offset - position) != offset - position) {
+            throw std::runtime_error("Traces " + std::to_string(range.first) + "-" +
+                                     std::to_string(range.first + range.count - 1) + " are beyond the end of " +
+                                     source_path);
+        }
+        uint64_t length = range.count * trace_size;
+        position = offset + length;
+        while (length > 0) {
+            const size_t chunk = static_cast<size_t>(std::min<uint64_t>(length, buffer_.size()));
+            if (input->read(buffer_.data(), chunk) != chunk) {
+                throw std::runtime_error("Unexpected end of " + source_path + " while copying traces");
+            }
+            writeAll(buffer_.data(), chunk);
+            length -= chunk;
+        }
+        stats_.traces += range.count;
+        stats_.bytes += range.count * trace_size;
+        ++stats_.runs;
+    }
+    ++stats_.files;
+}
+
+void SegyExtractWriter::commit() {
+    if (fd_ < 0) {
+        throw std::logic_error("SegyExtractWriter::commit called twice");
+    }
+    if (have_headers_ && layout_.revision >= 2) {
+        // Binary header: number of traces (3513, uint64) and trailer records (3529)
+        uint8_t fields[20] = {};
+        put_u32_be(fields, static_cast<uint32_t>(stats_.traces >> 32));
+        put_u32_be(fields + 4, static_cast<uint32_t>(stats_.traces));
+        if (::pwrite(fd_, fields, 8, 3200 + 312) != 8 || ::pwrite(fd_, fields + 16, 4, 3200 + 328) != 4) {
+            throw std::runtime_error(systemError("Failed to update the binary header of " + tmp_path_));
+        }
+    }
+    if (::close(fd_) != 0) {
+        fd_ = -1;
+        throw std::runtime_error(systemError("Failed to write " + tmp_path_));
+    }
+    fd_ = -1;
+    if (std::rename(tmp_path_.c_str(), path_.c_str()) != 0) {
+        throw std::runtime_error(systemError("Cannot rename " + tmp_path_ + " to " + path_));
+    }
+    committed_ = true;
+}
+
+#else
+
+SegyExtractWriter::SegyExtractWriter(const std::string& path) : path_(path), tmp_path_(path + ".tmp") {
+    throw std::runtime_error("SEG-Y extraction is not supported on this platform");
+}
+
+SegyExtractWriter::~SegyExtractWriter() {}
+void SegyExtractWriter::append(const std::string&, const std::vector<TraceRange>&) {}
+void SegyExtractWriter::commit() {}
+void SegyExtractWriter::copyRange(int, uint64_t, uint64_t) {}
+void SegyExtractWriter::appendCompressed(const std::string&, const std::vector<TraceRange>&) {}
+void SegyExtractWriter::useHeaders(const std::string&, std::vector<char>) {}
+void SegyExtractWriter::writeAll(const char*, size_t) {}
+
+#endif
@@ -0,0 +1,349 @@
+#include "CompressedInput.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#ifdef SCANSEGY_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef SCANSEGY_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+std::string lowerExtension(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return "";
+    std::string ext = path.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext;
+}
+
+} // namespace
+
+Compression compressionFromExtension(const std::string& path) {
+    std::string ext = lowerExtension(path);
+    if (ext == ".gz") return Compression::Gzip;
+    if (ext == ".zst" || ext == ".zstd") return Compression::Zstd;
+    return Compression::None;
+}
+
+Compression detectCompression(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    unsigned char magic[4] = {0, 0, 0, 0};
+    file.read(reinterpret_cast<char*>(magic), sizeof(magic));
+    if (file.gcount() >= 2 && magic[0] == 0x1F && magic[1] == 0x8B) {
+        return Compression::Gzip;
+    }
+    if (file.gcount() == 4) {
+        // Обычный фрейм zstd или skippable-фрейм (0x184D2A50..0x184D2A5F, little-endian)
+        if (magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD) return Compression::Zstd;
+        if ((magic[0] & 0xF0) == 0x50 && magic[1] == 0x2A && magic[2] == 0x4D && magic[3] == 0x18) return Compression::Zstd;
+    }
+    return Compression::None;
+}
+
+bool isCompressionSupported(Compression compression) {
+    switch (compression) {
+        case Compression::None: return true;
+#ifdef SCANSEGY_HAVE_ZLIB
+        case Compression::Gzip: return true;
+#endif
+#ifdef SCANSEGY_HAVE_ZSTD
+        case Compression::Zstd: return true;
+#endif
+        default: return false;
+    }
+}
+
+const char* compressionName(Compression compression) {
+    switch (compression) {
+        case Compression::Gzip: return "gzip";
+        case Compression::Zstd: return "zstd";
+        default: return "none";
+    }
+}
+
+std::string stripCompressionExtension(const std::string& path) {
+    if (compressionFromExtension(path) == Compression::None) return path;
+    return path.substr(0, path.find_last_of('.'));
+}
+
+uint64_t CompressedInput::skip(uint64_t size) {
+    uint64_t done = 0;
+    while (done < size) {
+        size_t step = static_cast<size_t>(std::min<uint64_t>(size - done, 1u << 30));
+        size_t n = read(nullptr, step);
+        done += n;
+        if (n < step) break;
+    }
+    return done;
+}
+
+namespace {
+
+#ifdef SCANSEGY_HAVE_ZLIB
+// gzip через zlib; поддерживает конкатенацию gzip-членов (pigz, cat a.gz b.gz)
+class GzipInput : public CompressedInput {
+public:
+    explicit GzipInput(const std::string& path)
+        : path_(path), file_(path, std::ios::binary), in_(1u << 20), scratch_(1u << 18) {
+        if (!file_.is_open()) {
+            throw std::runtime_error("Cannot open SEGY file: " + path);
+        }
+        std::memset(&zs_, 0, sizeof(zs_));
+        if (inflateInit2(&zs_, 15 + 32) != Z_OK) {
+            throw std::runtime_error("Cannot initialize gzip decoder for " + path);
+        }
+    }
+    ~GzipInput() override { inflateEnd(&zs_); }
+
+    size_t read(char* dst, size_t size) override {
+        size_t total = 0;
+        while (total < size && !eof_) {
+            if (zs_.avail_in == 0 && !fill()) {
+                eof_ = true; // обрезанный поток: читатель получит неполную трассу
+                break;
+            }
+            char* out = dst ? dst + total : scratch_.data();
+            size_t want = size - total;
+            if (!dst) want = std::min(want, scratch_.size());
+            want = std::min<size_t>(want, UINT_MAX);
+
+            zs_.next_out = reinterpret_cast<Bytef*>(out);
+            zs_.avail_out = static_cast<uInt>(want);
+            int ret = inflate(&zs_, Z_NO_FLUSH);
+            total += want - zs_.avail_out;
+
+            if (ret == Z_STREAM_END) {
+                // Следующий gzip-член или конец файла (нулевое выравнивание после архива игнорируется)
+                if (zs_.avail_in == 0) fill();
+                if (zs_.avail_in == 0 || zs_.next_in[0] != 0x1F) {
+                    eof_ = true;
+                } else {
+                    inflateReset(&zs_);
+                }
+            } else if (ret == Z_BUF_ERROR && zs_.avail_in == 0) {
+                continue; // нужно больше входных данных
+            } else if (ret != Z_OK) {
+                throw std::runtime_error("Corrupt gzip data in " + path_ + (zs_.msg ? std::string(": ") + zs_.msg : ""));
+            }
+        }
+        return total;
+    }
+
+private:
+    bool fill() {
+        file_.read(in_.data(), static_cast<std::streamsize>(in_.size()));
+        size_t n = static_cast<size_t>(file_.gcount());
+        zs_.next_in = reinterpret_cast<Bytef*>(in_.data());
+        zs_.avail_in = static_cast<uInt>(n);
+        compressed_read_ += n;
+        return n > 0;
+    }
+
+    std::string path_;
+    std::ifstream file_;
+    z_stream zs_;
+    std::vector<char> in_;
+    std::vector<char> scratch_;
+    bool eof_ = false;
+};
+#endif
+
+#ifdef SCANSEGY_HAVE_ZSTD
+// zstd: последовательности независимых фреймов с известным размером (pzstd, seekable,
+// поблочное сжатие) распаковываются пачками параллельно; одиночные и крупные фреймы -
+// потоково в переиспользуемый буфер
+class ZstdInput : public CompressedInput {
+public:
+    ZstdInput(const std::string& path, unsigned threads)
+        : path_(path), file_(path, std::ios::binary), threads_(threads) {
+        if (!file_.is_open()) {
+            throw std::runtime_error("Cannot open SEGY file: " + path);
+        }
+#ifdef _OPENMP
+        if (threads_ == 0) threads_ = static_cast<unsigned>(omp_get_max_threads());
+#endif
+        if (threads_ == 0) threads_ = 1;
+        dstream_ = ZSTD_createDStream();
+        if (!dstream_) {
+            throw std::runtime_error("Cannot initialize zstd decoder for " + path);
+        }
+    }
+    ~ZstdInput() override { ZSTD_freeDStream(dstream_); }
+
+    size_t read(char* dst, size_t size) override {
+        size_t total = 0;
+        while (total < size) {
+            if (cur_pos_ == cur_len_) {
+                if (!nextBuffer()) break;
+                continue;
+            }
+            size_t n = std::min(size - total, cur_len_ - cur_pos_);
+            if (dst) std::memcpy(dst + total, cur_data_ + cur_pos_, n);
+            total += n;
+            cur_pos_ += n;
+        }
+        return total;
+    }
+
+private:
+    static const size_t kInputWindow = 32u << 20;     // сжатые данные, просматриваемые вперед
+    static const size_t kMaxFrameOutput = 64u << 20;  // крупнее - потоковая распаковка
+    static const size_t kStreamChunk = 1u << 20;
+
+    void fillInput() {
+        if (file_eof_) return;
+        if (in_pos_ > 0) {
+            std::memmove(in_.data(), in_.data() + in_pos_, in_end_ - in_pos_);
+            in_end_ -= in_pos_;
+            in_pos_ = 0;
+        }
+        // Окно растет постепенно: чтение одного заголовка не должно тянуть 32 МБ
+        if (in_.size() < kInputWindow) in_.resize(std::min(kInputWindow, std::max(kStreamChunk, in_.size() * 2)));
+        file_.read(in_.data() + in_end_, static_cast<std::streamsize>(in_.size() - in_end_));
+        size_t n = static_cast<size_t>(file_.gcount());
+        in_end_ += n;
+        compressed_read_ += n;
+        if (n == 0 || !file_) file_eof_ = true;
+    }
+
+    bool nextBuffer() {
+        for (;;) {
+            if (!ready_.empty()) {
+                current_ = std::move(ready_.front());
+                ready_.pop_front();
+                cur_data_ = current_.data();
+                cur_len_ = current_.size();
+                cur_pos_ = 0;
+                return true;
+            }
+            if (!streaming_) {
+                if (in_end_ - in_pos_ < kInputWindow) fillInput();
+                if (in_pos_ == in_end_) return false;
+                if (decodeBatch()) continue;
+                ZSTD_DCtx_reset(dstream_, ZSTD_reset_session_only);
+                streaming_ = true;
+            }
+            size_t produced = streamChunk();
+            if (produced > 0) {
+                cur_data_ = stream_buf_.data();
+                cur_len_ = produced;
+                cur_pos_ = 0;
+                return true;
+            }
+            if (!streaming_ && in_pos_ == in_end_ && file_eof_) return false;
+        }
+    }
+
+    // Параллельная распаковка пачки полных фреймов с известным размером из окна ввода.
+    // false, если таких фреймов меньше двух: тогда выгоднее потоковая распаковка.
+    bool decodeBatch() {
+        std::vector<size_t> offsets, compressed, sizes;
+        uint64_t batch_output = 0;
+        size_t pos = in_pos_;
+        while (offsets.size() < threads_ * 2 && pos < in_end_) {
+            size_t csize = ZSTD_findFrameCompressedSize(in_.data() + pos, in_end_ - pos);
+            if (ZSTD_isError(csize)) break; // фрейм не помещается в окно или поврежден
+            unsigned long long osize = ZSTD_getFrameContentSize(in_.data() + pos, csize);
+            if (osize == ZSTD_CONTENTSIZE_UNKNOWN || osize == ZSTD_CONTENTSIZE_ERROR ||
+                osize > kMaxFrameOutput || batch_output + osize > kMaxFrameOutput * threads_) {
+                break;
+            }
+            offsets.push_back(pos);
+            compressed.push_back(csize);
+            sizes.push_back(static_cast<size_t>(osize));
+            batch_output += osize;
+            pos += csize;
+        }
+        if (offsets.size() < 2) return false;
+
+        std::vector<std::vector<char>> outputs(offsets.size());
+        std::vector<size_t> results(offsets.size(), 0);
+        #pragma omp parallel for num_threads(threads_) schedule(dynamic, 1)
+        for (long i = 0; i < static_cast<long>(offsets.size()); ++i) {
+            outputs[i].resize(sizes[i]);
+            results[i] = ZSTD_decompress(outputs[i].data(), sizes[i], in_.data() + offsets[i], compressed[i]);
+        }
+        for (size_t i = 0; i < results.size(); ++i) {
+            if (ZSTD_isError(results[i])) {
+                throw std::runtime_error("Corrupt zstd frame in " + path_ + ": " + ZSTD_getErrorName(results[i]));
+            }
+            if (!outputs[i].empty()) ready_.push_back(std::move(outputs[i]));
+        }
+        in_pos_ = pos;
+        return true;
+    }
+
+    // Потоковая распаковка текущего фрейма в stream_buf_; streaming_ сбрасывается в конце фрейма
+    size_t streamChunk() {
+        if (stream_buf_.size() < kStreamChunk) stream_buf_.resize(kStreamChunk);
+        ZSTD_outBuffer out = {stream_buf_.data(), stream_buf_.size(), 0};
+        while (out.pos < out.size) {
+            if (in_pos_ == in_end_) {
+                fillInput();
+                if (in_pos_ == in_end_) {
+                    streaming_ = false; // обрезанный фрейм
+                    break;
+                }
+            }
+            ZSTD_inBuffer in = {in_.data() + in_pos_, in_end_ - in_pos_, 0};
+            size_t ret = ZSTD_decompressStream(dstream_, &out, &in);
+            in_pos_ += in.pos;
+            if (ZSTD_isError(ret)) {
+                throw std::runtime_error("Corrupt zstd data in " + path_ + ": " + ZSTD_getErrorName(ret));
+            }
+            if (ret == 0) {
+                streaming_ = false; // конец фрейма
+                break;
+            }
+        }
+        return out.pos;
+    }
+
+    std::string path_;
+    std::ifstream file_;
+    unsigned threads_;
+    ZSTD_DStream* dstream_ = nullptr;
+    bool streaming_ = false;
+
+    std::vector<char> in_;
+    size_t in_pos_ = 0;
+    size_t in_end_ = 0;
+    bool file_eof_ = false;
+
+    std::deque<std::vector<char>> ready_;
+    std::vector<char> current_;
+    std::vector<char> stream_buf_;
+    const char* cur_data_ = nullptr;
+    size_t cur_pos_ = 0;
+    size_t cur_len_ = 0;
+};
+#endif
+
+} // namespace
+
+std::unique_ptr<CompressedInput> openCompressedInput(const std::string& path, Compression compression, unsigned threads) {
+    (void)threads;
+    switch (compression) {
+#ifdef SCANSEGY_HAVE_ZLIB
+        case Compression::Gzip: return std::unique_ptr<CompressedInput>(new GzipInput(path));
+#endif
+#ifdef SCANSEGY_HAVE_ZSTD
+        case Compression::Zstd: return std::unique_ptr<CompressedInput>(new ZstdInput(path, threads));
+#endif
+        default:
+            throw std::runtime_error(std::string("scansegy was built without ") + compressionName(compression) +
+                                     " support: " + path);
+    }
+}
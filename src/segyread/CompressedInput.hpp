@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Сжатые SEG-Y файлы (.sgy.gz, .segy.zst): распаковка потоком, без временных файлов
+enum class Compression { None, Gzip, Zstd };
+
+// По расширению имени файла (.gz, .zst, .zstd)
+Compression compressionFromExtension(const std::string& path);
+// По сигнатуре первых байтов файла (gzip 1F 8B, zstd 28 B5 2F FD)
+Compression detectCompression(const std::string& path);
+// Собрана ли программа с поддержкой данного сжатия (zlib / libzstd)
+bool isCompressionSupported(Compression compression);
+const char* compressionName(Compression compression);
+// "a.sgy.gz" -> "a.sgy"; для несжатых файлов путь не меняется
+std::string stripCompressionExtension(const std::string& path);
+
+/**
+ * @brief Последовательный поток распакованных байтов.
+ *
+ * Длина распакованных данных заранее неизвестна, поэтому читатель запрашивает
+ * данные до конца потока. Пропуск (skip) распаковывает данные без копирования
+ * туда, где это возможно, и никогда не пишет их на диск.
+ */
+class CompressedInput {
+public:
+    virtual ~CompressedInput() = default;
+
+    // Читает до size байт в dst (nullptr - отбросить); меньше только в конце потока
+    virtual size_t read(char* dst, size_t size) = 0;
+    uint64_t skip(uint64_t size);
+
+    // Сколько сжатых байтов прочитано из файла (для прогресса и статистики)
+    uint64_t compressed_bytes_read() const { return compressed_read_; }
+
+protected:
+    uint64_t compressed_read_ = 0;
+};
+
+// threads - число потоков для параллельной распаковки независимых zstd фреймов (0 - все ядра)
+std::unique_ptr<CompressedInput> openCompressedInput(const std::string& path, Compression compression, unsigned threads = 0);
@@ -0,0 +1,123 @@
+#include "HeaderDecodePlan.hpp"
+#include "Kernels.hpp"
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+HeaderDecodePlan::HeaderDecodePlan(const std::vector<HeaderFieldSpec>& fields) : fields_(fields) {
+    ops_.reserve(fields.size());
+    for (size_t i = 0; i < fields.size(); ++i) {
+        const HeaderFieldSpec& field = fields[i];
+        if (field.width != 1 && field.width != 2 && field.width != 4) {
+            throw std::invalid_argument("Unsupported width " + std::to_string(field.width) + " for header field " + field.name);
+        }
+        if (field.byte < 1 || field.byte + field.width - 1 > 240) {
+            throw std::invalid_argument("Header field " + field.name + " is outside the 240-byte trace header");
+        }
+        if (field.width == 4 && !field.is_signed) {
+            // Значения хранятся как int32: u32 выше INT32_MAX стали бы отрицательными
+            throw std::invalid_argument("Header field " + field.name + ": 4-byte fields are signed int32, ':u' is not supported");
+        }
+        if (field.scalar_byte != 0 && (field.scalar_byte < 1 || field.scalar_byte + 1 > 240)) {
+            throw std::invalid_argument("Scalar of header field " + field.name + " is outside the trace header");
+        }
+
+        DecodeOp op;
+        op.offset = static_cast<uint16_t>(field.byte - 1);
+        if (field.width == 4) {
+            op.kind = kI32; // 32-битные поля читаются как int32
+        } else if (field.width == 2) {
+            op.kind = field.is_signed ? kI16 : kU16;
+        } else {
+            op.kind = field.is_signed ? kI8 : kU8;
+        }
+        op.scalar_offset = static_cast<int16_t>(field.scalar_byte - 1);
+        op.dest = static_cast<uint16_t>(i);
+        ops_.push_back(op);
+    }
+
+    bool all_be32 = !ops_.empty();
+    for (const DecodeOp& op : ops_) {
+        all_be32 = all_be32 && op.kind == kI32 && op.scalar_offset < 0;
+    }
+    if (all_be32) {
+        for (const DecodeOp& op : ops_) be32_offsets_.push_back(op.offset);
+    }
+}
+
+void HeaderDecodePlan::decodeBatch(const uint8_t* const* headers, size_t num_headers, int32_t* out) const {
+    if (!be32_offsets_.empty()) {
+        segyKernels().decode_be32_rows(headers, num_headers, be32_offsets_.data(), be32_offsets_.size(), out);
+        return;
+    }
+    for (size_t i = 0; i < num_headers; ++i) {
+        decode(headers[i], out + i * ops_.size());
+    }
+}
+
+int32_t HeaderDecodePlan::applyScalar(int32_t value, int16_t scalar) {
+    if (scalar == 0 || scalar == 1 || scalar == -1) return value;
+    double scaled = scalar > 0 ? static_cast<double>(value) * scalar
+                               : static_cast<double>(value) / -static_cast<double>(scalar);
+    scaled = std::round(scaled);
+    if (scaled > std::numeric_limits<int32_t>::max()) return std::numeric_limits<int32_t>::max();
+    if (scaled < std::numeric_limits<int32_t>::min()) return std::numeric_limits<int32_t>::min();
+    return static_cast<int32_t>(scaled);
+}
+
+HeaderFieldSpec parseHeaderFieldSpec(const std::string& spec) {
+    std::vector<std::string> parts;
+    std::stringstream stream(spec);
+    std::string part;
+    while (std::getline(stream, part, ':')) {
+        parts.push_back(part);
+    }
+    if (parts.size() < 3 || parts[0].empty()) {
+        throw std::invalid_argument("Invalid header field '" + spec + "', expected NAME:BYTE:WIDTH[:u][:scalar=BYTE]");
+    }
+
+    HeaderFieldSpec field;
+    field.name = parts[0];
+    try {
+        field.byte = std::stoi(parts[1]);
+        field.width = std::stoi(parts[2]);
+        for (size_t i = 3; i < parts.size(); ++i) {
+            if (parts[i] == "u") {
+                field.is_signed = false;
+            } else if (parts[i] == "s") {
+                field.is_signed = true;
+            } else if (parts[i].compare(0, 7, "scalar=") == 0) {
+                field.scalar_byte = std::stoi(parts[i].substr(7));
+            } else {
+                throw std::invalid_argument("unknown modifier '" + parts[i] + "'");
+            }
+        }
+    } catch (const std::exception& e) {
+        throw std::invalid_argument("Invalid header field '" + spec + "': " + e.what());
+    }
+
+    // Проверка диапазонов через построение плана из одного поля
+    HeaderDecodePlan check({field});
+    return field;
+}
+
+std::vector<HeaderFieldSpec> loadHeaderFieldSpecs(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open header field file: " + path);
+    }
+
+    std::vector<HeaderFieldSpec> fields;
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos) continue;
+        size_t last = line.find_last_not_of(" \t\r");
+        fields.push_back(parseHeaderFieldSpec(line.substr(first, last - first + 1)));
+    }
+    return fields;
+}
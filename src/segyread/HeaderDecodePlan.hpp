@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Описание поля заголовка трассы, заданное пользователем или встроенное
+struct HeaderFieldSpec {
+    std::string name;
+    int byte = 0;           // 1-based смещение в 240-байтном заголовке
+    int width = 4;          // 1, 2 или 4 байта
+    bool is_signed = true;
+    int scalar_byte = 0;    // 1-based смещение int16 скаляра (соглашение SEG-Y), 0 - без скаляра
+};
+
+/**
+ * @brief Скомпилированный план декодирования заголовка трассы.
+ *
+ * Набор полей один раз превращается в плоский массив операций (смещение, ширина,
+ * знак, скаляр). При декодировании каждого заголовка нет поиска по строкам:
+ * выполняется только проход по массиву операций, значения пишутся в out[i].
+ */
+class HeaderDecodePlan {
+public:
+    HeaderDecodePlan() = default;
+    explicit HeaderDecodePlan(const std::vector<HeaderFieldSpec>& fields);
+
+    size_t size() const { return ops_.size(); }
+    const std::vector<HeaderFieldSpec>& fields() const { return fields_; }
+
+    // Декодирует один big-endian заголовок в out[0 .. size())
+    void decode(const uint8_t* header, int32_t* out) const {
+        for (const DecodeOp& op : ops_) {
+            const uint8_t* p = header + op.offset;
+            int32_t value;
+            switch (op.kind) {
+                case kI32: value = static_cast<int32_t>((uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+                                                        (uint32_t(p[2]) << 8) | uint32_t(p[3])); break;
+                case kU16: value = static_cast<int32_t>((uint32_t(p[0]) << 8) | uint32_t(p[1])); break;
+                case kI16: value = static_cast<int16_t>((uint16_t(p[0]) << 8) | uint16_t(p[1])); break;
+                case kU8:  value = p[0]; break;
+                default:   value = static_cast<int8_t>(p[0]); break;
+            }
+            if (op.scalar_offset >= 0) {
+                value = applyScalar(value, static_cast<int16_t>((uint16_t(header[op.scalar_offset]) << 8) |
+                                                               uint16_t(header[op.scalar_offset + 1])));
+            }
+            out[op.dest] = value;
+        }
+    }
+
+    // Декодирует num_headers заголовков в строки по size() значений. Если все поля -
+    // int32 без скаляров (встроенный набор), работает векторное ядро decode_be32_rows
+    void decodeBatch(const uint8_t* const* headers, size_t num_headers, int32_t* out) const;
+
+    // Скаляр SEG-Y: > 0 - множитель, < 0 - делитель, 0 - без изменения
+    static int32_t applyScalar(int32_t value, int16_t scalar);
+
+private:
+    enum Kind : uint8_t { kI32, kU16, kI16, kU8, kI8 };
+
+    struct DecodeOp {
+        uint16_t offset;        // 0-based
+        Kind kind;
+        int16_t scalar_offset;  // 0-based, -1 - без скаляра
+        uint16_t dest;
+    };
+
+    std::vector<DecodeOp> ops_;
+    std::vector<HeaderFieldSpec> fields_;
+    std::vector<uint16_t> be32_offsets_;  // смещения полей, если все они int32 без скаляров, иначе пусто
+};
+
+// "NAME:BYTE:WIDTH[:u][:scalar=BYTE]", например "ILINE:221:4" или "SHOT:17:4:scalar=71"
+HeaderFieldSpec parseHeaderFieldSpec(const std::string& spec);
+
+// Одно описание поля на строку в том же формате; пустые строки и '#' комментарии пропускаются
+std::vector<HeaderFieldSpec> loadHeaderFieldSpecs(const std::string& path);
@@ -0,0 +1,134 @@
+// Выбор таблицы SegyKernels по cpuid.
+// SCANSEGY_KERNELS_X86 задается CMake, когда в библиотеку собраны варианты KernelsIsa.cpp
+// для SSE4.2, AVX2 и AVX-512; иначе доступна только базовая таблица.
+
+#include "Kernels.hpp"
+#include <cstdlib>
+#include <cstring>
+
+#ifdef SCANSEGY_KERNELS_X86
+#include <cpuid.h>
+#endif
+
+extern const SegyKernels kSegyKernels_generic;
+#ifdef SCANSEGY_KERNELS_X86
+extern const SegyKernels kSegyKernels_sse42;
+extern const SegyKernels kSegyKernels_avx2;
+extern const SegyKernels kSegyKernels_avx512;
+#endif
+
+namespace {
+
+struct IsaLevel {
+    const char* name;
+    const SegyKernels* kernels;
+    bool (*supported)();
+};
+
+#ifdef SCANSEGY_KERNELS_X86
+bool hasSse42() {
+    return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+}
+
+bool hasAvx2() {
+    return hasSse42() && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+           __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2");
+}
+
+bool hasAvx512() {
+    return hasAvx2() && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+           __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq");
+}
+#endif
+
+bool always() { return true; }
+
+// От базового уровня к старшему
+const IsaLevel kLevels[] = {
+    {"generic", &kSegyKernels_generic, always},
+#ifdef SCANSEGY_KERNELS_X86
+    {"sse42", &kSegyKernels_sse42, hasSse42},
+    {"avx2", &kSegyKernels_avx2, hasAvx2},
+    {"avx512", &kSegyKernels_avx512, hasAvx512},
+#endif
+};
+
+const char* requestedIsa() {
+    const char* value = std::getenv("SCANSEGY_ISA");
+    return value && *value ? value : nullptr;
+}
+
+const SegyKernels* selectKernels() {
+#ifdef SCANSEGY_KERNELS_X86
+    __builtin_cpu_init();
+#endif
+    // SCANSEGY_ISA ограничивает уровень сверху; неизвестное имя не ограничивает
+    const char* requested = requestedIsa();
+    const SegyKernels* best = kLevels[0].kernels;
+    for (const IsaLevel& level : kLevels) {
+        if (!level.supported()) break;
+        best = level.kernels;
+        if (requested && std::strcmp(requested, level.name) == 0) break;
+    }
+    return best;
+}
+
+std::string cpuBrand() {
+#ifdef SCANSEGY_KERNELS_X86
+    unsigned int regs[12];
+    if (__get_cpuid_max(0x80000000u, nullptr) < 0x80000004u) return {};
+    for (unsigned int i = 0; i < 3; ++i) {
+        __get_cpuid(0x80000002u + i, &regs[4 * i], &regs[4 * i + 1], &regs[4 * i + 2], &regs[4 * i + 3]);
+    }
+    char brand[sizeof(regs) + 1];
+    std::memcpy(brand, regs, sizeof(regs));
+    brand[sizeof(regs)] = '\0';
+    std::string result(brand);
+    const size_t first = result.find_first_not_of(' ');
+    const size_t last = result.find_last_not_of(' ');
+    return first == std::string::npos ? std::string() : result.substr(first, last - first + 1);
+#else
+    return {};
+#endif
+}
+
+} // namespace
+
+const SegyKernels& segyKernels() {
+    static const SegyKernels* kernels = selectKernels();
+    return *kernels;
+}
+
+const std::vector<std::string>& segyKernelNames() {
+    static const std::vector<std::string> names = {
+        "decode_be32_rows", "minmax_rows", "ibm_to_float", "int32_to_float", "int16_to_float", "ieee_to_float"};
+    return names;
+}
+
+CpuDispatchInfo cpuDispatchInfo() {
+    CpuDispatchInfo info;
+    info.cpu = cpuBrand();
+#ifdef SCANSEGY_KERNELS_X86
+    __builtin_cpu_init();
+    // __builtin_cpu_supports принимает только строковый литерал
+#define SEGY_CPU_FEATURE(name) {name, __builtin_cpu_supports(name) != 0}
+    const struct {
+        const char* name;
+        bool supported;
+    } features[] = {
+        SEGY_CPU_FEATURE("sse4.2"), SEGY_CPU_FEATURE("popcnt"), SEGY_CPU_FEATURE("avx"),
+        SEGY_CPU_FEATURE("avx2"), SEGY_CPU_FEATURE("fma"), SEGY_CPU_FEATURE("bmi"),
+        SEGY_CPU_FEATURE("bmi2"), SEGY_CPU_FEATURE("avx512f"), SEGY_CPU_FEATURE("avx512bw"),
+        SEGY_CPU_FEATURE("avx512vl"), SEGY_CPU_FEATURE("avx512dq"),
+    };
+#undef SEGY_CPU_FEATURE
+    for (const auto& feature : features) {
+        if (feature.supported) info.features.push_back(feature.name);
+    }
+#endif
+    for (const IsaLevel& level : kLevels) info.built.push_back(level.name);
+    const char* requested = requestedIsa();
+    if (requested) info.requested = requested;
+    info.selected = segyKernels().isa;
+    return info;
+}
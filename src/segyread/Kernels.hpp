@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Горячие циклы чтения и агрегации, собранные для нескольких уровней x86 ISA.
+ *
+ * KernelsIsa.cpp компилируется один раз для базовой архитектуры (generic) и, в
+ * переносимой сборке на x86-64, еще раз для SSE4.2, AVX2 и AVX-512. Таблица для
+ * лучшего уровня, который поддерживает процессор, выбирается при первом обращении
+ * по cpuid. Одна и та же сборка работает на любом узле x86-64.
+ */
+struct SegyKernels {
+    const char* isa;  // "generic", "sse42", "avx2", "avx512"
+
+    // Декодирование заголовков: num_headers строк по num_fields big-endian int32,
+    // взятых по смещениям offsets (0-based) из каждого заголовка
+    void (*decode_be32_rows)(const uint8_t* const* headers, size_t num_headers,
+                             const uint16_t* offsets, size_t num_fields, int32_t* out);
+
+    // Минимум и максимум каждого столбца строк по num_columns int32 (num_rows > 0)
+    void (*minmax_rows)(const int32_t* rows, size_t num_rows, size_t num_columns,
+                        int32_t* min_out, int32_t* max_out);
+
+    // Сэмплы big-endian во float: IBM float (код 1, побитово как SegyReader::ibmToIeee),
+    // int32 (код 2), int16 (код 3), IEEE float (код 5)
+    void (*ibm_to_float)(const uint8_t* src, float* dst, size_t n);
+    void (*int32_to_float)(const uint8_t* src, float* dst, size_t n);
+    void (*int16_to_float)(const uint8_t* src, float* dst, size_t n);
+    void (*ieee_to_float)(const uint8_t* src, float* dst, size_t n);
+};
+
+// Таблица, выбранная для этого процессора (потокобезопасно, выбор один раз).
+// Переменная окружения SCANSEGY_ISA=generic|sse42|avx2|avx512 ограничивает уровень сверху.
+const SegyKernels& segyKernels();
+
+// Имена ядер SegyKernels в порядке полей, для --cpu-info
+const std::vector<std::string>& segyKernelNames();
+
+// Сведения для --cpu-info
+struct CpuDispatchInfo {
+    std::string cpu;                    // строка модели процессора (cpuid), если доступна
+    std::vector<std::string> features;  // поддерживаемые расширения, важные для выбора
+    std::vector<std::string> built;     // уровни ISA, собранные в этот бинарный файл
+    std::string requested;              // значение SCANSEGY_ISA, если задано
+    std::string selected;               // уровень выбранной таблицы
+};
+CpuDispatchInfo cpuDispatchInfo();
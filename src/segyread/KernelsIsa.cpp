@@ -0,0 +1,118 @@
+// Реализация SegyKernels для одного уровня ISA. Файл собирается несколько раз с разными
+// флагами (см. CMakeLists.txt) и определенным SEGY_KERNEL_ISA; без него - базовая сборка.
+//
+// Важно: здесь нельзя вызывать inline-функции и шаблоны из общих заголовков (std::min,
+// get_u32_be и т.п.). Их копии, собранные с -mavx512f, компоновщик может выбрать для
+// всей программы, и на старых процессорах она упадет с SIGILL. Все функции ниже имеют
+// внутреннее связывание; из библиотек используется только встроенный memcpy.
+
+#include "Kernels.hpp"
+#include <cstring>
+
+#ifndef SEGY_KERNEL_ISA
+#define SEGY_KERNEL_ISA generic
+#endif
+
+#define SEGY_KERNEL_CONCAT_(a, b) a##b
+#define SEGY_KERNEL_CONCAT(a, b) SEGY_KERNEL_CONCAT_(a, b)
+#define SEGY_KERNEL_STRING_(a) #a
+#define SEGY_KERNEL_STRING(a) SEGY_KERNEL_STRING_(a)
+
+namespace {
+
+// Сдвиги вместо __builtin_bswap32: компиляторы распознают шаблон и векторизуют его (pshufb)
+inline uint32_t loadBe32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+void decodeBe32Rows(const uint8_t* const* headers, size_t num_headers,
+                    const uint16_t* offsets, size_t num_fields, int32_t* out) {
+    for (size_t h = 0; h < num_headers; ++h) {
+        const uint8_t* header = headers[h];
+        int32_t* row = out + h * num_fields;
+        for (size_t f = 0; f < num_fields; ++f) {
+            row[f] = static_cast<int32_t>(loadBe32(header + offsets[f]));
+        }
+    }
+}
+
+// Число столбцов известно при компиляции: внутренний цикл целиком в векторных регистрах
+template <size_t Columns>
+void minmaxFixed(const int32_t* rows, size_t num_rows, int32_t* min_out, int32_t* max_out) {
+    int32_t lo[Columns];
+    int32_t hi[Columns];
+    for (size_t c = 0; c < Columns; ++c) lo[c] = hi[c] = rows[c];
+    for (size_t r = 1; r < num_rows; ++r) {
+        const int32_t* row = rows + r * Columns;
+        for (size_t c = 0; c < Columns; ++c) {
+            lo[c] = row[c] < lo[c] ? row[c] : lo[c];
+            hi[c] = row[c] > hi[c] ? row[c] : hi[c];
+        }
+    }
+    for (size_t c = 0; c < Columns; ++c) {
+        min_out[c] = lo[c];
+        max_out[c] = hi[c];
+    }
+}
+
+void minmaxRows(const int32_t* rows, size_t num_rows, size_t num_columns, int32_t* min_out, int32_t* max_out) {
+    // 14 - столбцы TraceData
+    if (num_columns == 14) {
+        minmaxFixed<14>(rows, num_rows, min_out, max_out);
+        return;
+    }
+    for (size_t c = 0; c < num_columns; ++c) min_out[c] = max_out[c] = rows[c];
+    for (size_t r = 1; r < num_rows; ++r) {
+        const int32_t* row = rows + r * num_columns;
+        for (size_t c = 0; c < num_columns; ++c) {
+            min_out[c] = row[c] < min_out[c] ? row[c] : min_out[c];
+            max_out[c] = row[c] > max_out[c] ? row[c] : max_out[c];
+        }
+    }
+}
+
+// IBM float -> IEEE, побитово совпадает с SegyReader::ibmToIeee: табличные it[ix] и mt[ix]
+// заменены сдвигом shift (mt = 1 << shift, it = 0x20c00000 + shift * 0x00400000),
+// ветвления - выборами, поэтому цикл векторизуется
+void ibmToFloat(const uint8_t* src, float* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        const uint32_t ibm = loadBe32(src + 4 * i);
+        const uint32_t fraction = ibm & 0x00ffffffu;
+        const uint32_t ix = fraction >> 21;
+        const uint32_t shift = ix >= 4 ? 0u : ix >= 2 ? 1u : ix == 1 ? 2u : 3u;
+        const uint32_t iexp = ((ibm & 0x7f000000u) - (0x20c00000u + (shift << 22))) << 1;
+        const uint32_t bits = ((fraction << shift) + iexp) | (ibm & 0x80000000u);
+        const uint32_t result = (ibm & 0x7fffffffu) < 0x00ffffffu ? 0u : bits;
+        std::memcpy(dst + i, &result, sizeof(float));
+    }
+}
+
+void int32ToFloat(const uint8_t* src, float* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) dst[i] = static_cast<float>(static_cast<int32_t>(loadBe32(src + 4 * i)));
+}
+
+void int16ToFloat(const uint8_t* src, float* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = static_cast<int16_t>(static_cast<uint16_t>((src[2 * i] << 8) | src[2 * i + 1]));
+    }
+}
+
+void ieeeToFloat(const uint8_t* src, float* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        const uint32_t bits = loadBe32(src + 4 * i);
+        std::memcpy(dst + i, &bits, sizeof(float));
+    }
+}
+
+} // namespace
+
+extern const SegyKernels SEGY_KERNEL_CONCAT(kSegyKernels_, SEGY_KERNEL_ISA);
+const SegyKernels SEGY_KERNEL_CONCAT(kSegyKernels_, SEGY_KERNEL_ISA) = {
+    SEGY_KERNEL_STRING(SEGY_KERNEL_ISA),
+    decodeBe32Rows,
+    minmaxRows,
+    ibmToFloat,
+    int32ToFloat,
+    int16ToFloat,
+    ieeeToFloat,
+};
@@ -0,0 +1,172 @@
+#include "Progress.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <io.h>
+#define PROGRESS_ISATTY _isatty
+#define PROGRESS_STDOUT_FD 1
+#else
+#include <unistd.h>
+#define PROGRESS_ISATTY isatty
+#define PROGRESS_STDOUT_FD STDOUT_FILENO
+#endif
+
+namespace {
+
+const int kBarWidth = 30;
+
+bool stdoutIsTerminal() {
+    if (!PROGRESS_ISATTY(PROGRESS_STDOUT_FD)) return false;
+    const char* term = std::getenv("TERM");
+    return term == nullptr || std::strcmp(term, "dumb") != 0;
+}
+
+std::string formatDuration(double seconds) {
+    long total = static_cast<long>(seconds + 0.5);
+    std::ostringstream out;
+    if (total >= 3600) {
+        out << total / 3600 << ":" << std::setw(2) << std::setfill('0') << (total / 60) % 60 << ":";
+    } else {
+        out << total / 60 << ":";
+    }
+    out << std::setw(2) << std::setfill('0') << total % 60;
+    return out.str();
+}
+
+} // namespace
+
+ProgressTask::ProgressTask(std::string label)
+    : label_(std::move(label)), start_(std::chrono::steady_clock::now()) {}
+
+ProgressTask::Snapshot ProgressTask::snapshot() const {
+    Snapshot s;
+    s.units = units_.load(std::memory_order_relaxed);
+    s.total_units = total_units_.load(std::memory_order_relaxed);
+    s.bytes = bytes_.load(std::memory_order_relaxed);
+    s.total_bytes = total_bytes_.load(std::memory_order_relaxed);
+    s.elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    return s;
+}
+
+ProgressMode parseProgressMode(const std::string& name) {
+    if (name == "auto") return ProgressMode::Auto;
+    if (name == "bar") return ProgressMode::Bar;
+    if (name == "lines") return ProgressMode::Lines;
+    if (name == "off") return ProgressMode::Off;
+    throw std::invalid_argument("Unknown progress mode: " + name + " (expected auto, bar, lines or off)");
+}
+
+ProgressReporter::ProgressReporter(ProgressMode mode, std::ostream& out,
+                                   std::chrono::milliseconds bar_interval,
+                                   std::chrono::milliseconds lines_interval)
+    : mode_(mode), out_(out) {
+    if (mode_ == ProgressMode::Auto) {
+        mode_ = stdoutIsTerminal() ? ProgressMode::Bar : ProgressMode::Lines;
+    }
+    interval_ = mode_ == ProgressMode::Bar ? bar_interval : lines_interval;
+}
+
+ProgressReporter::~ProgressReporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+std::shared_ptr<ProgressTask> ProgressReporter::start(const std::string& label) {
+    if (mode_ == ProgressMode::Off) return nullptr;
+    auto task = std::make_shared<ProgressTask>(label);
+    std::lock_guard<std::mutex> lock(mutex_);
+    active_.push_back(task);
+    if (!thread_.joinable()) {
+        thread_ = std::thread(&ProgressReporter::run, this);
+    }
+    return task;
+}
+
+void ProgressReporter::finish(const std::shared_ptr<ProgressTask>& task, bool failed) {
+    if (!task) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find(active_.begin(), active_.end(), task);
+    if (it == active_.end()) return;
+    active_.erase(it);
+    render(*task, true, failed);
+}
+
+void ProgressReporter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        if (wake_.wait_for(lock, interval_, [&]() { return stop_; })) break;
+        // Отображается только самая старая из активных задач: строка одна
+        if (!active_.empty()) render(*active_.front(), false);
+    }
+}
+
+// Вызывается под mutex_
+void ProgressReporter::render(const ProgressTask& task, bool final, bool failed) {
+    const ProgressTask::Snapshot s = task.snapshot();
+    const double elapsed = std::max(s.elapsed_s, 1e-9);
+    const double units_per_s = s.units / elapsed;
+    const double mb_per_s = s.bytes / elapsed / (1024.0 * 1024.0);
+
+    // Доля выполненного: по байтам, если их объем известен (сжатые файлы), иначе по трассам
+    double fraction = -1.0;
+    if (final && !failed) {
+        fraction = 1.0;
+    } else if (s.total_bytes > 0) {
+        fraction = std::min(1.0, static_cast<double>(s.bytes) / s.total_bytes);
+    } else if (s.total_units > 0) {
+        fraction = std::min(1.0, static_cast<double>(s.units) / s.total_units);
+    }
+    double eta = -1.0;
+    if (fraction > 0.0) {
+        eta = s.elapsed_s * (1.0 - fraction) / fraction;
+    }
+
+    std::ostringstream line;
+    line << std::fixed;
+    if (mode_ == ProgressMode::Bar) {
+        line << "\r" << task.label() << ": [";
+        int filled = fraction > 0.0 ? static_cast<int>(fraction * kBarWidth + 0.5) : 0;
+        for (int i = 0; i < kBarWidth; ++i) {
+            line << (i < filled ? '#' : '.');
+        }
+        line << "] ";
+        if (fraction >= 0.0) {
+            line << std::setw(3) << static_cast<int>(fraction * 100.0) << "% ";
+        }
+        line << s.units;
+        if (s.total_units > 0) line << "/" << s.total_units;
+        line << " traces, " << std::setprecision(0) << units_per_s << " traces/s, "
+             << std::setprecision(1) << mb_per_s << " MB/s";
+        if (failed) {
+            line << ", failed";
+        } else if (final) {
+            line << ", " << formatDuration(s.elapsed_s);
+        } else if (eta >= 0.0) {
+            line << ", ETA " << formatDuration(eta);
+        }
+        line << "\x1b[K";
+        if (final) line << "\n";
+    } else {
+        line << "progress label=\"" << task.label() << "\""
+             << " state=" << (failed ? "failed" : final ? "done" : "running")
+             << " traces=" << s.units << " total_traces=" << s.total_units
+             << " bytes=" << s.bytes << " total_bytes=" << s.total_bytes
+             << std::setprecision(1) << " percent=" << (fraction >= 0.0 ? fraction * 100.0 : -1.0)
+             << std::setprecision(0) << " traces_per_s=" << units_per_s
+             << std::setprecision(2) << " mb_per_s=" << mb_per_s
+             << std::setprecision(3) << " elapsed_s=" << s.elapsed_s
+             << std::setprecision(1) << " eta_s=" << (final ? 0.0 : eta) << "\n";
+    }
+    out_ << line.str() << std::flush;
+}
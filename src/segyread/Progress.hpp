@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Счетчики прогресса одной операции (например, чтения заголовков одного файла).
+ *
+ * Рабочие потоки только обновляют relaxed-атомики - без блокировок и без вывода.
+ * Отображением занимается ProgressReporter в собственном потоке.
+ */
+class ProgressTask {
+public:
+    explicit ProgressTask(std::string label);
+
+    const std::string& label() const { return label_; }
+
+    // Объем работы, если известен (0 - неизвестен): трассы и байты файла.
+    // Для сжатых файлов число трасс заранее неизвестно, прогресс идет по сжатым байтам.
+    void setTotal(uint64_t units, uint64_t bytes) {
+        total_units_.store(units, std::memory_order_relaxed);
+        total_bytes_.store(bytes, std::memory_order_relaxed);
+    }
+
+    // Несколько рабочих потоков: приращения
+    void add(uint64_t units, uint64_t bytes) {
+        units_.fetch_add(units, std::memory_order_relaxed);
+        bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    // Один поток: текущее положение
+    void update(uint64_t units, uint64_t bytes) {
+        units_.store(units, std::memory_order_relaxed);
+        bytes_.store(bytes, std::memory_order_relaxed);
+    }
+
+    struct Snapshot {
+        uint64_t units;
+        uint64_t total_units;
+        uint64_t bytes;
+        uint64_t total_bytes;
+        double elapsed_s;
+    };
+    Snapshot snapshot() const;
+
+private:
+    std::string label_;
+    std::chrono::steady_clock::time_point start_;
+    std::atomic<uint64_t> units_{0};
+    std::atomic<uint64_t> total_units_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> total_bytes_{0};
+};
+
+enum class ProgressMode {
+    Auto,   // Bar, если stdout - терминал, иначе Lines
+    Bar,    // строка с \r, обновляется на месте
+    Lines,  // машиночитаемые строки "progress key=value ..." для логов
+    Off
+};
+
+// "auto", "bar", "lines", "off"; std::invalid_argument для прочих
+ProgressMode parseProgressMode(const std::string& name);
+
+/**
+ * @brief Вывод прогресса с фиксированной частотой из отдельного потока.
+ *
+ * Строка показывает трассы/с, МБ/с и оценку оставшегося времени. В режиме Lines
+ * строки пишутся реже (раз в lines_interval) и всегда - по завершении задачи.
+ * Поток запускается при первой задаче и останавливается в деструкторе.
+ */
+class ProgressReporter {
+public:
+    explicit ProgressReporter(ProgressMode mode = ProgressMode::Auto, std::ostream& out = std::cout,
+                              std::chrono::milliseconds bar_interval = std::chrono::milliseconds(200),
+                              std::chrono::milliseconds lines_interval = std::chrono::milliseconds(5000));
+    ~ProgressReporter();
+
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+    ProgressMode mode() const { return mode_; }
+
+    // nullptr в режиме Off: вызывающий код передает указатель дальше без проверок
+    std::shared_ptr<ProgressTask> start(const std::string& label);
+    // Итоговая строка задачи (state=done или failed); после нее задача больше не отображается
+    void finish(const std::shared_ptr<ProgressTask>& task, bool failed = false);
+
+private:
+    void run();
+    void render(const ProgressTask& task, bool final, bool failed = false);
+
+    ProgressMode mode_;
+    std::ostream& out_;
+    std::chrono::milliseconds interval_;
+    std::vector<std::shared_ptr<ProgressTask>> active_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::thread thread_;
+};
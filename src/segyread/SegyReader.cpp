@@ -1,16 +1,34 @@
 #include "SegyReader.hpp"
-#include <iostream>
 #include <cstring>
+#include <cmath>
 #include <algorithm>
 #include <stdexcept>
+#include <cstdint>
 #include <unordered_map>
-#include <iomanip>
+#include <memory>
+#include <cerrno>
+#include <cstdlib>
+#include <filesystem>
+#include "SegyUtil.hpp"
+#include "Hash.hpp"
+#include "Kernels.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SEGYREADER_HAVE_DIRECT_IO 1
+#define SEGYREADER_HAVE_PREAD 1
+#endif
 
 // Константы для IBM to IEEE conversion (from sample_segy_io.cpp)
 #define SEGYIO_IEMAXIB 0x7fffffff 
 #define SEGYIO_IEEEMAX 0x7f7fffff 
 #define SEGYIO_IEMINIB 0x00ffffff 
 
+// Счетчики прогресса обновляются пачками: relaxed-запись раз в kProgressStep трасс
+static const size_t kProgressStep = 256;
+
 // Вспомогательные функции теперь принимают файловый поток в качестве аргумента
 void SegyReader::readBinaryHeader(std::ifstream& file) {
     // Чтение бинарного заголовка (400 байт, начиная со смещения 3200)
@@ -21,85 +39,304 @@ void SegyReader::readBinaryHeader(std::ifstream& file) {
     if (file.gcount() != 400) {
         throw std::runtime_error("Failed to read binary header");
     }
+    bytes_read_ += binary_header_.size();
     
-    // Извлечение интервала дискретизации (dt) из бинарного заголовка (смещение 3216, 2 байта)
-    uint16_t dt_us;
-    std::memcpy(&dt_us, binary_header_.data() + 16, sizeof(dt_us));
-    dt_us = swapBytes16(dt_us);
-    
-    if (dt_us == 0) {
-        throw std::runtime_error("Sample interval (dt) is zero in binary header");
-    }
-    
-    // Преобразование из микросекунд в секунды
-    dt_ = dt_us * 1e-6;
-    
-    // Извлечение количества сэмплов на трейс (смещение 3220, 2 байта)
-    uint16_t n_samples_per_trace;
-    std::memcpy(&n_samples_per_trace, binary_header_.data() + 20, sizeof(n_samples_per_trace));
-    n_samples_per_trace = swapBytes16(n_samples_per_trace);
-    
-    if (n_samples_per_trace == 0) {
-        throw std::runtime_error("Number of samples per trace is zero in binary header");
+    parseBinaryHeader();
+}
+
+void SegyReader::parseBinaryHeader() {
+    layout_ = parse_layout(binary_header_.data());
+    num_samples_ = layout_.num_samples;
+    dt_ = layout_.dt;
+    format_code_ = layout_.format_code;
+    bytes_per_sample_ = layout_.bytes_per_sample;
+}
+
+// Число расширенных текстовых заголовков не указано (-1): читаем 3200-байтовые записи
+// после бинарного заголовка до записи ((SEG: EndText))
+void SegyReader::findDataOffset(std::ifstream& file) {
+    if (layout_.data_offset != 0) return;
+    std::vector<char> record(3200);
+    uint64_t offset = 3600;
+    file.seekg(static_cast<std::streamoff>(offset));
+    for (;;) {
+        file.read(record.data(), record.size());
+        if (file.gcount() != static_cast<std::streamsize>(record.size())) {
+            throw std::runtime_error("Extended textual headers are not terminated by ((SEG: EndText))");
+        }
+        bytes_read_ += record.size();
+        offset += record.size();
+        if (is_end_text_record(record.data())) break;
     }
-    
-    num_samples_ = n_samples_per_trace;
+    layout_.data_offset = offset;
 }
 
 // Вспомогательные функции теперь принимают файловый поток в качестве аргумента
 void SegyReader::readTraces(std::ifstream& file) {
-    const size_t trace_header_size = 240;
-    const size_t trace_data_size = num_samples_ * sizeof(uint32_t);
-    const size_t full_trace_size = trace_header_size + trace_data_size;
-    
-    // Начало чтения с 3600 (после текстового и бинарного заголовков)
-    file.seekg(3600);
+    const size_t trace_header_size = kTraceHeaderBytes;
+    // Дополнительные заголовки трассы (rev 2) пропускаются вместе с данными одним seekg
+    const uint64_t skip_size = traceSize() - trace_header_size;
     
-    // Подсчет трейсов путем чтения файла
-    std::streampos current_pos = 3600;
+    // Подсчет трейсов по размеру файла
     file.seekg(0, std::ios::end);
     std::streampos file_size = file.tellg();
-    file.seekg(current_pos);
     
-    num_traces_ = (file_size - current_pos) / full_trace_size;
+    num_traces_ = countTraces(static_cast<uint64_t>(file_size));
     
-    if (num_traces_ == 0) {
-        throw std::runtime_error("No traces found in SEGY file");
-    }
+    // Начало чтения с первой трассы (после текстового, бинарного и расширенных текстовых заголовков)
+    file.seekg(static_cast<std::streamoff>(layout_.data_offset));
     
     // Изменение размера векторов для хранения только заголовков трейсов
-    trace_headers_.resize(num_traces_);
+    trace_headers_.resize(num_traces_ * trace_header_size);
     // Не выделяем память для traces_ - они не нужны для сканирования
     
-    // Скрываем курсор перед началом чтения трейсов
-    std::cout << "\x1b[?25l";
+    // При хешировании сэмплов остаток трассы читается, а не пропускается
+    std::vector<char> rest;
+    const uint64_t sample_offset = layout_.traceHeaderSize() - trace_header_size;
+    if (options_.hash_samples) {
+        rest.resize(skip_size);
+        sample_hashes_.resize(num_traces_);
+    }
+    
+    const uint64_t full_trace_size = traceSize();
+    if (options_.progress) options_.progress->setTotal(num_traces_, num_traces_ * full_trace_size);
     
     // Чтение только заголовков трейсов
     for (size_t i = 0; i < num_traces_; ++i) {
         // Чтение заголовка трейса
-        trace_headers_[i].resize(trace_header_size);
-        file.read(trace_headers_[i].data(), trace_header_size);
+        file.read(trace_headers_.data() + i * trace_header_size, trace_header_size);
         
         if (file.gcount() != trace_header_size) {
             throw std::runtime_error("Failed to read trace header " + std::to_string(i));
         }
+        bytes_read_ += trace_header_size;
         
-        // Пропускаем данные трейса - они не нужны для сканирования
-        file.seekg(trace_data_size, std::ios::cur);
+        if (options_.hash_samples) {
+            file.read(rest.data(), rest.size());
+            if (static_cast<uint64_t>(file.gcount()) != skip_size) {
+                throw std::runtime_error("Failed to read trace " + std::to_string(i));
+            }
+            bytes_read_ += skip_size;
+            sample_hashes_[i] = xxhash64(rest.data() + sample_offset, skip_size - sample_offset);
+        } else {
+            // Пропускаем данные трейса - они не нужны для сканирования
+            file.seekg(static_cast<std::streamoff>(skip_size), std::ios::cur);
+        }
         
-        // Show progress every 500 traces or at the end
-        if ((i + 1) % 500 == 0 || i == num_traces_ - 1) {
-            print_progress_bar("Reading headers from disk", i + 1, num_traces_);
+        if (options_.progress && ((i + 1) % kProgressStep == 0 || i == num_traces_ - 1)) {
+            options_.progress->update(i + 1, (i + 1) * full_trace_size);
         }
     }
+}
+
+// Сжатый файл (gzip / zstd): распакованный поток читается последовательно, данные трасс
+// распаковываются и отбрасываются без записи на диск. Число трасс заранее неизвестно -
+// читаем до конца потока, неполная последняя трасса отбрасывается (как в countTraces).
+void SegyReader::readTracesCompressed() {
+    std::unique_ptr<CompressedInput> input = openCompressedInput(file_path_, compression_, options_.decompress_threads);
+    const size_t trace_header_size = kTraceHeaderBytes;
+    
+    std::vector<char> text_header(3200);
+    binary_header_.resize(400);
+    if (input->read(text_header.data(), text_header.size()) != text_header.size() ||
+        input->read(binary_header_.data(), binary_header_.size()) != binary_header_.size()) {
+        throw std::runtime_error("Failed to read binary header");
+    }
+    parseBinaryHeader();
+    
+    // Расширенные текстовые заголовки: известное число записей или до ((SEG: EndText))
+    uint64_t position = 3600;
+    if (layout_.data_offset != 0) {
+        if (layout_.data_offset < position ||
+            input->skip(layout_.data_offset - position) != layout_.data_offset - position) {
+            throw std::runtime_error("Failed to skip extended textual headers");
+        }
+    } else {
+        for (;;) {
+            if (input->read(text_header.data(), text_header.size()) != text_header.size()) {
+                throw std::runtime_error("Extended textual headers are not terminated by ((SEG: EndText))");
+            }
+            position += text_header.size();
+            if (is_end_text_record(text_header.data())) break;
+        }
+        layout_.data_offset = position;
+    }
+    
+    // Поток не позволяет узнать размер трейлера заранее: при указанном в заголовке
+    // числе трасс чтение останавливается на нем, иначе на неполной трассе
+    const uint64_t max_traces = layout_.declared_traces != 0 ? layout_.declared_traces : UINT64_MAX;
+    const uint64_t skip_size = traceSize() - trace_header_size;
+    uint64_t compressed_size = 0;
+    try {
+        compressed_size = std::filesystem::file_size(file_path_);
+    } catch (const std::exception&) {
+        compressed_size = 0;
+    }
     
-    // Показываем курсор обратно после завершения чтения
-    std::cout << "\x1b[?25h";
+    // Число трасс неизвестно: доля выполненного - по сжатым байтам
+    if (options_.progress) options_.progress->setTotal(0, compressed_size);
+    
+    std::vector<char> header(trace_header_size);
+    std::vector<char> rest(options_.hash_samples ? skip_size : 0);
+    const uint64_t sample_offset = layout_.traceHeaderSize() - trace_header_size;
+    size_t traces_read = 0;
+    while (traces_read < max_traces &&
+           input->read(header.data(), trace_header_size) == trace_header_size &&
+           (options_.hash_samples ? input->read(rest.data(), skip_size) : input->skip(skip_size)) == skip_size) {
+        trace_headers_.insert(trace_headers_.end(), header.begin(), header.end());
+        if (options_.hash_samples) {
+            sample_hashes_.push_back(xxhash64(rest.data() + sample_offset, skip_size - sample_offset));
+        }
+        ++traces_read;
+        
+        if (options_.progress && traces_read % kProgressStep == 0) {
+            options_.progress->update(traces_read, input->compressed_bytes_read());
+        }
+    }
+    if (options_.progress) options_.progress->update(traces_read, input->compressed_bytes_read());
+    
+    num_traces_ = traces_read;
+    bytes_read_ = input->compressed_bytes_read();
+    if (num_traces_ == 0) {
+        throw std::runtime_error("No traces found in SEGY file");
+    }
+}
+
+size_t SegyReader::countTraces(uint64_t file_size) const {
+    const uint64_t count64 = layout_.countTraces(file_size);
+    if (count64 > SIZE_MAX) {
+        throw std::runtime_error("SEGY file has more traces than this platform can address: " + file_path_);
+    }
+    const size_t count = static_cast<size_t>(count64);
+    if (count == 0) {
+        throw std::runtime_error("No traces found in SEGY file");
+    }
+    return count;
 }
 
+// Чтение заголовков в обход page cache. Заголовки извлекаются из выровненных блоков,
+// соседние блоки объединяются в один запрос, если разрыв между ними не превышает
+// direct_io_max_gap. Возвращает false, если прямой ввод-вывод недоступен.
+bool SegyReader::readTracesDirect() {
+#ifdef SEGYREADER_HAVE_DIRECT_IO
+    const uint64_t align = 4096;
+    const uint64_t trace_header_size = kTraceHeaderBytes;
+    const uint64_t full_trace_size = traceSize();
+    
+#ifdef O_DIRECT
+    int fd = ::open(file_path_.c_str(), O_RDONLY | O_DIRECT);
+#else
+    int fd = ::open(file_path_.c_str(), O_RDONLY);
+    if (fd >= 0 && fcntl(fd, F_NOCACHE, 1) != 0) {
+        ::close(fd);
+        return false;
+    }
+#endif
+    if (fd < 0) {
+        return false;
+    }
+    std::unique_ptr<int, void (*)(int*)> fd_guard(&fd, [](int* f) { ::close(*f); });
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return false;
+    }
+    const uint64_t file_size = static_cast<uint64_t>(st.st_size);
+    const size_t count = countTraces(file_size);
+    
+    // Читаемая часть трассы: заголовок, а при хешировании сэмплов - вся трасса
+    const uint64_t span = options_.hash_samples ? full_trace_size : trace_header_size;
+    
+    // Буфер должен вмещать одну такую часть, пересекающую границу блока
+    const uint64_t buffer_size = std::max<uint64_t>(
+        (options_.direct_io_buffer_size + align - 1) / align * align, (span + align - 1) / align * align + align);
+    void* raw = nullptr;
+    if (posix_memalign(&raw, align, buffer_size) != 0) {
+        throw std::runtime_error("Cannot allocate aligned buffer for direct I/O");
+    }
+    std::unique_ptr<char, void (*)(void*)> buffer(static_cast<char*>(raw), std::free);
+    
+    auto header_offset = [&](size_t i) { return traceOffset(i); };
+    auto align_down = [&](uint64_t v) { return v / align * align; };
+    auto align_up = [&](uint64_t v) { return (v + align - 1) / align * align; };
+    
+    std::vector<char> headers(count * trace_header_size);
+    std::vector<uint64_t> sample_hashes(options_.hash_samples ? count : 0);
+    uint64_t bytes_read = 0;
+    
+    if (options_.progress) options_.progress->setTotal(count, count * full_trace_size);
+    
+    size_t i = 0;
+    while (i < count) {
+        // Окно чтения: выровненный диапазон, покрывающий заголовки [i, j)
+        const uint64_t window_start = align_down(header_offset(i));
+        uint64_t window_end = align_up(header_offset(i) + span);
+        size_t j = i + 1;
+        while (j < count) {
+            uint64_t block_start = align_down(header_offset(j));
+            uint64_t block_end = align_up(header_offset(j) + span);
+            if (block_end - window_start > buffer_size) break;
+            if (block_start > window_end && block_start - window_end > options_.direct_io_max_gap) break;
+            window_end = block_end;
+            ++j;
+        }
+        
+        const uint64_t length = window_end - window_start;
+        uint64_t done = 0;
+        while (done < length) {
+            ssize_t n = ::pread(fd, buffer.get() + done, length - done, static_cast<off_t>(window_start + done));
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EINVAL && bytes_read == 0) {
+                    // Файловая система приняла O_DIRECT при открытии, но отвергает выровненное чтение
+                    return false;
+                }
+                throw std::runtime_error("Direct read failed at offset " + std::to_string(window_start + done) +
+                                         ": " + std::strerror(errno));
+            }
+            if (n == 0) break; // конец файла внутри последнего блока
+            done += static_cast<uint64_t>(n);
+        }
+        bytes_read += done;
+        
+        for (size_t k = i; k < j; ++k) {
+            const uint64_t offset = header_offset(k) - window_start;
+            if (offset + span > done) {
+                throw std::runtime_error("Failed to read trace header " + std::to_string(k));
+            }
+            std::memcpy(headers.data() + k * trace_header_size, buffer.get() + offset, trace_header_size);
+            if (options_.hash_samples) {
+                const uint64_t samples = layout_.traceHeaderSize();
+                sample_hashes[k] = xxhash64(buffer.get() + offset + samples, full_trace_size - samples);
+            }
+        }
+        // Одно обновление на окно чтения
+        if (options_.progress) options_.progress->update(j, j * full_trace_size);
+        i = j;
+    }
+    
+    num_traces_ = count;
+    trace_headers_.swap(headers);
+    sample_hashes_.swap(sample_hashes);
+    bytes_read_ += bytes_read;
+    return true;
+#else
+    return false;
+#endif
+}
 
-SegyReader::SegyReader(const std::string& file_path) 
-    : file_path_(file_path), num_traces_(0), num_samples_(0), dt_(0.0) {
+SegyReader::SegyReader(const std::string& file_path, const SegyReaderOptions& options) 
+    : file_path_(file_path), num_traces_(0), num_samples_(0), dt_(0.0),
+      format_code_(0), bytes_per_sample_(sizeof(uint32_t)), bytes_read_(0),
+      direct_io_active_(false), compression_(Compression::None), options_(options),
+      trace_cache_(new TraceCache(options.trace_cache_bytes)) {
+    // Сжатые файлы распознаются по сигнатуре, независимо от расширения
+    compression_ = detectCompression(file_path_);
+    if (compression_ != Compression::None) {
+        readTracesCompressed();
+        return;
+    }
+    
     // Эта функция теперь управляет единым потоком файла
     std::ifstream file(file_path_, std::ios::binary);
     if (!file.is_open()) {
@@ -108,29 +345,195 @@ SegyReader::SegyReader(const std::string& file_path)
     
     // Чтение бинарного заголовка для получения метаданных
     readBinaryHeader(file);
+    findDataOffset(file);
+    
+    if (!options_.read_headers) {
+        // Только число трасс; трассы и заголовки читаются по требованию
+        file.seekg(0, std::ios::end);
+        num_traces_ = countTraces(static_cast<uint64_t>(file.tellg()));
+    } else {
+        // Чтение только заголовков трейсов (данные трасс не нужны для сканирования)
+        if (options_.direct_io) {
+            direct_io_active_ = readTracesDirect();
+        }
+        if (!direct_io_active_) {
+            readTraces(file);
+        }
+    }
     
-    // Чтение только заголовков трейсов (данные трасс не нужны для сканирования)
-    readTraces(file);
+#ifdef SEGYREADER_HAVE_PREAD
+    // Дескриптор для произвольного доступа к трассам (pread потокобезопасен)
+    data_fd_ = ::open(file_path_.c_str(), O_RDONLY);
+    if (data_fd_ < 0) {
+        throw std::runtime_error("Cannot open SEGY file: " + file_path_);
+    }
+#endif
     
     // Файл закроется автоматически при выходе из области видимости (RAII)
 }
 
-const std::vector<float>& SegyReader::getTrace(size_t trace_index) const {
+SegyReader::~SegyReader() {
+#ifdef SEGYREADER_HAVE_PREAD
+    if (data_fd_ >= 0) ::close(data_fd_);
+#endif
+}
+
+void SegyReader::checkTraceIndex(size_t trace_index) const {
     if (trace_index >= num_traces_) {
         throw std::out_of_range("Trace index " + std::to_string(trace_index) + 
                                " is out of range (max: " + std::to_string(num_traces_ - 1) + ")");
     }
-    // Данные трасс не загружены для сканирования - возвращаем пустой вектор
-    static const std::vector<float> empty_trace;
-    return empty_trace;
 }
 
-const std::vector<char>& SegyReader::getTraceHeader(size_t trace_index) const {
-    if (trace_index >= num_traces_) {
-        throw std::out_of_range("Trace index " + std::to_string(trace_index) + 
-                               " is out of range (max: " + std::to_string(num_traces_ - 1) + ")");
+std::shared_ptr<const std::vector<float>> SegyReader::getTrace(size_t trace_index) const {
+    checkTraceIndex(trace_index);
+    if (compression_ != Compression::None) {
+        throw std::runtime_error("Random trace access is not supported for compressed file: " + file_path_);
+    }
+    
+    if (auto cached = trace_cache_->find(trace_index)) {
+        return cached;
+    }
+    
+    // Промах: при просмотре сейсмограмм следующими обычно запрашиваются соседние трассы
+    if (options_.prefetch_traces > 0) {
+        size_t first = trace_index > options_.prefetch_traces ? trace_index - options_.prefetch_traces : 0;
+        prefetchTraces(first, trace_index + options_.prefetch_traces + 1 - first);
+    }
+    
+    const size_t data_size = num_samples_ * bytes_per_sample_;
+    std::vector<char> raw(data_size);
+    readAt(raw.data(), data_size, traceOffset(trace_index) + layout_.traceHeaderSize());
+    
+    auto trace = std::make_shared<std::vector<float>>(num_samples_);
+    decodeSamples(reinterpret_cast<const uint8_t*>(raw.data()), trace->data());
+    // Если другой поток успел прочитать ту же трассу, возвращается его копия
+    return trace_cache_->insert(trace_index, std::move(trace));
+}
+
+const char* SegyReader::getTraceHeader(size_t trace_index) const {
+    checkTraceIndex(trace_index);
+    if (trace_headers_.empty()) {
+        throw std::logic_error("Trace headers are not loaded (read_headers = false), use readTraceHeader");
+    }
+    return trace_headers_.data() + trace_index * kTraceHeaderBytes;
+}
+
+std::vector<char> SegyReader::readTraceHeader(size_t trace_index) const {
+    checkTraceIndex(trace_index);
+    if (!trace_headers_.empty()) {
+        const char* header = getTraceHeader(trace_index);
+        return std::vector<char>(header, header + kTraceHeaderBytes);
+    }
+    std::vector<char> header(kTraceHeaderBytes);
+    readAt(header.data(), header.size(), traceOffset(trace_index));
+    return header;
+}
+
+std::vector<char> SegyReader::readTraceSamples(size_t trace_index) const {
+    checkTraceIndex(trace_index);
+    if (compression_ != Compression::None) {
+        throw std::runtime_error("Random trace access is not supported for compressed file: " + file_path_);
+    }
+    std::vector<char> samples(num_samples_ * bytes_per_sample_);
+    readAt(samples.data(), samples.size(), traceOffset(trace_index) + layout_.traceHeaderSize());
+    return samples;
+}
+
+void SegyReader::prefetchTraces(size_t first, size_t count) const {
+    if (compression_ != Compression::None || first >= num_traces_ || count == 0) return;
+    count = std::min(count, num_traces_ - first);
+#if defined(SEGYREADER_HAVE_PREAD) && defined(POSIX_FADV_WILLNEED)
+    // Только подсказка: ядро читает диапазон асинхронно, ошибки не важны
+    posix_fadvise(data_fd_, static_cast<off_t>(traceOffset(first)),
+                  static_cast<off_t>(count * traceSize()), POSIX_FADV_WILLNEED);
+#endif
+}
+
+void SegyReader::readAt(char* dst, size_t size, uint64_t offset) const {
+#ifdef SEGYREADER_HAVE_PREAD
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::pread(data_fd_, dst + done, size - done, static_cast<off_t>(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Read failed at offset " + std::to_string(offset + done) +
+                                     ": " + std::strerror(errno));
+        }
+        if (n == 0) {
+            throw std::runtime_error("Unexpected end of file at offset " + std::to_string(offset + done));
+        }
+        done += static_cast<size_t>(n);
+    }
+#else
+    // Без pread: отдельный поток на каждое чтение, чтобы вызовы оставались потокобезопасными
+    std::ifstream file(file_path_, std::ios::binary);
+    file.seekg(static_cast<std::streamoff>(offset));
+    file.read(dst, static_cast<std::streamsize>(size));
+    if (static_cast<size_t>(file.gcount()) != size) {
+        throw std::runtime_error("Unexpected end of file at offset " + std::to_string(offset));
+    }
+#endif
+}
+
+// Декодирование сэмплов трассы (big-endian) во float по коду формата
+void SegyReader::decodeSamples(const uint8_t* src, float* dst) const {
+    const size_t n = num_samples_;
+    switch (format_code_) {
+        // Основные форматы - через ядра, выбранные под процессор (Kernels.hpp)
+        case 1: // IBM float
+            segyKernels().ibm_to_float(src, dst, n);
+            break;
+        case 2:
+            segyKernels().int32_to_float(src, dst, n);
+            break;
+        case 3:
+            segyKernels().int16_to_float(src, dst, n);
+            break;
+        case 5: // IEEE float
+            segyKernels().ieee_to_float(src, dst, n);
+            break;
+        case 6: // IEEE double
+        case 9: // int64
+        case 12: // uint64
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t bits = (static_cast<uint64_t>(get_u32_be(src + 8 * i)) << 32) | get_u32_be(src + 8 * i + 4);
+                if (format_code_ == 6) {
+                    double value;
+                    std::memcpy(&value, &bits, sizeof(double));
+                    dst[i] = static_cast<float>(value);
+                } else if (format_code_ == 9) {
+                    dst[i] = static_cast<float>(static_cast<int64_t>(bits));
+                } else {
+                    dst[i] = static_cast<float>(bits);
+                }
+            }
+            break;
+        case 7: // int24
+        case 15: // uint24
+            for (size_t i = 0; i < n; ++i) {
+                uint32_t value = (static_cast<uint32_t>(src[3 * i]) << 16) | (src[3 * i + 1] << 8) | src[3 * i + 2];
+                if (format_code_ == 7 && (value & 0x800000)) value |= 0xFF000000u;
+                dst[i] = format_code_ == 7 ? static_cast<float>(static_cast<int32_t>(value)) : static_cast<float>(value);
+            }
+            break;
+        case 8:
+            for (size_t i = 0; i < n; ++i) dst[i] = static_cast<int8_t>(src[i]);
+            break;
+        case 10:
+            for (size_t i = 0; i < n; ++i) dst[i] = static_cast<float>(get_u32_be(src + 4 * i));
+            break;
+        case 11:
+            for (size_t i = 0; i < n; ++i) dst[i] = static_cast<uint16_t>((src[2 * i] << 8) | src[2 * i + 1]);
+            break;
+        case 16:
+            for (size_t i = 0; i < n; ++i) dst[i] = src[i];
+            break;
+        default:
+            // Код 4 (фиксированная точка с усилением) и неизвестные коды
+            throw std::runtime_error("Unsupported data sample format code " + std::to_string(format_code_) +
+                                     " in " + file_path_);
     }
-    return trace_headers_[trace_index];
 }
 
 uint16_t SegyReader::swapBytes16(uint16_t val) const {
@@ -166,13 +569,7 @@ float SegyReader::ibmToIeee(uint32_t ibm) const {
     return result_float;
 }
 
-int32_t SegyReader::get_header_value_i32(size_t trace_index, const std::string& key) const {
-    if (trace_index >= num_traces_) {
-        throw std::out_of_range("Trace index out of range");
-    }
-    
-    const auto& header = trace_headers_[trace_index];
-    
+int SegyReader::header_field_offset(const std::string& key) {
     // Mapping of header field names to byte offsets (1-based)
     static const std::unordered_map<std::string, int> field_offsets = {
         {"FieldRecord", 1}, {"TraceNumber", 5}, {"CDP", 21}, {"EnergySourcePoint", 25},
@@ -182,14 +579,141 @@ int32_t SegyReader::get_header_value_i32(size_t trace_index, const std::string&
     };
     
     auto it = field_offsets.find(key);
-    if (it == field_offsets.end()) {
+    return it == field_offsets.end() ? 0 : it->second;
+}
+
+size_t SegyReader::sample_size_for_format(int format_code) {
+    switch (format_code) {
+        case 1: case 2: case 4: case 5: case 10: return 4;
+        case 3: case 11: return 2;
+        case 6: case 9: case 12: return 8;
+        case 7: case 15: return 3;
+        case 8: case 16: return 1;
+        default: return 0;
+    }
+}
+
+SegyLayout SegyReader::parse_layout(const char* binary_header) {
+    const uint8_t* h = reinterpret_cast<const uint8_t*>(binary_header);
+    auto u16 = [&](size_t offset) { return static_cast<uint16_t>((h[offset] << 8) | h[offset + 1]); };
+    auto u64 = [&](size_t offset) {
+        return (static_cast<uint64_t>(get_u32_be(h + offset)) << 32) | get_u32_be(h + offset + 4);
+    };
+    
+    SegyLayout layout;
+    // Номер ревизии (3501) в файлах rev 0 часто содержит мусор: доверяем только 1 и 2
+    layout.revision = (h[300] == 1 || h[300] == 2) ? h[300] : 0;
+    const bool rev2 = layout.revision == 2;
+    
+    if (rev2 && get_u32_be(h + 96) == 0x04030201u) {
+        // Константа порядка байтов (3297-3300), записанная в little-endian
+        throw std::runtime_error("Little-endian SEG-Y files are not supported");
+    }
+    
+    // Интервал дискретизации в микросекундах (3217); в rev 2 его заменяет double 3273, если задан
+    double dt_us = u16(16);
+    if (rev2) {
+        const uint64_t bits = u64(72);
+        double extended;
+        std::memcpy(&extended, &bits, sizeof(extended));
+        if (extended > 0.0 && std::isfinite(extended)) dt_us = extended;
+    }
+    if (dt_us == 0) {
+        throw std::runtime_error("Sample interval (dt) is zero in binary header");
+    }
+    layout.dt = dt_us * 1e-6;
+    
+    // Количество сэмплов на трассу (3221); в rev 2 его заменяет int32 3269, если задан
+    layout.num_samples = u16(20);
+    if (rev2) {
+        const int32_t extended = static_cast<int32_t>(get_u32_be(h + 68));
+        if (extended < 0) {
+            throw std::runtime_error("Negative extended number of samples in binary header");
+        }
+        if (extended > 0) layout.num_samples = static_cast<size_t>(extended);
+    }
+    if (layout.num_samples == 0) {
+        throw std::runtime_error("Number of samples per trace is zero in binary header");
+    }
+    
+    // Код формата данных (3225) определяет длину трассы на диске
+    layout.format_code = u16(24);
+    layout.bytes_per_sample = sample_size_for_format(layout.format_code);
+    if (layout.bytes_per_sample == 0) {
+        // Неизвестный код формата: сохраняем прежнее поведение (4 байта на сэмпл)
+        layout.bytes_per_sample = sizeof(uint32_t);
+    }
+    
+    if (layout.revision >= 1) {
+        layout.extended_text_headers = static_cast<int16_t>(u16(304));
+        if (layout.extended_text_headers < -1) {
+            throw std::runtime_error("Invalid number of extended textual headers in binary header: " +
+                                     std::to_string(layout.extended_text_headers));
+        }
+    }
+    if (rev2) {
+        layout.extra_trace_headers = get_u32_be(h + 306);
+        if (layout.extra_trace_headers > 0xFFFFu) {
+            throw std::runtime_error("Invalid number of additional trace headers in binary header: " +
+                                     std::to_string(layout.extra_trace_headers));
+        }
+        layout.declared_traces = u64(312);
+        layout.data_offset = u64(320);
+        if (layout.data_offset != 0 && layout.data_offset < 3600) {
+            throw std::runtime_error("Invalid first trace offset in binary header: " +
+                                     std::to_string(layout.data_offset));
+        }
+        layout.trailer_records = static_cast<int32_t>(get_u32_be(h + 328));
+        if (layout.trailer_records < -1) layout.trailer_records = -1;
+    }
+    if (layout.data_offset == 0 && layout.extended_text_headers >= 0) {
+        layout.data_offset = 3600 + 3200 * static_cast<uint64_t>(layout.extended_text_headers);
+    }
+    return layout;
+}
+
+bool SegyReader::is_end_text_record(const char* record) {
+    // Строфа ((SEG: EndText)) в ASCII или EBCDIC, в начале первой 80-символьной строки
+    static const char ascii[] = "((SEG: EndText))";
+    static const unsigned char ebcdic[] = {0x4D, 0x4D, 0xE2, 0xC5, 0xC7, 0x7A, 0x40, 0xC5,
+                                           0x95, 0x84, 0xE3, 0x85, 0xA7, 0xA3, 0x5D, 0x5D};
+    const size_t length = sizeof(ebcdic);
+    for (size_t i = 0; i + length <= 80; ++i) {
+        if (std::memcmp(record + i, ascii, length) == 0 || std::memcmp(record + i, ebcdic, length) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t SegyLayout::countTraces(uint64_t file_size) const {
+    if (file_size <= data_offset) return 0;
+    uint64_t available = file_size - data_offset;
+    if (trailer_records > 0) {
+        available -= std::min(available, 3200 * static_cast<uint64_t>(trailer_records));
+    }
+    const uint64_t count = available / traceSize();
+    // Указанное число трасс (rev 2) отделяет трассы от трейлера неизвестной длины;
+    // в обрезанном файле неполная последняя трасса отбрасывается
+    return declared_traces != 0 ? std::min(declared_traces, count) : count;
+}
+
+int32_t SegyReader::get_header_value_i32(size_t trace_index, const std::string& key) const {
+    if (trace_index >= num_traces_) {
+        throw std::out_of_range("Trace index out of range");
+    }
+    
+    const char* header = getTraceHeader(trace_index);
+    
+    int field_offset = header_field_offset(key);
+    if (field_offset == 0) {
         return 0; // Return 0 for unknown fields
     }
     
-    int offset = it->second - 1; // Convert to 0-based offset
-    if (offset + 4 <= static_cast<int>(header.size())) {
+    int offset = field_offset - 1; // Convert to 0-based offset
+    if (offset + 4 <= static_cast<int>(kTraceHeaderBytes)) {
         uint32_t value;
-        std::memcpy(&value, header.data() + offset, sizeof(value));
+        std::memcpy(&value, header + offset, sizeof(value));
         return static_cast<int32_t>(swapBytes32(value));
     }
     
@@ -201,7 +725,7 @@ int16_t SegyReader::get_header_value_i16(size_t trace_index, const std::string&
         throw std::out_of_range("Trace index out of range");
     }
     
-    const auto& header = trace_headers_[trace_index];
+    const char* header = getTraceHeader(trace_index);
     
     // Mapping of header field names to byte offsets (1-based)
     static const std::unordered_map<std::string, int> field_offsets = {
@@ -214,36 +738,11 @@ int16_t SegyReader::get_header_value_i16(size_t trace_index, const std::string&
     }
     
     int offset = it->second - 1;
-    if (offset + 2 <= static_cast<int>(header.size())) {
+    if (offset + 2 <= static_cast<int>(kTraceHeaderBytes)) {
         uint16_t value;
-        std::memcpy(&value, header.data() + offset, sizeof(value));
+        std::memcpy(&value, header + offset, sizeof(value));
         return static_cast<int16_t>(swapBytes16(value));
     }
     
     return 0;
 }
-
-void SegyReader::print_progress_bar(const std::string& label, int current, int total, int width) {
-    if (total == 0) return;
-
-    // Используем double для большей точности и добавляем 0.5 для правильного математического округления
-    double progress = static_cast<double>(current) / total;
-    int bar_width = static_cast<int>(progress * width + 0.5);
-
-    std::cout << "\r" // Возврат каретки
-              << std::left << std::setw(30) << label // Устанавливаем фиксированную ширину метки и выравниваем по левому краю
-              << ": [";
-
-    for (int i = 0; i < width; ++i) {
-        std::cout << (i < bar_width ? '#' : '.');
-    }
-    std::cout << "] " 
-              << std::right << std::setw(3) << static_cast<int>(progress * 100.0) << "%" // Фиксированная ширина для процентов
-              << " (" << current << "/" << total << ")"
-              << std::flush; // Принудительный сброс буфера в консоль
-
-    // --- ИСПРАВЛЕНИЕ 3: Перевод строки только ПОСЛЕ финального вывода ---
-    if (current >= total) {
-        std::cout << std::endl;
-    }
-}
\ No newline at end of file
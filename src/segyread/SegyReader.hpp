@@ -4,52 +4,168 @@
 #include <vector>
 #include <cstdint>
 #include <fstream>
+#include <memory>
+#include "CompressedInput.hpp"
+#include "TraceCache.hpp"
+#include "Progress.hpp"
+
+// Параметры чтения SEG-Y файла
+struct SegyReaderOptions {
+    // Чтение заголовков в обход page cache (O_DIRECT / F_NOCACHE) выровненными блоками.
+    // Если файловая система не поддерживает прямой ввод-вывод, используется обычное чтение.
+    bool direct_io = false;
+    
+    // Размер выровненного буфера прямого чтения
+    size_t direct_io_buffer_size = 8u << 20;
+    
+    // Максимальный разрыв между блоками заголовков, который читается одним запросом
+    // вместо двух (меньше запросов ценой лишних байт)
+    size_t direct_io_max_gap = 64u << 10;
+    
+    // Потоки для параллельной распаковки независимых zstd фреймов (0 - все ядра)
+    unsigned decompress_threads = 0;
+    
+    // Счетчики прогресса чтения заголовков (nullptr - без прогресса). Читатель только
+    // обновляет их; выводом занимается ProgressReporter в своем потоке.
+    ProgressTask* progress = nullptr;
+    
+    // false - при открытии читается только бинарный заголовок; трассы и их заголовки
+    // читаются по требованию (getTrace, readTraceHeader), например для просмотра сейсмограмм
+    bool read_headers = true;
+    
+    // Объем LRU-кэша декодированных трасс getTrace (0 - без кэша)
+    size_t trace_cache_bytes = 256u << 20;
+    
+    // Сколько соседних трасс с каждой стороны подсказывать ОС для упреждающего чтения при промахе
+    size_t prefetch_traces = 16;
+    
+    // Хешировать байты сэмплов каждой трассы (XXH64) в том же проходе, что и чтение
+    // заголовков: данные трасс читаются вместо пропуска (поиск дубликатов трасс)
+    bool hash_samples = false;
+};
+
+// Расположение трасс в файле по бинарному заголовку (SEG-Y rev 0, 1 и 2)
+struct SegyLayout {
+    int revision = 0;                  // старший номер ревизии (3501); 0 - rev 0 или поле не заполнено
+    size_t num_samples = 0;            // 3221, в rev 2 - расширенное значение 3269, если оно задано
+    double dt = 0.0;                   // секунды: 3217, в rev 2 - расширенное значение 3273
+    int format_code = 0;
+    size_t bytes_per_sample = 4;       // 4 для неизвестного кода формата, как и раньше
+    int extended_text_headers = 0;     // 3505: 3200-байтовые расширенные текстовые заголовки, -1 - до EndText
+    uint32_t extra_trace_headers = 0;  // 3507 (rev 2): дополнительные 240-байтовые заголовки каждой трассы
+    uint64_t declared_traces = 0;      // 3513 (rev 2): число трасс, 0 - не указано
+    uint64_t data_offset = 0;          // смещение первой трассы; 0 - неизвестно до чтения текстовых заголовков
+    int64_t trailer_records = 0;       // 3529 (rev 2): 3200-байтовые записи после трасс, -1 - число не указано
+    
+    uint64_t traceHeaderSize() const { return 240 * (1 + static_cast<uint64_t>(extra_trace_headers)); }
+    uint64_t traceSize() const { return traceHeaderSize() + static_cast<uint64_t>(num_samples) * bytes_per_sample; }
+    // Число полных трасс в файле данного размера (data_offset должен быть известен)
+    uint64_t countTraces(uint64_t file_size) const;
+};
 
 class SegyReader {
 public:
     /**
      * @brief Основной конструктор. Открывает SEG-Y файл для чтения.
      * @param file_path Путь к SEG-Y файлу.
+     * @param options Параметры чтения.
      */
-    explicit SegyReader(const std::string& file_path);
+    explicit SegyReader(const std::string& file_path, const SegyReaderOptions& options = SegyReaderOptions());
     
     // Запрещаем копирование и присваивание
     SegyReader(const SegyReader&) = delete;
     SegyReader& operator=(const SegyReader&) = delete;
+    ~SegyReader();
+
+    // Размер стандартного заголовка трассы, хранимого в памяти
+    static const size_t kTraceHeaderBytes = 240;
 
     // --- ОСНОВНЫЕ МЕТОДЫ ДОСТУПА К ДАННЫМ ---
     
-    const std::vector<float>& getTrace(size_t trace_index) const;
-    const std::vector<char>& getTraceHeader(size_t trace_index) const;
+    // Трасса, декодированная во float: читается по требованию (pread по вычисленному
+    // смещению) и кэшируется. Потокобезопасно; только для несжатых файлов.
+    std::shared_ptr<const std::vector<float>> getTrace(size_t trace_index) const;
+    // kTraceHeaderBytes байт заголовка трассы в общем буфере всех заголовков;
+    // указатель действителен, пока существует SegyReader
+    const char* getTraceHeader(size_t trace_index) const;
+    // Заголовок трассы с диска, без загрузки всех заголовков (read_headers = false)
+    std::vector<char> readTraceHeader(size_t trace_index) const;
+    // Байты сэмплов трассы с диска, без декодирования; только для несжатых файлов
+    std::vector<char> readTraceSamples(size_t trace_index) const;
+    
+    // XXH64 байтов сэмплов каждой трассы (hash_samples = true), иначе пусто
+    const std::vector<uint64_t>& sample_hashes() const { return sample_hashes_; }
+    
+    // Подсказка ОС о скором чтении трасс [first, first + count) (posix_fadvise WILLNEED)
+    void prefetchTraces(size_t first, size_t count) const;
+    TraceCacheStats trace_cache_stats() const { return trace_cache_->stats(); }
 
     // --- ГЕТТЕРЫ ---
     
     size_t num_traces() const { return num_traces_; }
     size_t num_samples() const { return num_samples_; }
     double sample_interval() const { return dt_; }
+    int format_code() const { return format_code_; }
+    size_t bytes_per_sample() const { return bytes_per_sample_; }
+    const SegyLayout& layout() const { return layout_; }
+    uint64_t bytes_read() const { return bytes_read_; }
+    bool direct_io_active() const { return direct_io_active_; }
+    Compression compression() const { return compression_; }
     
     // --- МЕТОДЫ ДЛЯ ЧТЕНИЯ ЗАГОЛОВКОВ ТРАСС ---
     
     int32_t get_header_value_i32(size_t trace_index, const std::string& key) const;
     int16_t get_header_value_i16(size_t trace_index, const std::string& key) const;
     
-    // --- УТИЛИТЫ ---
+    // Байтовое смещение (1-based) поля, читаемого get_header_value_i32; 0 для неизвестных полей
+    static int header_field_offset(const std::string& key);
+    
+    // Размер сэмпла в байтах для кода формата данных (3225-3226); 0 для неизвестных кодов
+    static size_t sample_size_for_format(int format_code);
     
-    void print_progress_bar(const std::string& label, int current, int total, int width = 50);
+    // Разбор 400-байтового бинарного заголовка; std::runtime_error для некорректных значений
+    static SegyLayout parse_layout(const char* binary_header);
+    
+    // Проверка 3200-байтовой записи на ((SEG: EndText)) - последний расширенный текстовый заголовок
+    static bool is_end_text_record(const char* record);
 
 private:
     std::string file_path_;
     size_t num_traces_;
     size_t num_samples_;
     double dt_;
+    int format_code_;
+    size_t bytes_per_sample_;
+    uint64_t bytes_read_;
+    bool direct_io_active_;
+    Compression compression_;
+    SegyReaderOptions options_;
+    SegyLayout layout_;
     
     std::vector<std::vector<float>> traces_;
-    std::vector<std::vector<char>> trace_headers_;
+    // Заголовки всех трасс подряд по kTraceHeaderBytes: одно выделение памяти на файл
+    // вместо отдельного вектора на каждую трассу
+    std::vector<char> trace_headers_;
     std::vector<char> binary_header_;
+    std::vector<uint64_t> sample_hashes_;
+    
+    // Произвольный доступ к трассам
+    int data_fd_ = -1;
+    std::unique_ptr<TraceCache> trace_cache_;
     
     // Вспомогательные методы
     void readBinaryHeader(std::ifstream& file);
+    void parseBinaryHeader();
+    void findDataOffset(std::ifstream& file);
     void readTraces(std::ifstream& file);
+    void readTracesCompressed();
+    bool readTracesDirect();
+    size_t countTraces(uint64_t file_size) const;
+    uint64_t traceSize() const { return layout_.traceSize(); }
+    uint64_t traceOffset(size_t trace_index) const { return layout_.data_offset + trace_index * traceSize(); }
+    void checkTraceIndex(size_t trace_index) const;
+    void readAt(char* dst, size_t size, uint64_t offset) const;
+    void decodeSamples(const uint8_t* src, float* dst) const;
     
     uint16_t swapBytes16(uint16_t val) const;
     uint32_t swapBytes32(uint32_t val) const;
@@ -0,0 +1,57 @@
+#include "TraceCache.hpp"
+
+TraceCache::TraceCache(size_t capacity_bytes) : capacity_bytes_(capacity_bytes) {}
+
+TraceCache::TracePtr TraceCache::find(size_t index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(index);
+    if (it == entries_.end()) {
+        stats_.misses++;
+        return nullptr;
+    }
+    stats_.hits++;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->trace;
+}
+
+TraceCache::TracePtr TraceCache::insert(size_t index, TracePtr trace) {
+    const size_t bytes = entryBytes(trace);
+    if (bytes > capacity_bytes_) return trace; // не помещается (или кэш выключен)
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(index);
+    if (it != entries_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->trace;
+    }
+
+    // Вытесняем давно неиспользованные трассы, пока новая не поместится
+    while (!lru_.empty() && stats_.cached_bytes + bytes > capacity_bytes_) {
+        const Entry& victim = lru_.back();
+        stats_.cached_bytes -= entryBytes(victim.trace);
+        entries_.erase(victim.index);
+        lru_.pop_back();
+        stats_.evictions++;
+    }
+
+    lru_.push_front(Entry{index, trace});
+    entries_[index] = lru_.begin();
+    stats_.cached_bytes += bytes;
+    stats_.cached_traces = lru_.size();
+    return trace;
+}
+
+void TraceCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    entries_.clear();
+    stats_.cached_bytes = 0;
+    stats_.cached_traces = 0;
+}
+
+TraceCacheStats TraceCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    TraceCacheStats result = stats_;
+    result.cached_traces = lru_.size();
+    return result;
+}
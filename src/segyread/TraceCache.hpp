@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Статистика кэша трасс
+struct TraceCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t cached_traces = 0;
+    size_t cached_bytes = 0;
+
+    double hit_rate() const {
+        uint64_t total = hits + misses;
+        return total > 0 ? static_cast<double>(hits) / total : 0.0;
+    }
+};
+
+/**
+ * @brief Потокобезопасный LRU-кэш декодированных трасс с ограничением по памяти.
+ *
+ * Трассы отдаются как shared_ptr: вытеснение из кэша не инвалидирует трассу,
+ * которую еще держит вызывающий код. Декодирование выполняется вне блокировки.
+ */
+class TraceCache {
+public:
+    using TracePtr = std::shared_ptr<const std::vector<float>>;
+
+    // capacity_bytes = 0 - кэширование выключено (учитываются только промахи)
+    explicit TraceCache(size_t capacity_bytes);
+
+    // Трасса из кэша или nullptr; учитывает попадание/промах
+    TracePtr find(size_t index);
+
+    // Добавляет трассу; если другой поток успел добавить ее раньше, возвращает кэшированную
+    TracePtr insert(size_t index, TracePtr trace);
+
+    void clear();
+    TraceCacheStats stats() const;
+
+private:
+    struct Entry {
+        size_t index;
+        TracePtr trace;
+    };
+
+    static size_t entryBytes(const TracePtr& trace) { return trace->size() * sizeof(float); }
+
+    size_t capacity_bytes_;
+    mutable std::mutex mutex_;
+    std::list<Entry> lru_; // в начале - последние использованные
+    std::unordered_map<size_t, std::list<Entry>::iterator> entries_;
+    TraceCacheStats stats_;
+};
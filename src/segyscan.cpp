@@ -0,0 +1,370 @@
+#include "segyscan.h"
+#include "profiler.h"
+#include "scanarena.h"
+#include "segyread/Kernels.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <tuple>
+
+const std::vector<std::string>& rangeFieldNames() {
+    static const std::vector<std::string> names = {"FFID", "Chan", "CDP", "Source", "Sou_X", "Sou_Y",
+                                                   "Sou_Elev", "Rec_X", "Rec_Y", "Rec_Elev", "CDP_X", "CDP_Y", "ILINE", "XLINE"};
+    return names;
+}
+
+FileInfo makeFileInfo(const std::string& filepath, const SegyReader& reader) {
+    FileInfo info;
+    info.filename = std::filesystem::path(filepath).filename().string();
+    info.num_traces = reader.num_traces();
+    info.num_samples = static_cast<int>(reader.num_samples());
+    info.sample_interval_ms = static_cast<int>(reader.sample_interval() * 1000); // конвертируем в миллисекунды
+    info.max_time_ms = (static_cast<int64_t>(info.num_samples) - 1) * info.sample_interval_ms; // максимальное время
+    return info;
+}
+
+FileInfo readFileInfo(const std::string& filepath) {
+    SegyReader reader(filepath);
+    return makeFileInfo(filepath, reader);
+}
+
+const std::vector<HeaderFieldSpec>& builtinHeaderFields() {
+    static const std::vector<HeaderFieldSpec> fields = [] {
+        static const char* const reader_keys[] = {"FieldRecord", "TraceNumber", "CDP", "EnergySourcePoint",
+                                                  "SourceX", "SourceY", "SourceElevation", "ReceiverX",
+                                                  "ReceiverY", "ReceiverElevation", "CDP_X", "CDP_Y",
+                                                  "ILINE_3D", "CROSSLINE_3D"};
+        std::vector<HeaderFieldSpec> result;
+        const auto& names = rangeFieldNames();
+        for (size_t i = 0; i < names.size(); ++i) {
+            HeaderFieldSpec field;
+            field.name = names[i];
+            field.byte = SegyReader::header_field_offset(reader_keys[i]);
+            field.width = 4;
+            result.push_back(field);
+        }
+        return result;
+    }();
+    return fields;
+}
+
+std::vector<HeaderFieldSpec> resolveHeaderFields(const std::vector<HeaderFieldSpec>& user_fields) {
+    std::vector<HeaderFieldSpec> fields = builtinHeaderFields();
+    auto upper = [](std::string s) {
+        std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+        return s;
+    };
+    // Имена полей - ключи RangeMap и SketchMap, а --index и --where сравнивают их без
+    // учета регистра: повтор имени молча затер бы одно поле другим
+    std::vector<std::string> user_names;
+    for (const auto& user : user_fields) {
+        const std::string key = upper(user.name);
+        if (std::find(user_names.begin(), user_names.end(), key) != user_names.end()) {
+            throw std::invalid_argument("Header field " + user.name + " is defined more than once");
+        }
+        user_names.push_back(key);
+        auto it = std::find_if(fields.begin(), fields.end(),
+                               [&](const HeaderFieldSpec& f) { return upper(f.name) == key; });
+        if (it != fields.end() && it->name != user.name) {
+            throw std::invalid_argument("Header field " + user.name + " clashes with built-in field " + it->name +
+                                        " (use " + it->name + " to move the built-in field)");
+        }
+        if (it != fields.end()) {
+            // Встроенное поле переопределяется, ширина остается в пределах int32 TraceData
+            *it = user;
+        } else {
+            fields.push_back(user);
+        }
+    }
+    return fields;
+}
+
+std::vector<std::string> headerFieldNames(const std::vector<HeaderFieldSpec>& user_fields) {
+    std::vector<std::string> names;
+    for (const auto& field : resolveHeaderFields(user_fields)) {
+        names.push_back(field.name);
+    }
+    return names;
+}
+
+std::vector<TraceData> decodeTraceHeaders(const SegyReader& reader) {
+    static const HeaderDecodePlan plan(builtinHeaderFields());
+    return decodeTraceHeaders(reader, plan);
+}
+
+std::vector<TraceData> decodeTraceHeaders(const SegyReader& reader, const HeaderDecodePlan& plan,
+                                          std::vector<int32_t>* custom_values,
+                                          GatherSegmenter* segmenter) {
+    const size_t num_builtin = builtinHeaderFields().size();
+    if (plan.size() < num_builtin) {
+        throw std::invalid_argument("Header decode plan does not contain the built-in fields");
+    }
+    const size_t num_custom = plan.size() - num_builtin;
+    
+    size_t num_traces = reader.num_traces();
+    std::vector<TraceData> traces(num_traces);
+    if (custom_values) {
+        custom_values->assign(num_traces * num_custom, 0);
+    }
+    
+    // Headers are decoded in batches so the kernel sees many rows per call. Without custom
+    // fields the rows go straight into TraceData; otherwise they are split after decoding.
+    const size_t kBatch = 256;
+    const size_t width = plan.size();
+    const uint8_t* headers[kBatch];
+    std::vector<int32_t> rows(num_custom > 0 ? kBatch * width : 0);
+    for (size_t start = 0; start < num_traces; start += kBatch) {
+        const size_t n = std::min(kBatch, num_traces - start);
+        for (size_t i = 0; i < n; ++i) {
+            headers[i] = reinterpret_cast<const uint8_t*>(reader.getTraceHeader(start + i));
+        }
+        if (num_custom == 0) {
+            plan.decodeBatch(headers, n, reinterpret_cast<int32_t*>(&traces[start]));
+        } else {
+            plan.decodeBatch(headers, n, rows.data());
+            for (size_t i = 0; i < n; ++i) {
+                const int32_t* row = rows.data() + i * width;
+                std::memcpy(&traces[start + i], row, sizeof(TraceData));
+                if (custom_values) {
+                    std::memcpy(custom_values->data() + (start + i) * num_custom, row + num_builtin, num_custom * sizeof(int32_t));
+                }
+            }
+        }
+        if (segmenter) {
+            for (size_t i = 0; i < n; ++i) {
+                segmenter->push(traces[start + i]);
+            }
+        }
+    }
+    
+    return traces;
+}
+
+RangeMap computeHeaderRanges(const std::vector<TraceData>& traces) {
+    RangeMap ranges;
+    if (traces.empty()) return ranges;
+    
+    // TraceData rows are 14 int32 columns in rangeFieldNames order
+    int32_t min_values[HeaderColumns::kBuiltinColumns];
+    int32_t max_values[HeaderColumns::kBuiltinColumns];
+    segyKernels().minmax_rows(reinterpret_cast<const int32_t*>(traces.data()), traces.size(),
+                              HeaderColumns::kBuiltinColumns, min_values, max_values);
+    const auto& names = rangeFieldNames();
+    for (size_t c = 0; c < HeaderColumns::kBuiltinColumns; ++c) {
+        ranges[names[c]] = Range(min_values[c], max_values[c]);
+    }
+    return ranges;
+}
+
+void computeCustomRanges(const std::vector<std::string>& names, const std::vector<int32_t>& values, RangeMap& ranges) {
+    const size_t num_fields = names.size();
+    if (num_fields == 0 || values.size() < num_fields) return;
+    
+    std::vector<int32_t> min_values(num_fields), max_values(num_fields);
+    segyKernels().minmax_rows(values.data(), values.size() / num_fields, num_fields, min_values.data(), max_values.data());
+    for (size_t f = 0; f < num_fields; ++f) {
+        ranges[names[f]] = Range(min_values[f], max_values[f]);
+    }
+}
+
+std::vector<SourceInfo> uniqueSources(const std::vector<TraceData>& traces, std::pmr::memory_resource* memory) {
+    // Shot-sorted files repeat the source fields for every channel: one probe per run
+    return uniqueSources(encodeSourceRuns(traces), memory);
+}
+
+std::vector<ReceiverInfo> uniqueReceivers(const std::vector<TraceData>& traces, std::pmr::memory_resource* memory) {
+    std::pmr::map<std::pair<int32_t, int32_t>, int32_t> unique_receivers(memory); // (x, y) -> max_elevation
+    
+    auto last = unique_receivers.end();
+    for (const auto& trace : traces) {
+        auto key = std::make_pair(trace.rec_x, trace.rec_y);
+        // Тот же приемник, что и у предыдущей трассы (сортировка по приемникам): без поиска
+        if (last != unique_receivers.end() && last->first == key) {
+            last->second = std::max(last->second, trace.rec_elev);
+            continue;
+        }
+        auto it = unique_receivers.find(key);
+        
+        if (it == unique_receivers.end()) {
+            // Новый приемник
+            it = unique_receivers.emplace(key, trace.rec_elev).first;
+        } else {
+            // Приемник уже существует - обновляем высоту до максимальной
+            it->second = std::max(it->second, trace.rec_elev);
+        }
+        last = it;
+    }
+    
+    std::vector<ReceiverInfo> receivers;
+    receivers.reserve(unique_receivers.size());
+    for (const auto& receiver : unique_receivers) {
+        ReceiverInfo info;
+        info.rec_x = receiver.first.first;
+        info.rec_y = receiver.first.second;
+        info.rec_elev = receiver.second;
+        receivers.push_back(info);
+    }
+    return receivers;
+}
+
+std::vector<CdpInfo> uniqueCdps(const std::vector<TraceData>& traces, std::pmr::memory_resource* memory) {
+    std::pmr::map<std::pair<int32_t, int32_t>, std::tuple<int32_t, int32_t, int32_t>> unique_cdps(memory); // (x, y) -> (cdp_number, iline, xline)
+    
+    std::pair<int32_t, int32_t> last_key;
+    bool has_last = false;
+    for (const auto& trace : traces) {
+        auto key = std::make_pair(trace.cdp_x, trace.cdp_y);
+        // Подряд идущие трассы одной CDP (сортировка по CDP) уже учтены первой трассой
+        if (has_last && key == last_key) continue;
+        // CDP уже существует - сохраняем первый встреченный номер CDP
+        unique_cdps.emplace(key, std::make_tuple(trace.cdp, trace.iline, trace.xline));
+        last_key = key;
+        has_last = true;
+    }
+    
+    std::vector<CdpInfo> cdps;
+    cdps.reserve(unique_cdps.size());
+    for (const auto& cdp : unique_cdps) {
+        CdpInfo info;
+        info.cdp_x = cdp.first.first;
+        info.cdp_y = cdp.first.second;
+        auto& [cdp_num, iline, xline] = cdp.second;
+        info.cdp = cdp_num;
+        info.iline = iline;
+        info.xline = xline;
+        cdps.push_back(info);
+    }
+    return cdps;
+}
+
+FileScanResult scanSegyFile(const std::string& filepath, const ScanOptions& options) {
+    const std::string name = std::filesystem::path(stripCompressionExtension(filepath)).stem().string();
+    FileScanResult result;
+    // Dedupe maps and coverage hashes of this file; freed in one go when the scan returns
+    ScanArena arena;
+    
+    ProfileScope read_scope("read_headers", name);
+    SegyReader reader(filepath, options.reader);
+    read_scope.addBytes(reader.bytes_read());
+    read_scope.addTraces(reader.num_traces());
+    read_scope.stop();
+    
+    result.file_info = makeFileInfo(filepath, reader);
+    result.direct_io_active = reader.direct_io_active();
+    
+    // Gather boundaries and run-length encoded source columns are tracked while the
+    // headers are decoded, so they cost no separate pass over the traces
+    const bool track_runs = options.sources || options.gathers;
+    GatherSegmenter segmenter;
+    {
+        ProfileScope scope("decode", name);
+        scope.addTraces(reader.num_traces());
+        if (options.fields.empty()) {
+            static const HeaderDecodePlan builtin_plan(builtinHeaderFields());
+            result.traces = decodeTraceHeaders(reader, builtin_plan, nullptr, track_runs ? &segmenter : nullptr);
+        } else {
+            std::vector<HeaderFieldSpec> fields = resolveHeaderFields(options.fields);
+            for (size_t i = builtinHeaderFields().size(); i < fields.size(); ++i) {
+                result.custom_fields.push_back(fields[i].name);
+            }
+            HeaderDecodePlan plan(fields);
+            result.traces = decodeTraceHeaders(reader, plan, &result.custom_values, track_runs ? &segmenter : nullptr);
+        }
+    }
+    
+    {
+        ProfileScope scope("ranges", name);
+        scope.addTraces(result.traces.size());
+        result.ranges = computeHeaderRanges(result.traces);
+        computeCustomRanges(result.custom_fields, result.custom_values, result.ranges);
+    }
+    
+    if (options.sketches) {
+        ProfileScope scope("sketches", name);
+        scope.addTraces(result.traces.size());
+        sketchColumns(reinterpret_cast<const int32_t*>(result.traces.data()), result.traces.size(),
+                      HeaderColumns::kBuiltinColumns, rangeFieldNames(), result.sketches);
+        sketchColumns(result.custom_values.data(), result.traces.size(), result.custom_fields.size(),
+                      result.custom_fields, result.sketches);
+    }
+    
+    if (options.fingerprints) {
+        ProfileScope scope("fingerprints", name);
+        scope.addTraces(result.traces.size());
+        result.fingerprints = fingerprintTraces(result.traces, reader.sample_hashes());
+        result.fingerprints.path = filepath;
+    }
+    
+    if (!options.index_fields.empty() && result.traces.size() > UINT32_MAX) {
+        // Indexes store 32-bit trace numbers: leave them out rather than lose the whole scan
+        result.indexes_skipped = true;
+    } else if (!options.index_fields.empty()) {
+        ProfileScope scope("index", name);
+        scope.addTraces(result.traces.size());
+        const auto& builtin = rangeFieldNames();
+        for (const auto& field : options.index_fields) {
+            // TraceData is 14 packed int32 columns (see decodeTraceHeaders)
+            auto it = std::find(builtin.begin(), builtin.end(), field);
+            if (it != builtin.end()) {
+                const int32_t* column = reinterpret_cast<const int32_t*>(result.traces.data()) + (it - builtin.begin());
+                result.indexes.push_back(buildHeaderIndex(field, column, result.traces.size(), builtin.size()));
+                continue;
+            }
+            auto custom = std::find(result.custom_fields.begin(), result.custom_fields.end(), field);
+            if (custom == result.custom_fields.end()) {
+                throw std::invalid_argument("Unknown header field for index: " + field);
+            }
+            result.indexes.push_back(buildHeaderIndex(field, result.custom_values.data() + (custom - result.custom_fields.begin()),
+                                                      result.traces.size(), result.custom_fields.size()));
+        }
+    }
+    
+    if (options.geometry) {
+        ProfileScope scope("geometry", name);
+        scope.addTraces(result.traces.size());
+        result.geometry = computeGeometryStats(result.traces, options.geometry_options);
+        result.has_geometry = true;
+    }
+    
+    std::vector<SourceRun> source_runs;
+    if (track_runs) {
+        ProfileScope scope("gathers", name);
+        scope.addTraces(result.traces.size());
+        GatherSegmentation segmentation = segmenter.finish();
+        source_runs = std::move(segmentation.source_runs);
+        if (options.gathers) {
+            result.gathers = std::move(segmentation);
+            result.has_gathers = true;
+        }
+    }
+    
+    if (options.sources) {
+        ProfileScope scope("dedupe_sou", name);
+        scope.addTraces(result.traces.size());
+        result.sources = uniqueSources(source_runs, arena.resource());
+    }
+    if (options.receivers) {
+        ProfileScope scope("dedupe_rec", name);
+        scope.addTraces(result.traces.size());
+        result.receivers = uniqueReceivers(result.traces, arena.resource());
+    }
+    if (options.cdps) {
+        ProfileScope scope("dedupe_cdp", name);
+        scope.addTraces(result.traces.size());
+        // Dense (iline, xline) addressing on regular grids, coordinate map otherwise
+        result.grid = analyzeBinGrid(result.traces, &result.cdps, arena.resource());
+    }
+    
+    if (options.keep_traces && options.compress_traces) {
+        ProfileScope scope("compress", name);
+        scope.addTraces(result.traces.size());
+        result.columns = HeaderColumns(result.traces, result.custom_values, result.custom_fields.size());
+    }
+    if (!options.keep_traces || options.compress_traces) {
+        std::vector<TraceData>().swap(result.traces);
+        std::vector<int32_t>().swap(result.custom_values);
+    }
+    return result;
+}
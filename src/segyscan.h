@@ -0,0 +1,154 @@
+#ifndef SEGYSCAN_H
+#define SEGYSCAN_H
+
+// libsegyscan: in-process SEG-Y scanning API.
+// Everything here returns in-memory results: no console output, no plotting
+// and no file writes. SegyScanner (the scansegy tool) is built on top of it.
+
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include "basetypes.h"
+#include "segyread/SegyReader.hpp"
+#include "segyread/HeaderDecodePlan.hpp"
+#include "geometryqc.h"
+#include "bingrid.h"
+#include "headerindex.h"
+#include "gathers.h"
+#include "headercolumns.h"
+#include "duplicates.h"
+#include "sketches.h"
+
+// File-level information from the binary header
+struct FileInfo {
+    std::string filename;
+    uint64_t num_traces;     // merged surveys can exceed 2^31 traces
+    int num_samples;
+    int sample_interval_ms;  // в миллисекундах
+    int64_t max_time_ms;     // максимальное время в миллисекундах
+};
+
+// Decoded trace header fields used by the scanner, in rangeFieldNames order. Decoding,
+// header columns, fingerprints and indexes treat a TraceData array as 14 int32 columns.
+struct TraceData {
+    int32_t ffid;
+    int32_t trace_number;
+    int32_t cdp;
+    int32_t source;
+    int32_t sou_x, sou_y, sou_elev;
+    int32_t rec_x, rec_y, rec_elev;
+    int32_t cdp_x, cdp_y;
+    int32_t iline, xline;
+};
+static_assert(sizeof(TraceData) == 14 * sizeof(int32_t), "TraceData must be 14 packed int32 fields");
+
+// Min-max range of one header field
+struct Range {
+    int32_t min_val, max_val;
+    Range() : min_val(0), max_val(0) {}
+    Range(int32_t min, int32_t max) : min_val(min), max_val(max) {}
+    std::string toString() const {
+        if (min_val == max_val) {
+            return std::to_string(min_val);
+        }
+        return std::to_string(min_val) + "-" + std::to_string(max_val);
+    }
+};
+
+// Header field name -> range
+typedef std::map<std::string, Range> RangeMap;
+
+// Field names of RangeMap in ranges table order
+const std::vector<std::string>& rangeFieldNames();
+
+// Built-in header fields in TraceData order, named as in rangeFieldNames()
+const std::vector<HeaderFieldSpec>& builtinHeaderFields();
+
+// Built-in fields with user overrides applied (same name -> new byte location),
+// followed by the remaining user fields as custom fields
+std::vector<HeaderFieldSpec> resolveHeaderFields(const std::vector<HeaderFieldSpec>& user_fields);
+
+struct ScanOptions {
+    SegyReaderOptions reader;
+    bool keep_traces = true;   // keep decoded headers in FileScanResult::traces
+    bool compress_traces = false;  // keep them as FileScanResult::columns instead (5-10x smaller)
+    bool sources = true;
+    bool receivers = true;
+    bool cdps = true;
+    std::vector<HeaderFieldSpec> fields;  // user-defined fields and built-in overrides
+    bool geometry = false;                // offset/azimuth/midpoint statistics
+    GeometryOptions geometry_options;
+    std::vector<std::string> index_fields;  // build secondary indexes (names as in the ranges table)
+    bool gathers = false;                   // keep the gather (ensemble) index in the result
+    bool fingerprints = false;              // per-trace duplicate fingerprints (reader.hash_samples adds the samples)
+    bool sketches = true;                   // distinct counts and percentiles of every field
+};
+
+// Complete in-memory result of scanning one file
+struct FileScanResult {
+    FileInfo file_info;
+    std::vector<TraceData> traces;        // decoded headers, one row per trace
+    RangeMap ranges;
+    SketchMap sketches;                   // ScanOptions::sketches, same fields as ranges
+    std::vector<SourceInfo> sources;      // unique by (X, Y), sorted by (X, Y)
+    std::vector<ReceiverInfo> receivers;  // unique by (X, Y), sorted by (X, Y)
+    std::vector<CdpInfo> cdps;            // unique by (X, Y), sorted by (X, Y)
+    std::vector<std::string> custom_fields;
+    std::vector<int32_t> custom_values;   // traces x custom_fields, row-major (kept with traces)
+    HeaderColumns columns;                // traces and custom_values, compressed (compress_traces)
+    bool has_geometry = false;
+    GeometryStats geometry;
+    BinGrid grid;                         // fitted with the CDP domain
+    std::vector<HeaderIndex> indexes;     // one per ScanOptions::index_fields entry
+    bool indexes_skipped = false;         // index_fields given, but more than 2^32 traces (32-bit trace numbers)
+    bool has_gathers = false;
+    GatherSegmentation gathers;           // FFID/CDP ensembles (source_runs are not kept)
+    TraceFingerprints fingerprints;       // ScanOptions::fingerprints, input of findDuplicates
+    bool direct_io_active = false;
+};
+
+// Names of all scanned fields: rangeFieldNames() followed by the custom fields
+std::vector<std::string> headerFieldNames(const std::vector<HeaderFieldSpec>& user_fields);
+
+// Scan one file: read headers, decode fields, compute ranges and unique positions
+FileScanResult scanSegyFile(const std::string& filepath, const ScanOptions& options = ScanOptions());
+
+// --- Individual stages ---
+
+FileInfo readFileInfo(const std::string& filepath);
+FileInfo makeFileInfo(const std::string& filepath, const SegyReader& reader);
+std::vector<TraceData> decodeTraceHeaders(const SegyReader& reader);
+// plan must start with the built-in fields (see resolveHeaderFields); values of the
+// fields after them are appended to custom_values when it is not null. Each decoded batch
+// is also pushed to segmenter when it is not null, while the rows are still in cache
+std::vector<TraceData> decodeTraceHeaders(const SegyReader& reader, const HeaderDecodePlan& plan,
+                                          std::vector<int32_t>* custom_values = nullptr,
+                                          GatherSegmenter* segmenter = nullptr);
+RangeMap computeHeaderRanges(const std::vector<TraceData>& traces);
+// Adds ranges of custom field columns (row-major, names.size() values per trace)
+void computeCustomRanges(const std::vector<std::string>& names, const std::vector<int32_t>& values, RangeMap& ranges);
+
+// Unique sources: first FFID/source number, maximum elevation per position.
+// memory holds the temporary position maps, e.g. a per-file ScanArena (scanarena.h).
+std::vector<SourceInfo> uniqueSources(const std::vector<TraceData>& traces,
+                                      std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+// Unique receivers: maximum elevation per position
+std::vector<ReceiverInfo> uniqueReceivers(const std::vector<TraceData>& traces,
+                                          std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+// Unique CDPs: first CDP number and inline/crossline per position
+std::vector<CdpInfo> uniqueCdps(const std::vector<TraceData>& traces,
+                                std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+// Same results from compressed columns, block by block: ranges come from the block
+// min/max and blocks with a constant position are aggregated without decoding
+RangeMap computeHeaderRanges(const HeaderColumns& columns);
+std::vector<SourceInfo> uniqueSources(const HeaderColumns& columns,
+                                      std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+std::vector<ReceiverInfo> uniqueReceivers(const HeaderColumns& columns,
+                                          std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+std::vector<CdpInfo> uniqueCdps(const HeaderColumns& columns,
+                                std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+
+#endif // SEGYSCAN_H
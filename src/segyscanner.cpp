@@ -1,21 +1,76 @@
 #include "segyscanner.h"
+#include "profiler.h"
+#include "scanpartial.h"
+#include "surveymerge.h"
+#include "boundedqueue.h"
+#include "maptiles.h"
+#include "scanarena.h"
 #include <iostream>
 #include <fstream>
 #include <filesystem>
 #include <algorithm>
+#include <iterator>
 #include <iomanip>
 #include <sstream>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <cerrno>
+#include <future>
+#include <thread>
 #include <matplot/matplot.h>
 
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
 using namespace matplot;
 
-SegyScanner::SegyScanner() = default;
+namespace {
+
+// Builds the row in place from the table's memory resource, without a temporary row on the heap
+void addTableRow(TableData& data, std::initializer_list<std::string> cells) {
+    data.emplace_back(cells);
+}
+
+// Rows of a large table built in their own arena: the rows and cells of the whole table
+// share a few growing buffers, which are released at once when the table is written
+class ArenaTable {
+public:
+    explicit ArenaTable(size_t num_rows = 0) : rows_(arena_.resource()) { rows_.reserve(num_rows); }
+    ArenaTable(const ArenaTable&) = delete;
+    ArenaTable& operator=(const ArenaTable&) = delete;
+
+    void add(std::initializer_list<std::string> cells) { addTableRow(rows_, cells); }
+    // Cells collected before the row is added; moved into a row allocated from the arena
+    void add(std::vector<std::string> cells) {
+        rows_.emplace_back(std::make_move_iterator(cells.begin()), std::make_move_iterator(cells.end()));
+    }
+    TableData& rows() { return rows_; }
+
+private:
+    ScanArena arena_;  // declared before rows_, so it outlives them
+    TableData rows_;
+};
+
+} // namespace
+
+SegyScanner::SegyScanner() : progress_(std::make_unique<ProgressReporter>(ProgressMode::Auto)) {}
 
 int SegyScanner::process(const std::string& input_path, const std::set<std::string>& domains) {
     try {
+        ProfileScope total_scope("total");
+        
         // Step 1: Discover files
         std::cout << "Discovering SEG-Y files..." << std::endl;
-        auto files = discoverFiles(input_path);
+        std::vector<std::string> files;
+        {
+            ProfileScope scope("discover");
+            files = discoverFiles(input_path);
+        }
         if (files.empty()) {
             std::cerr << "No valid SEG-Y files found in: " << input_path << std::endl;
             return 1;
@@ -24,66 +79,253 @@ int SegyScanner::process(const std::string& input_path, const std::set<std::stri
         std::cout << "Found " << files.size() << " SEG-Y files" << std::endl;
         
         // Step 2: Create output directories
-        std::string output_base = std::filesystem::is_directory(input_path) ? 
-            input_path + "/segyscan" : 
-            std::filesystem::path(input_path).parent_path().string() + "/segyscan";
+        std::string output_base = getOutputBase(input_path);
+        createOutputDirectories(output_base);
+        if (!extract_path_.empty()) {
+            extractor_ = std::make_unique<SegyExtractWriter>(extract_path_);
+            extract_failed_ = false;
+        }
+        
+        // Step 3: Process each file (tables of one file are written while the next is scanned)
+        processFiles(files, output_base, domains);
+        int status = extractor_ ? finishExtract() : 0;
+        
+        // Steps 4-5: Generate info and ranges tables and maps
+        writeSummary(output_base, domains);
+        
+        if (status == 0) {
+            std::cout << "Processing completed successfully!" << std::endl;
+        }
+        return status;
+        
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+namespace {
+volatile std::sig_atomic_t watch_stop_requested = 0;
+
+void requestWatchStop(int) {
+    watch_stop_requested = 1;
+}
+} // namespace
+
+int SegyScanner::watch(const std::string& input_path, const std::set<std::string>& domains, int debounce_ms) {
+#ifdef __linux__
+    try {
+        if (!std::filesystem::is_directory(input_path)) {
+            std::cerr << "Error: Watch mode requires a directory: " << input_path << std::endl;
+            return 1;
+        }
+        
+        // Subscribe before the initial scan so files landing during it are not missed
+        int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error(std::string("inotify_init1 failed: ") + std::strerror(errno));
+        }
+        std::unique_ptr<int, void (*)(int*)> fd_guard(&fd, [](int* f) { close(*f); });
+        
+        // Only completed files: closed after writing or moved into the directory
+        if (inotify_add_watch(fd, input_path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            throw std::runtime_error("Cannot watch " + input_path + ": " + std::strerror(errno));
+        }
         
+        std::string output_base = getOutputBase(input_path);
         createOutputDirectories(output_base);
         
-        // Step 3: Process each file
-        std::vector<std::string> processed_files;
+        std::cout << "Discovering SEG-Y files..." << std::endl;
+        processFiles(discoverFiles(input_path), output_base, domains);
+        writeSummary(output_base, domains);
+        
+        watch_stop_requested = 0;
+        std::signal(SIGINT, requestWatchStop);
+        std::signal(SIGTERM, requestWatchStop);
+        
+        std::cout << "Watching " << input_path << " for new SEG-Y files (Ctrl+C to stop)..." << std::endl;
+        
+        auto last_summary = std::chrono::steady_clock::now();
+        bool summary_dirty = false;
+        std::vector<char> buffer(64 * 1024);
+        
+        while (!watch_stop_requested) {
+            struct pollfd pfd = {fd, POLLIN, 0};
+            int ready = poll(&pfd, 1, 200);
+            if (ready < 0 && errno != EINTR) {
+                throw std::runtime_error(std::string("poll failed: ") + std::strerror(errno));
+            }
+            
+            // Collect completed files, each scanned once per batch of events
+            std::vector<std::string> pending;
+            if (ready > 0) {
+                ssize_t length;
+                while ((length = read(fd, buffer.data(), buffer.size())) > 0) {
+                    for (char* ptr = buffer.data(); ptr < buffer.data() + length;) {
+                        auto* event = reinterpret_cast<struct inotify_event*>(ptr);
+                        ptr += sizeof(struct inotify_event) + event->len;
+                        if (event->len == 0 || (event->mask & IN_ISDIR)) continue;
+                        
+                        std::string filepath = input_path + "/" + event->name;
+                        if ((discovery_options_.any_extension || hasSegyExtension(filepath)) && validateFile(filepath) &&
+                            std::find(pending.begin(), pending.end(), filepath) == pending.end()) {
+                            pending.push_back(filepath);
+                        }
+                    }
+                }
+            }
+            
+            if (!pending.empty() && processFiles(pending, output_base, domains) > 0) {
+                summary_dirty = true;
+            }
+            
+            // Info, ranges and maps cover the whole survey: regenerate at most once per interval
+            auto now = std::chrono::steady_clock::now();
+            if (summary_dirty &&
+                std::chrono::duration_cast<std::chrono::milliseconds>(now - last_summary).count() >= debounce_ms) {
+                writeSummary(output_base, domains);
+                last_summary = now;
+                summary_dirty = false;
+            }
+        }
+        
+        if (summary_dirty) {
+            writeSummary(output_base, domains);
+        }
+        
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        std::cout << "Watch stopped, " << processed_files_.size() << " files in survey" << std::endl;
+        return 0;
+        
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+#else
+    (void)input_path;
+    (void)domains;
+    (void)debounce_ms;
+    std::cerr << "Error: Watch mode requires inotify (Linux)" << std::endl;
+    return 1;
+#endif
+}
+
+int SegyScanner::processShard(const std::string& input_path, const std::set<std::string>& domains,
+                              uint32_t shard_index, uint32_t shard_count) {
+    try {
+        ProfileScope total_scope("total");
+        
+        std::cout << "Discovering SEG-Y files..." << std::endl;
+        auto files = selectShardFiles(discoverFiles(input_path), shard_index, shard_count);
+        std::cout << "Shard " << shard_index << "/" << shard_count << ": " << files.size() << " SEG-Y files" << std::endl;
+        
+        std::string partials_dir = getOutputBase(input_path) + "/partials";
+        std::filesystem::create_directories(partials_dir);
+        
+        ScanPartial partial;
+        partial.shard_index = shard_index;
+        partial.shard_count = shard_count;
+        
         for (const auto& filepath : files) {
             std::cout << "Processing: " << filepath << std::endl;
-            
             try {
-                std::string filename = getFilenameWithoutExtension(filepath);
-                
-                // Extract trace data and get file info in one pass
-                auto result = extractTraceData(filepath);
-                
-                // Store file info for global table
-                all_file_info_[filename] = result.file_info;
-                
-                // Store traces for ranges calculation
-                all_traces_[filename] = result.traces;
-                
-                // Calculate ranges for this file
-                calculateRanges(filename, result.traces);
-                
-                // Generate domain-specific tables based on selection
-                if (domains.find("sou") != domains.end()) {
-                    generateSourceTable(output_base + "/tables", filename, result.traces);
-                }
-                if (domains.find("rec") != domains.end()) {
-                    generateReceiverTable(output_base + "/tables", filename, result.traces);
-                }
-                if (domains.find("cdp") != domains.end()) {
-                    generateCdpTable(output_base + "/tables", filename, result.traces);
-                }
-                
-                processed_files.push_back(filename);
+                ScanOptions options = makeScanOptions(domains);
+                options.keep_traces = false;
                 
+                ScanPartialFile file;
+                file.path = filepath;
+                file.has_sources = options.sources;
+                file.has_receivers = options.receivers;
+                file.has_cdps = options.cdps;
+                file.result = scanFile(filepath, options);
+                // Indexes go straight to the shared output; partials only carry aggregates
+                writeIndexes(getOutputBase(input_path), getFilenameWithoutExtension(filepath), file.result);
+                partial.files.push_back(std::move(file));
             } catch (const std::exception& e) {
                 std::cerr << "Error processing " << filepath << ": " << e.what() << std::endl;
-                continue;
             }
         }
         
-        // Step 4: Generate info and ranges tables
-        if (!processed_files.empty()) {
-            std::cout << "Generating info table..." << std::endl;
-            generateInfoTable(output_base + "/tables", processed_files);
-            
-            std::cout << "Generating ranges table..." << std::endl;
-            generateRangesTable(output_base + "/tables", processed_files);
+        std::string partial_path = partials_dir + "/" + scanPartialFileName(shard_index, shard_count);
+        writeScanPartial(partial_path, partial);
+        std::cout << "Partial result written to " << partial_path << std::endl;
+        return 0;
+        
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int SegyScanner::mergeShards(const std::string& input_path, const std::set<std::string>& domains) {
+    try {
+        ProfileScope total_scope("total");
+        
+        std::string output_base = getOutputBase(input_path);
+        std::string partials_dir = output_base + "/partials";
+        input_root_ = std::filesystem::is_directory(input_path) ?
+            input_path : std::filesystem::path(input_path).parent_path().string();
+        if (!std::filesystem::is_directory(partials_dir)) {
+            std::cerr << "No partial results found in: " << partials_dir << std::endl;
+            return 1;
         }
         
-        // Step 5: Generate maps
-        if (!processed_files.empty()) {
-            std::cout << "Generating maps..." << std::endl;
-            generateMaps(output_base + "/maps", processed_files, domains);
+        std::vector<std::string> partial_paths;
+        for (const auto& entry : std::filesystem::directory_iterator(partials_dir)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".sspart") {
+                partial_paths.push_back(entry.path().string());
+            }
+        }
+        std::sort(partial_paths.begin(), partial_paths.end());
+        
+        // Collect all files and check that every shard of one run is present exactly once
+        std::vector<ScanPartialFile> files;
+        std::set<uint32_t> shards;
+        uint32_t shard_count = 0;
+        for (const auto& path : partial_paths) {
+            ScanPartial partial = readScanPartial(path);
+            if (shard_count == 0) {
+                shard_count = partial.shard_count;
+            } else if (partial.shard_count != shard_count) {
+                throw std::runtime_error("Partial " + path + " belongs to a run with " +
+                                         std::to_string(partial.shard_count) + " shards, expected " +
+                                         std::to_string(shard_count));
+            }
+            if (!shards.insert(partial.shard_index).second) {
+                throw std::runtime_error("Duplicate partial for shard " + std::to_string(partial.shard_index));
+            }
+            for (auto& file : partial.files) {
+                files.push_back(std::move(file));
+            }
+        }
+        if (shards.empty()) {
+            std::cerr << "No partial results found in: " << partials_dir << std::endl;
+            return 1;
+        }
+        if (shards.size() != shard_count) {
+            std::cerr << "Warning: merging " << shards.size() << " of " << shard_count << " shards" << std::endl;
+        }
+        
+        // Same order as a single-node run
+        std::sort(files.begin(), files.end(), [](const ScanPartialFile& a, const ScanPartialFile& b) {
+            return a.path < b.path;
+        });
+        
+        std::cout << "Merging " << files.size() << " files from " << shards.size() << " partial results" << std::endl;
+        createOutputDirectories(output_base);
+        
+        for (auto& file : files) {
+            if ((domains.count("sou") && !file.has_sources) ||
+                (domains.count("rec") && !file.has_receivers) ||
+                (domains.count("cdp") && !file.has_cdps)) {
+                throw std::runtime_error("Partial result for " + file.path + " lacks a requested domain");
+            }
+            storeResult(getFilenameWithoutExtension(file.path), file.result, output_base, domains);
         }
         
+        writeSummary(output_base, domains);
+        
         std::cout << "Processing completed successfully!" << std::endl;
         return 0;
         
@@ -93,167 +335,376 @@ int SegyScanner::process(const std::string& input_path, const std::set<std::stri
     }
 }
 
-std::vector<std::string> SegyScanner::discoverFiles(const std::string& input_path) {
-    std::vector<std::string> files;
-    
-    if (std::filesystem::is_regular_file(input_path)) {
-        if (validateFile(input_path)) {
-            files.push_back(input_path);
+int SegyScanner::query(const std::string& input_path, const std::vector<std::string>& predicates) {
+    try {
+        auto start = std::chrono::steady_clock::now();
+        std::string index_dir = getOutputBase(input_path) + "/index";
+        if (!std::filesystem::is_directory(index_dir)) {
+            std::cerr << "No header indexes found in: " << index_dir << " (scan with --index first)" << std::endl;
+            return 1;
         }
-    } else if (std::filesystem::is_directory(input_path)) {
-        for (const auto& entry : std::filesystem::directory_iterator(input_path)) {
-            if (entry.is_regular_file()) {
-                std::string ext = entry.path().extension().string();
-                std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-                
-                if ((ext == ".sgy" || ext == ".segy") && validateFile(entry.path().string())) {
-                    files.push_back(entry.path().string());
+        
+        // <file>.<FIELD>.idx -> file -> field -> path
+        std::map<std::string, std::map<std::string, std::string>> index_files;
+        std::vector<std::string> fields;
+        for (const auto& entry : std::filesystem::directory_iterator(index_dir)) {
+            std::filesystem::path path = entry.path();
+            if (!entry.is_regular_file() || path.extension() != ".idx") continue;
+            std::string stem = path.stem().string();
+            size_t dot = stem.rfind('.');
+            if (dot == std::string::npos) continue;
+            std::string field = stem.substr(dot + 1);
+            index_files[stem.substr(0, dot)][field] = path.string();
+            if (std::find(fields.begin(), fields.end(), field) == fields.end()) fields.push_back(field);
+        }
+        
+        // Built-in fields are known without an index; custom ones only from their index files
+        std::vector<std::string> known = headerFieldNames({});
+        for (const auto& field : fields) {
+            if (std::find(known.begin(), known.end(), field) == known.end()) known.push_back(field);
+        }
+        std::vector<IndexPredicate> parsed;
+        for (const auto& text : predicates) {
+            IndexPredicate predicate = parseIndexPredicate(text);
+            predicate.field = canonicalIndexField(predicate.field, known);
+            if (std::find(fields.begin(), fields.end(), predicate.field) == fields.end()) {
+                throw std::invalid_argument("No index for field " + predicate.field + " (scan with --index " +
+                                            predicate.field + ")");
+            }
+            parsed.push_back(predicate);
+        }
+        
+        std::vector<std::string> headers = {"File", "First", "Last", "Traces"};
+        TableData rows;
+        uint64_t total = 0;
+        for (const auto& file : index_files) {
+            // Predicates are combined with AND
+            std::vector<uint32_t> traces;
+            bool first_predicate = true;
+            for (const auto& predicate : parsed) {
+                auto it = file.second.find(predicate.field);
+                if (it == file.second.end()) {
+                    std::cerr << "Warning: " << file.first << " has no " << predicate.field << " index, skipped" << std::endl;
+                    traces.clear();
+                    break;
                 }
+                std::vector<uint32_t> matches = queryHeaderIndexFile(it->second, predicate.lo, predicate.hi);
+                traces = first_predicate ? std::move(matches) : intersectTraces(traces, matches);
+                first_predicate = false;
+                if (traces.empty()) break;
+            }
+            for (const auto& range : traceRanges(traces)) {
+                addTableRow(rows, {file.first, std::to_string(range.first), std::to_string(range.first + range.count - 1),
+                                   std::to_string(range.count)});
             }
+            total += traces.size();
         }
-    } else {
-        throw std::runtime_error("Input path does not exist: " + input_path);
+        
+        if (!rows.empty()) {
+            auto widths = calculateColumnWidths(headers, rows);
+            for (size_t i = 0; i < headers.size(); ++i) {
+                if (i > 0) std::cout << " ";
+                std::cout << formatCell(headers[i], widths[i]);
+            }
+            std::cout << std::endl;
+            for (const auto& row : rows) {
+                for (size_t i = 0; i < row.size(); ++i) {
+                    if (i > 0) std::cout << " ";
+                    std::cout << formatCell(row[i], widths[i]);
+                }
+                std::cout << std::endl;
+            }
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << total << " traces in " << rows.size() << " ranges (" << std::fixed << std::setprecision(3)
+                  << elapsed << " s)" << std::endl;
+        return 0;
+        
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
     }
-    
-    return files;
 }
 
-bool SegyScanner::validateFile(const std::string& filepath) {
+void SegyScanner::extractTraces(const std::string& filepath, const FileScanResult& result) {
+    if (extract_failed_) return;
+    ProfileScope scope("extract", getFilenameWithoutExtension(filepath));
     try {
-        auto file_size = std::filesystem::file_size(filepath);
-        return file_size > 3600;
-    } catch (const std::exception&) {
-        return false;
+        const ExtractStats before = extractor_->stats();
+        std::vector<TraceRange> ranges =
+            selectTraceRanges(result.columns, headerFieldNames(header_fields_), extract_predicates_);
+        extractor_->append(filepath, ranges);
+        scope.addBytes(extractor_->stats().bytes - before.bytes);
+        scope.addTraces(extractor_->stats().traces - before.traces);
+    } catch (const std::exception& e) {
+        std::cerr << "Error extracting traces from " << filepath << ": " << e.what() << std::endl;
+        extract_failed_ = true;
     }
 }
 
-void SegyScanner::createOutputDirectories(const std::string& base_path) {
-    std::filesystem::create_directories(base_path);
-    std::filesystem::create_directories(base_path + "/tables");
-    std::filesystem::create_directories(base_path + "/maps");
+int SegyScanner::finishExtract() {
+    std::unique_ptr<SegyExtractWriter> extractor = std::move(extractor_);
+    if (extract_failed_) {
+        // The temporary file is removed with the writer
+        std::cerr << "Error: traces of some files could not be extracted, " << extractor->path()
+                  << " not written" << std::endl;
+        return 1;
+    }
+    const ExtractStats& stats = extractor->stats();
+    if (stats.traces == 0) {
+        std::cout << "No traces match the extract predicates, " << extractor->path() << " not written" << std::endl;
+        return 0;
+    }
+    extractor->commit();
+    std::cout << "Extracted " << stats.traces << " traces in " << stats.runs << (stats.runs == 1 ? " run" : " runs")
+              << " from " << stats.files << (stats.files == 1 ? " file" : " files") << " to " << extractor->path()
+              << " (" << std::fixed << std::setprecision(1) << stats.bytes / 1048576.0 << " MB, " << stats.method
+              << ")" << std::defaultfloat << std::endl;
+    return 0;
+}
+
+void SegyScanner::writeIndexes(const std::string& output_base, const std::string& filename, FileScanResult& result) {
+    if (result.indexes_skipped) {
+        std::cerr << "Warning: " << filename << " has more than 2^32 traces, header indexes skipped" << std::endl;
+    }
+    if (result.indexes.empty()) return;
+    ProfileScope scope("write_index", filename);
+    std::string index_dir = output_base + "/index";
+    std::filesystem::create_directories(index_dir);
+    for (const auto& index : result.indexes) {
+        writeHeaderIndex(index_dir + "/" + headerIndexFileName(filename, index.field), index);
+    }
+    // Only the files are needed; free the trace lists
+    std::vector<HeaderIndex>().swap(result.indexes);
+}
+
+ScanOptions SegyScanner::makeScanOptions(const std::set<std::string>& domains) const {
+    ScanOptions options;
+    options.reader = reader_options_;
+    options.fields = header_fields_;
+    options.geometry = geometry_;
+    options.geometry_options = geometry_options_;
+    options.index_fields = index_fields_;
+    options.gathers = gathers_;
+    options.fingerprints = duplicates_ != DuplicateMode::Off;
+    options.reader.hash_samples = duplicates_ == DuplicateMode::Samples;
+    options.compress_traces = true;
+    options.sources = domains.find("sou") != domains.end();
+    options.receivers = domains.find("rec") != domains.end();
+    options.cdps = domains.find("cdp") != domains.end();
+    return options;
 }
 
-SegyScanner::FileInfo SegyScanner::analyzeFile(const std::string& filepath) {
-    SegyReader reader(filepath);
+FileScanResult SegyScanner::scanFile(const std::string& filepath, ScanOptions options) {
+    std::shared_ptr<ProgressTask> task = progress_->start(getFilenameWithoutPath(filepath));
+    options.reader.progress = task.get();
+    try {
+        FileScanResult result = scanSegyFile(filepath, options);
+        progress_->finish(task);
+        return result;
+    } catch (...) {
+        progress_->finish(task, true);
+        throw;
+    }
+}
+
+size_t SegyScanner::processFiles(const std::vector<std::string>& files, const std::string& output_base,
+                                 const std::set<std::string>& domains) {
+    // Two stages: this thread scans, the writer thread stores results and writes tables.
+    // The queue holds one scanned file, so at most three files' results are in memory.
+    struct ScannedFile {
+        std::string filepath;
+        FileScanResult result;
+    };
+    BoundedQueue<ScannedFile> queue(1);
+    size_t stored = 0;
     
-    FileInfo info;
-    info.filename = getFilenameWithoutPath(filepath);
-    info.num_samples = static_cast<int>(reader.num_samples());
-    info.sample_interval_ms = static_cast<int>(reader.sample_interval() * 1000); // конвертируем в миллисекунды
-    info.num_traces = static_cast<int>(reader.num_traces());
-    info.max_time_ms = (info.num_samples - 1) * info.sample_interval_ms; // максимальное время
+    std::thread writer([&]() {
+        ScannedFile file;
+        while (queue.pop(file)) {
+            if (extractor_) {
+                extractTraces(file.filepath, file.result);
+            }
+            try {
+                storeResult(getFilenameWithoutExtension(file.filepath), file.result, output_base, domains);
+                ++stored;
+            } catch (const std::exception& e) {
+                std::cerr << "Error processing " << file.filepath << ": " << e.what() << std::endl;
+            }
+            file = ScannedFile();
+        }
+    });
+    
+    for (const auto& filepath : files) {
+        std::cout << "Processing: " << filepath << std::endl;
+        try {
+            // Extract trace data, ranges and unique positions in one pass
+            ScannedFile file{filepath, scanFile(filepath, makeScanOptions(domains))};
+            
+            if (reader_options_.direct_io && !file.result.direct_io_active) {
+                std::cerr << "Direct I/O is not supported for " << filepath << ", using buffered reads" << std::endl;
+            }
+            queue.push(std::move(file));
+            
+        } catch (const std::exception& e) {
+            std::cerr << "Error processing " << filepath << ": " << e.what() << std::endl;
+            if (extractor_) extract_failed_ = true;
+        }
+    }
     
-    return info;
+    queue.close();
+    writer.join();
+    return stored;
 }
 
-SegyScanner::TraceDataResult SegyScanner::extractTraceData(const std::string& filepath) {
-    SegyReader reader(filepath);
-    std::vector<TraceData> traces;
-    int num_traces = static_cast<int>(reader.num_traces());
-    traces.reserve(num_traces);
+void SegyScanner::storeResult(const std::string& filename, FileScanResult& result, const std::string& output_base, const std::set<std::string>& domains) {
+    // Store file info for global table
+    all_file_info_[filename] = result.file_info;
     
-    std::string filename = getFilenameWithoutPath(filepath);
+    // Store ranges for the global ranges table
+    header_ranges_[filename] = std::move(result.ranges);
+    // Partials of older versions carry no sketches: N/A in ranges_ext.txt
+    if (result.sketches.empty()) {
+        header_sketches_.erase(filename);
+    } else {
+        header_sketches_[filename] = std::move(result.sketches);
+    }
     
-    for (int i = 0; i < num_traces; ++i) {
-        TraceData trace;
-        
-        // Extract header values using the field map
-        trace.ffid = reader.get_header_value_i32(i, "FieldRecord");
-        trace.trace_number = reader.get_header_value_i32(i, "TraceNumber");
-        trace.cdp = reader.get_header_value_i32(i, "CDP");
-        trace.source = reader.get_header_value_i32(i, "EnergySourcePoint");
-        trace.sou_x = reader.get_header_value_i32(i, "SourceX");
-        trace.sou_y = reader.get_header_value_i32(i, "SourceY");
-        trace.sou_elev = reader.get_header_value_i32(i, "SourceElevation");
-        trace.rec_x = reader.get_header_value_i32(i, "ReceiverX");
-        trace.rec_y = reader.get_header_value_i32(i, "ReceiverY");
-        trace.rec_elev = reader.get_header_value_i32(i, "ReceiverElevation");
-        trace.cdp_x = reader.get_header_value_i32(i, "CDP_X");
-        trace.cdp_y = reader.get_header_value_i32(i, "CDP_Y");
-        trace.iline = reader.get_header_value_i32(i, "ILINE_3D");
-        trace.xline = reader.get_header_value_i32(i, "CROSSLINE_3D");
-        
-        traces.push_back(trace);
+    // Generate domain-specific tables based on selection; the result is consumed here, so
+    // the positions are moved into the survey aggregates once their tables are written
+    if (domains.find("sou") != domains.end()) {
+        generateSourceTable(output_base + "/tables", filename, result.sources);
+        all_sources_[filename] = std::move(result.sources);
+    }
+    if (domains.find("rec") != domains.end()) {
+        generateReceiverTable(output_base + "/tables", filename, result.receivers);
+        all_receivers_[filename] = std::move(result.receivers);
+    }
+    if (domains.find("cdp") != domains.end()) {
+        generateCdpTable(output_base + "/tables", filename, result.cdps);
+        all_cdps_[filename] = std::move(result.cdps);
+        if (result.grid.valid) {
+            generateGridTable(output_base + "/tables/" + filename + "_grid.txt", result.grid);
+        }
+    }
+    if (result.has_geometry) {
+        generateGeometryTable(output_base + "/tables/" + filename + "_geometry.txt", result.geometry);
+        all_geometry_[filename] = std::move(result.geometry);
+    }
+    if (result.has_gathers) {
+        if (result.gathers.key.empty()) {
+            std::cout << "No FFID or CDP ensembles in " << filename << ", gather table skipped" << std::endl;
+        } else {
+            generateGatherTable(output_base + "/tables/" + filename + "_gathers.txt", result.gathers);
+        }
     }
+    writeIndexes(output_base, filename, result);
     
-    // Create file info from the reader
-    FileInfo file_info;
-    file_info.filename = filename;
-    file_info.num_traces = num_traces;
-    file_info.num_samples = static_cast<int>(reader.num_samples());
-    file_info.sample_interval_ms = static_cast<int>(reader.sample_interval() * 1000);
-    file_info.max_time_ms = (file_info.num_samples - 1) * file_info.sample_interval_ms;
+    // Store traces for later analysis, compressed
+    all_traces_[filename] = std::move(result.columns);
+    if (duplicates_ != DuplicateMode::Off) {
+        all_fingerprints_[filename] = std::move(result.fingerprints);
+    }
     
-    return {traces, file_info};
+    // A rewritten file replaces its previous results
+    if (std::find(processed_files_.begin(), processed_files_.end(), filename) == processed_files_.end()) {
+        processed_files_.push_back(filename);
+    }
 }
 
-void SegyScanner::calculateRanges(const std::string& filename, const std::vector<TraceData>& traces) {
-    if (traces.empty()) return;
+void SegyScanner::writeSummary(const std::string& output_base, const std::set<std::string>& domains) {
+    if (processed_files_.empty()) return;
     
-    // Initialize ranges with first trace
-    const auto& first = traces[0];
-    header_ranges_[filename]["FFID"] = Range(first.ffid, first.ffid);
-    header_ranges_[filename]["Chan"] = Range(first.trace_number, first.trace_number);
-    header_ranges_[filename]["CDP"] = Range(first.cdp, first.cdp);
-    header_ranges_[filename]["Source"] = Range(first.source, first.source);
-    header_ranges_[filename]["Sou_X"] = Range(first.sou_x, first.sou_x);
-    header_ranges_[filename]["Sou_Y"] = Range(first.sou_y, first.sou_y);
-    header_ranges_[filename]["Sou_Elev"] = Range(first.sou_elev, first.sou_elev);
-    header_ranges_[filename]["Rec_X"] = Range(first.rec_x, first.rec_x);
-    header_ranges_[filename]["Rec_Y"] = Range(first.rec_y, first.rec_y);
-    header_ranges_[filename]["Rec_Elev"] = Range(first.rec_elev, first.rec_elev);
-    header_ranges_[filename]["CDP_X"] = Range(first.cdp_x, first.cdp_x);
-    header_ranges_[filename]["CDP_Y"] = Range(first.cdp_y, first.cdp_y);
-    header_ranges_[filename]["ILINE"] = Range(first.iline, first.iline);
-    header_ranges_[filename]["XLINE"] = Range(first.xline, first.xline);
+    // Step 5: Generate maps, rendered while the survey tables are written
+    std::cout << "Generating maps..." << std::endl;
+    auto maps = std::async(std::launch::async, [&]() {
+        ProfileScope scope("generate_maps");
+        generateMaps(output_base + "/maps", processed_files_, domains);
+    });
+    std::future<void> tiles;
+    if (tiles_) {
+        std::cout << "Generating map tiles..." << std::endl;
+        tiles = std::async(std::launch::async, [&]() {
+            ProfileScope scope("map_tiles");
+            generateTiles(output_base + "/maps/tiles", processed_files_, domains);
+        });
+    }
     
-    // Update ranges with remaining traces
-    for (size_t i = 1; i < traces.size(); ++i) {
-        const auto& trace = traces[i];
-        
-        auto& ranges = header_ranges_[filename];
-        ranges["FFID"].min_val = std::min(ranges["FFID"].min_val, trace.ffid);
-        ranges["FFID"].max_val = std::max(ranges["FFID"].max_val, trace.ffid);
-        
-        ranges["Chan"].min_val = std::min(ranges["Chan"].min_val, trace.trace_number);
-        ranges["Chan"].max_val = std::max(ranges["Chan"].max_val, trace.trace_number);
-        
-        ranges["CDP"].min_val = std::min(ranges["CDP"].min_val, trace.cdp);
-        ranges["CDP"].max_val = std::max(ranges["CDP"].max_val, trace.cdp);
-        
-        ranges["Source"].min_val = std::min(ranges["Source"].min_val, trace.source);
-        ranges["Source"].max_val = std::max(ranges["Source"].max_val, trace.source);
-        
-        ranges["Sou_X"].min_val = std::min(ranges["Sou_X"].min_val, trace.sou_x);
-        ranges["Sou_X"].max_val = std::max(ranges["Sou_X"].max_val, trace.sou_x);
-        
-        ranges["Sou_Y"].min_val = std::min(ranges["Sou_Y"].min_val, trace.sou_y);
-        ranges["Sou_Y"].max_val = std::max(ranges["Sou_Y"].max_val, trace.sou_y);
-        
-        ranges["Sou_Elev"].min_val = std::min(ranges["Sou_Elev"].min_val, trace.sou_elev);
-        ranges["Sou_Elev"].max_val = std::max(ranges["Sou_Elev"].max_val, trace.sou_elev);
-        
-        ranges["Rec_X"].min_val = std::min(ranges["Rec_X"].min_val, trace.rec_x);
-        ranges["Rec_X"].max_val = std::max(ranges["Rec_X"].max_val, trace.rec_x);
-        
-        ranges["Rec_Y"].min_val = std::min(ranges["Rec_Y"].min_val, trace.rec_y);
-        ranges["Rec_Y"].max_val = std::max(ranges["Rec_Y"].max_val, trace.rec_y);
-        
-        ranges["Rec_Elev"].min_val = std::min(ranges["Rec_Elev"].min_val, trace.rec_elev);
-        ranges["Rec_Elev"].max_val = std::max(ranges["Rec_Elev"].max_val, trace.rec_elev);
-        
-        ranges["CDP_X"].min_val = std::min(ranges["CDP_X"].min_val, trace.cdp_x);
-        ranges["CDP_X"].max_val = std::max(ranges["CDP_X"].max_val, trace.cdp_x);
-        
-        ranges["CDP_Y"].min_val = std::min(ranges["CDP_Y"].min_val, trace.cdp_y);
-        ranges["CDP_Y"].max_val = std::max(ranges["CDP_Y"].max_val, trace.cdp_y);
-        
-        ranges["ILINE"].min_val = std::min(ranges["ILINE"].min_val, trace.iline);
-        ranges["ILINE"].max_val = std::max(ranges["ILINE"].max_val, trace.iline);
-        
-        ranges["XLINE"].min_val = std::min(ranges["XLINE"].min_val, trace.xline);
-        ranges["XLINE"].max_val = std::max(ranges["XLINE"].max_val, trace.xline);
+    // Step 4: Generate info and ranges tables
+    std::cout << "Generating info table..." << std::endl;
+    {
+        ProfileScope scope("write_info");
+        generateInfoTable(output_base + "/tables", processed_files_);
+    }
+    
+    std::cout << "Generating ranges table..." << std::endl;
+    {
+        ProfileScope scope("write_ranges");
+        generateRangesTable(output_base + "/tables", processed_files_);
+    }
+    {
+        ProfileScope scope("write_ranges_ext");
+        generateRangesExtTable(output_base + "/tables", processed_files_);
+    }
+    
+    std::cout << "Generating survey tables..." << std::endl;
+    generateSurveyTables(output_base + "/tables", processed_files_, domains);
+    
+    if (!all_geometry_.empty()) {
+        GeometryStats survey;
+        for (const auto& filename : processed_files_) {
+            auto it = all_geometry_.find(filename);
+            if (it != all_geometry_.end()) survey.merge(it->second);
+        }
+        generateGeometryTable(output_base + "/tables/geometry.txt", survey);
+    }
+    
+    if (duplicates_ != DuplicateMode::Off) {
+        std::cout << "Searching for duplicate traces..." << std::endl;
+        generateDuplicateTables(output_base + "/tables", processed_files_);
     }
+    
+    maps.get();
+    if (tiles.valid()) tiles.get();
+}
+
+std::vector<std::string> SegyScanner::discoverFiles(const std::string& input_path) {
+    DiscoveryOptions options = discovery_options_;
+    // Never descend into our own output (tables, maps, partials)
+    options.skip_dirs.push_back(getOutputBase(input_path));
+    input_root_ = std::filesystem::is_directory(input_path) ?
+        input_path : std::filesystem::path(input_path).parent_path().string();
+    
+    std::vector<std::pair<std::string, std::string>> rejected;
+    auto files = discoverSegyFiles(input_path, options, &rejected);
+    for (const auto& file : rejected) {
+        std::cerr << "Skipping " << file.first << ": " << file.second << std::endl;
+    }
+    return files;
+}
+
+bool SegyScanner::validateFile(const std::string& filepath) {
+    std::string reason;
+    bool segy_extension = hasSegyExtension(filepath);
+    if (sniffSegyFile(filepath, !segy_extension, &reason)) {
+        return true;
+    }
+    if (segy_extension) {
+        std::cerr << "Skipping " << filepath << ": " << reason << std::endl;
+    }
+    return false;
+}
+
+std::string SegyScanner::getOutputBase(const std::string& input_path) {
+    return std::filesystem::is_directory(input_path) ? 
+        input_path + "/segyscan" : 
+        std::filesystem::path(input_path).parent_path().string() + "/segyscan";
+}
+
+void SegyScanner::createOutputDirectories(const std::string& base_path) {
+    std::filesystem::create_directories(base_path);
+    std::filesystem::create_directories(base_path + "/tables");
+    std::filesystem::create_directories(base_path + "/maps");
 }
 
 void SegyScanner::generateInfoTable(const std::string& output_dir, const std::vector<std::string>& processed_files) {
@@ -269,13 +720,13 @@ void SegyScanner::generateInfoTable(const std::string& output_dir, const std::ve
     std::vector<std::string> headers = {"file_name", "num_traces", "num_samples", "sample_interval_ms", "max_time_ms"};
     
     // Prepare all data rows
-    std::vector<std::vector<std::string>> data;
+    TableData data;
     for (const auto& filename : processed_files) {
         if (all_file_info_.find(filename) != all_file_info_.end()) {
             const auto& info = all_file_info_[filename];
-            data.push_back({info.filename, std::to_string(info.num_traces), 
-                           std::to_string(info.num_samples), std::to_string(info.sample_interval_ms),
-                           std::to_string(info.max_time_ms)});
+            addTableRow(data, {info.filename, std::to_string(info.num_traces), 
+                              std::to_string(info.num_samples), std::to_string(info.sample_interval_ms),
+                              std::to_string(info.max_time_ms)});
         }
     }
     
@@ -299,6 +750,18 @@ void SegyScanner::generateRangesTable(const std::string& output_dir, const std::
     
     const int MAX_FILES_PER_TABLE = 5;
     
+    // Built-in fields first, then user-defined fields found in any file (sorted by name)
+    std::vector<std::string> header_names = rangeFieldNames();
+    std::set<std::string> custom_names;
+    for (const auto& file_ranges : header_ranges_) {
+        for (const auto& range : file_ranges.second) {
+            if (std::find(rangeFieldNames().begin(), rangeFieldNames().end(), range.first) == rangeFieldNames().end()) {
+                custom_names.insert(range.first);
+            }
+        }
+    }
+    header_names.insert(header_names.end(), custom_names.begin(), custom_names.end());
+    
     // Process files in chunks of MAX_FILES_PER_TABLE
     for (size_t start = 0; start < processed_files.size(); start += MAX_FILES_PER_TABLE) {
         size_t end = std::min(start + MAX_FILES_PER_TABLE, processed_files.size());
@@ -309,10 +772,6 @@ void SegyScanner::generateRangesTable(const std::string& output_dir, const std::
             file << std::endl;
         }
         
-        // Define header names in order
-        std::vector<std::string> header_names = {"FFID", "Chan", "CDP", "Source", "Sou_X", "Sou_Y", 
-                                                "Sou_Elev", "Rec_X", "Rec_Y", "Rec_Elev", "CDP_X", "CDP_Y", "ILINE", "XLINE"};
-        
         // Prepare headers: "Header" + file names
         std::vector<std::string> headers = {"Header"};
         for (const auto& filename : current_files) {
@@ -320,9 +779,9 @@ void SegyScanner::generateRangesTable(const std::string& output_dir, const std::
         }
         
         // Prepare data rows
-        std::vector<std::vector<std::string>> data;
+        TableData data;
         for (const auto& header_name : header_names) {
-            std::vector<std::string> row = {header_name};
+            TableRow row = {header_name};
             for (const auto& filename : current_files) {
                 if (header_ranges_.find(filename) != header_ranges_.end() && 
                     header_ranges_[filename].find(header_name) != header_ranges_[filename].end()) {
@@ -343,40 +802,93 @@ void SegyScanner::generateRangesTable(const std::string& output_dir, const std::
     }
 }
 
-void SegyScanner::generateSourceTable(const std::string& output_dir, const std::string& filename, const std::vector<TraceData>& traces) {
-    std::map<std::pair<int32_t, int32_t>, std::tuple<int32_t, int32_t, int32_t>> unique_sources; // (x, y) -> (ffid, source, max_elevation)
+void SegyScanner::generateRangesExtTable(const std::string& output_dir, const std::vector<std::string>& processed_files) {
+    if (processed_files.empty()) return;
     
-    for (const auto& trace : traces) {
-        auto key = std::make_pair(trace.sou_x, trace.sou_y);
-        auto it = unique_sources.find(key);
-        
-        if (it == unique_sources.end()) {
-            // Новый источник
-            unique_sources[key] = std::make_tuple(trace.ffid, trace.source, trace.sou_elev);
-        } else {
-            // Источник уже существует - обновляем высоту до максимальной
-            auto& [ffid, source, elev] = it->second;
-            elev = std::max(elev, trace.sou_elev);
-        }
+    std::string filepath = output_dir + "/ranges_ext.txt";
+    std::ofstream file(filepath);
+    
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot create file: " + filepath);
     }
     
-    // Convert to SourceInfo set for map generation
-    std::set<SourceInfo> source_set;
-    for (const auto& source : unique_sources) {
-        SourceInfo info;
-        info.sou_x = source.first.first;
-        info.sou_y = source.first.second;
-        auto& [ffid, source_num, elev] = source.second;
-        info.ffid = ffid;
-        info.source = source_num;
-        info.sou_elev = elev;
-        source_set.insert(info);
+    // Same field order as ranges.txt
+    std::vector<std::string> header_names = rangeFieldNames();
+    std::set<std::string> custom_names;
+    for (const auto& file_sketches : header_sketches_) {
+        for (const auto& sketch : file_sketches.second) {
+            if (std::find(rangeFieldNames().begin(), rangeFieldNames().end(), sketch.first) == rangeFieldNames().end()) {
+                custom_names.insert(sketch.first);
+            }
+        }
     }
+    header_names.insert(header_names.end(), custom_names.begin(), custom_names.end());
     
-    // Store for map generation
-    all_sources_[filename] = source_set;
+    // Columns of one field; fields with more than 1024 distinct values are estimated
+    // (distinct count about 1.6% error, percentiles a fraction of a percent in rank)
+    auto statistics = [](const FieldSketch& sketch) {
+        return std::vector<std::string>{std::to_string(sketch.min()), std::to_string(sketch.percentile(0.01)),
+                                        std::to_string(sketch.percentile(0.50)), std::to_string(sketch.percentile(0.99)),
+                                        std::to_string(sketch.max()), std::to_string(sketch.distinct()),
+                                        std::to_string(sketch.count())};
+    };
+    const std::vector<std::string> columns = {"Min", "P1", "P50", "P99", "Max", "Distinct", "Traces"};
     
-    // Write table
+    // Survey-wide: the sketches of all files merged in processed order
+    SketchMap survey;
+    for (const auto& filename : processed_files) {
+        auto it = header_sketches_.find(filename);
+        if (it != header_sketches_.end()) mergeSketches(survey, it->second);
+    }
+    {
+        std::vector<std::string> headers = {"Header"};
+        headers.insert(headers.end(), columns.begin(), columns.end());
+        TableData data;
+        for (const auto& header_name : header_names) {
+            TableRow row = {header_name};
+            auto it = survey.find(header_name);
+            if (it != survey.end()) {
+                auto values = statistics(it->second);
+                row.insert(row.end(), values.begin(), values.end());
+            } else {
+                row.insert(row.end(), columns.size(), "N/A");
+            }
+            data.push_back(row);
+        }
+        auto column_widths = calculateColumnWidths(headers, data);
+        writeTableHeader(file, headers, column_widths);
+        for (const auto& row : data) {
+            writeTableRow(file, row, column_widths);
+        }
+    }
+    
+    // Per file, after an empty line
+    file << std::endl;
+    std::vector<std::string> headers = {"File", "Header"};
+    headers.insert(headers.end(), columns.begin(), columns.end());
+    ArenaTable table;
+    for (const auto& filename : processed_files) {
+        auto file_sketches = header_sketches_.find(filename);
+        for (const auto& header_name : header_names) {
+            std::vector<std::string> row = {filename, header_name};
+            if (file_sketches != header_sketches_.end() && file_sketches->second.count(header_name)) {
+                auto values = statistics(file_sketches->second.at(header_name));
+                row.insert(row.end(), values.begin(), values.end());
+            } else {
+                row.insert(row.end(), columns.size(), "N/A");
+            }
+            table.add(std::move(row));
+        }
+    }
+    auto column_widths = calculateColumnWidths(headers, table.rows());
+    writeTableHeader(file, headers, column_widths);
+    for (const auto& row : table.rows()) {
+        writeTableRow(file, row, column_widths);
+    }
+}
+
+void SegyScanner::generateSourceTable(const std::string& output_dir, const std::string& filename, const std::vector<SourceInfo>& sources) {
+    ProfileScope write_scope("write_sou", filename);
     std::string filepath = output_dir + "/" + filename + "_sou.txt";
     std::ofstream file(filepath);
     
@@ -387,276 +899,529 @@ void SegyScanner::generateSourceTable(const std::string& output_dir, const std::
     std::vector<std::string> headers = {"Number", "FFID", "Source", "Sou_X", "Sou_Y", "Sou_Elev"};
     
     // Prepare all data rows
-    std::vector<std::vector<std::string>> data;
+    ArenaTable table(sources.size());
     int number = 1;
-    for (const auto& source : unique_sources) {
-        auto& [ffid, source_num, elev] = source.second;
-        data.push_back({std::to_string(number), std::to_string(ffid), 
-                       std::to_string(source_num), std::to_string(source.first.first),
-                       std::to_string(source.first.second), std::to_string(elev)});
+    for (const auto& source : sources) {
+        table.add({std::to_string(number), std::to_string(source.ffid), 
+                  std::to_string(source.source), std::to_string(source.sou_x),
+                  std::to_string(source.sou_y), std::to_string(source.sou_elev)});
         number++;
     }
     
-    auto column_widths = calculateColumnWidths(headers, data);
+    auto column_widths = calculateColumnWidths(headers, table.rows());
     
     writeTableHeader(file, headers, column_widths);
-    for (const auto& row : data) {
+    for (const auto& row : table.rows()) {
         writeTableRow(file, row, column_widths);
     }
 }
 
-void SegyScanner::generateReceiverTable(const std::string& output_dir, const std::string& filename, const std::vector<TraceData>& traces) {
-    std::map<std::pair<int32_t, int32_t>, int32_t> unique_receivers; // (x, y) -> max_elevation
+void SegyScanner::generateReceiverTable(const std::string& output_dir, const std::string& filename, const std::vector<ReceiverInfo>& receivers) {
+    ProfileScope write_scope("write_rec", filename);
+    std::string filepath = output_dir + "/" + filename + "_rec.txt";
+    std::ofstream file(filepath);
     
-    for (const auto& trace : traces) {
-        auto key = std::make_pair(trace.rec_x, trace.rec_y);
-        auto it = unique_receivers.find(key);
-        
-        if (it == unique_receivers.end()) {
-            // Новый приемник
-            unique_receivers[key] = trace.rec_elev;
-        } else {
-            // Приемник уже существует - обновляем высоту до максимальной
-            it->second = std::max(it->second, trace.rec_elev);
-        }
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot create file: " + filepath);
     }
     
-    // Convert to ReceiverInfo set for map generation
-    std::set<ReceiverInfo> receiver_set;
-    for (const auto& receiver : unique_receivers) {
-        ReceiverInfo info;
-        info.rec_x = receiver.first.first;
-        info.rec_y = receiver.first.second;
-        info.rec_elev = receiver.second;
-        receiver_set.insert(info);
+    std::vector<std::string> headers = {"Number", "Rec_X", "Rec_Y", "Rec_Elev"};
+    
+    // Prepare all data rows
+    ArenaTable table(receivers.size());
+    int number = 1;
+    for (const auto& receiver : receivers) {
+        table.add({std::to_string(number), std::to_string(receiver.rec_x),
+                  std::to_string(receiver.rec_y), std::to_string(receiver.rec_elev)});
+        number++;
     }
     
-    // Store for map generation
-    all_receivers_[filename] = receiver_set;
+    auto column_widths = calculateColumnWidths(headers, table.rows());
     
-    // Write table
-    std::string filepath = output_dir + "/" + filename + "_rec.txt";
+    writeTableHeader(file, headers, column_widths);
+    for (const auto& row : table.rows()) {
+        writeTableRow(file, row, column_widths);
+    }
+}
+
+void SegyScanner::generateCdpTable(const std::string& output_dir, const std::string& filename, const std::vector<CdpInfo>& cdps) {
+    ProfileScope write_scope("write_cdp", filename);
+    std::string filepath = output_dir + "/" + filename + "_cdp.txt";
     std::ofstream file(filepath);
     
     if (!file.is_open()) {
         throw std::runtime_error("Cannot create file: " + filepath);
     }
     
-    std::vector<std::string> headers = {"Number", "Rec_X", "Rec_Y", "Rec_Elev"};
+    std::vector<std::string> headers = {"Number", "CDP", "CDP_X", "CDP_Y", "INLINE", "XLINE"};
     
     // Prepare all data rows
-    std::vector<std::vector<std::string>> data;
+    ArenaTable table(cdps.size());
     int number = 1;
-    for (const auto& receiver : unique_receivers) {
-        data.push_back({std::to_string(number), std::to_string(receiver.first.first),
-                       std::to_string(receiver.first.second), std::to_string(receiver.second)});
+    for (const auto& cdp : cdps) {
+        table.add({std::to_string(number), std::to_string(cdp.cdp),
+                  std::to_string(cdp.cdp_x), std::to_string(cdp.cdp_y),
+                  std::to_string(cdp.iline), std::to_string(cdp.xline)});
         number++;
     }
     
-    auto column_widths = calculateColumnWidths(headers, data);
+    auto column_widths = calculateColumnWidths(headers, table.rows());
     
     writeTableHeader(file, headers, column_widths);
-    for (const auto& row : data) {
+    for (const auto& row : table.rows()) {
         writeTableRow(file, row, column_widths);
     }
 }
 
-void SegyScanner::generateCdpTable(const std::string& output_dir, const std::string& filename, const std::vector<TraceData>& traces) {
-    std::map<std::pair<int32_t, int32_t>, std::tuple<int32_t, int32_t, int32_t>> unique_cdps; // (x, y) -> (cdp_number, iline, xline)
+namespace {
+
+// Per-file position lists in processed order; read-only, since the maps are rendered
+// from the same aggregates concurrently
+template <typename Info>
+std::vector<const std::vector<Info>*> perFilePositions(const std::vector<std::string>& processed_files,
+                                                       const std::map<std::string, std::vector<Info>>& positions) {
+    static const std::vector<Info> empty;
+    std::vector<const std::vector<Info>*> per_file;
+    for (const auto& filename : processed_files) {
+        auto it = positions.find(filename);
+        per_file.push_back(it != positions.end() ? &it->second : &empty);
+    }
+    return per_file;
+}
+
+} // namespace
+
+void SegyScanner::generateSurveyTables(const std::string& output_dir, const std::vector<std::string>& processed_files, const std::set<std::string>& domains) {
+    auto writeTable = [this](const std::string& filepath, const std::vector<std::string>& headers,
+                             const TableData& data) {
+        std::ofstream file(filepath);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot create file: " + filepath);
+        }
+        auto column_widths = calculateColumnWidths(headers, data);
+        writeTableHeader(file, headers, column_widths);
+        for (const auto& row : data) {
+            writeTableRow(file, row, column_widths);
+        }
+    };
     
-    for (const auto& trace : traces) {
-        auto key = std::make_pair(trace.cdp_x, trace.cdp_y);
-        auto it = unique_cdps.find(key);
+    if (domains.find("sou") != domains.end()) {
+        ProfileScope scope("survey_sou");
+        auto per_file = perFilePositions(processed_files, all_sources_);
+        auto merged = mergeSurveySources(per_file);
         
-        if (it == unique_cdps.end()) {
-            // Новый CDP
-            unique_cdps[key] = std::make_tuple(trace.cdp, trace.iline, trace.xline);
-        } else {
-            // CDP уже существует - сохраняем первый встреченный номер CDP
-            // (или можно выбрать минимальный/максимальный по необходимости)
+        ArenaTable table(merged.size());
+        int number = 1;
+        for (const auto& row : merged) {
+            const SourceInfo& source = row.info;
+            table.add({std::to_string(number++), std::to_string(source.ffid),
+                      std::to_string(source.source), std::to_string(source.sou_x),
+                      std::to_string(source.sou_y), std::to_string(source.sou_elev),
+                      std::to_string(row.num_files)});
         }
+        writeTable(output_dir + "/sou.txt", {"Number", "FFID", "Source", "Sou_X", "Sou_Y", "Sou_Elev", "Files"}, table.rows());
     }
     
-    // Convert to CdpInfo set for map generation
-    std::set<CdpInfo> cdp_set;
-    for (const auto& cdp : unique_cdps) {
-        CdpInfo info;
-        info.cdp_x = cdp.first.first;
-        info.cdp_y = cdp.first.second;
-        auto& [cdp_num, iline, xline] = cdp.second;
-        info.cdp = cdp_num;
-        cdp_set.insert(info);
+    if (domains.find("rec") != domains.end()) {
+        ProfileScope scope("survey_rec");
+        auto per_file = perFilePositions(processed_files, all_receivers_);
+        auto merged = mergeSurveyReceivers(per_file);
+        
+        ArenaTable table(merged.size());
+        int number = 1;
+        for (const auto& row : merged) {
+            const ReceiverInfo& receiver = row.info;
+            table.add({std::to_string(number++), std::to_string(receiver.rec_x),
+                      std::to_string(receiver.rec_y), std::to_string(receiver.rec_elev),
+                      std::to_string(row.num_files)});
+        }
+        writeTable(output_dir + "/rec.txt", {"Number", "Rec_X", "Rec_Y", "Rec_Elev", "Files"}, table.rows());
     }
     
-    // Store for map generation
-    all_cdps_[filename] = cdp_set;
-    
-    // Write table
-    std::string filepath = output_dir + "/" + filename + "_cdp.txt";
+    if (domains.find("cdp") != domains.end()) {
+        ProfileScope scope("survey_cdp");
+        auto per_file = perFilePositions(processed_files, all_cdps_);
+        auto merged = mergeSurveyCdps(per_file);
+        
+        ArenaTable table(merged.size());
+        int number = 1;
+        for (const auto& row : merged) {
+            const CdpInfo& cdp = row.info;
+            table.add({std::to_string(number++), std::to_string(cdp.cdp),
+                      std::to_string(cdp.cdp_x), std::to_string(cdp.cdp_y),
+                      std::to_string(cdp.iline), std::to_string(cdp.xline),
+                      std::to_string(row.num_files)});
+        }
+        writeTable(output_dir + "/cdp.txt", {"Number", "CDP", "CDP_X", "CDP_Y", "INLINE", "XLINE", "Files"}, table.rows());
+    }
+}
+
+void SegyScanner::generateGeometryTable(const std::string& filepath, const GeometryStats& stats) {
+    ProfileScope write_scope("write_geometry");
     std::ofstream file(filepath);
     
     if (!file.is_open()) {
         throw std::runtime_error("Cannot create file: " + filepath);
     }
     
-    std::vector<std::string> headers = {"Number", "CDP", "CDP_X", "CDP_Y", "INLINE", "XLINE"};
+    auto fixed = [](double value, int precision) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(precision) << value;
+        return out.str();
+    };
+    auto percent = [&](uint64_t count) {
+        return fixed(stats.num_traces() > 0 ? 100.0 * count / stats.num_traces() : 0.0, 2);
+    };
     
-    // Prepare all data rows
-    std::vector<std::vector<std::string>> data;
-    int number = 1;
-    for (const auto& cdp : unique_cdps) {
-        auto& [cdp_num, iline, xline] = cdp.second;
-        data.push_back({std::to_string(number), std::to_string(cdp_num),
-                       std::to_string(cdp.first.first), std::to_string(cdp.first.second),
-                       std::to_string(iline), std::to_string(xline)});
-        number++;
-    }
+    // Attribute ranges
+    std::vector<std::string> headers = {"Attribute", "Min", "Max", "Mean", "Traces"};
+    TableData data;
+    auto addAttribute = [&](const std::string& name, const AttributeStats& a) {
+        addTableRow(data, {name, fixed(a.min_val, 1), fixed(a.max_val, 1), fixed(a.mean(), 1), std::to_string(a.count)});
+    };
+    addAttribute("Offset", stats.offset);
+    addAttribute("Azimuth", stats.azimuth);
+    addAttribute("Midpoint_Err", stats.midpoint_error);
     
     auto column_widths = calculateColumnWidths(headers, data);
+    writeTableHeader(file, headers, column_widths);
+    for (const auto& row : data) {
+        writeTableRow(file, row, column_widths);
+    }
+    
+    file << std::endl;
+    // The tolerance the traces were counted with, which after --merge is the shards' one
+    file << "Midpoint tolerance: "
+         << (std::isnan(stats.midpoint_tolerance) ? std::string("unknown") : fixed(stats.midpoint_tolerance, 1))
+         << ", traces exceeding: " << stats.midpoint_exceeded << " (" << percent(stats.midpoint_exceeded) << "%)" << std::endl;
+    file << "Zero-offset traces (no azimuth): " << stats.zero_offset << std::endl;
     
+    // Offset histogram
+    file << std::endl;
+    headers = {"Offset_From", "Offset_To", "Traces", "Percent"};
+    data.clear();
+    for (size_t i = 0; i < stats.offset_histogram.size(); ++i) {
+        // The overflow bin reaches up to the largest offset
+        const double to = i < GeometryStats::kMaxOffsetBins ? (i + 1) * stats.offset_bin_width : stats.offset.max_val;
+        addTableRow(data, {fixed(i * stats.offset_bin_width, 1), fixed(to, 1),
+                           std::to_string(stats.offset_histogram[i]), percent(stats.offset_histogram[i])});
+    }
+    column_widths = calculateColumnWidths(headers, data);
+    writeTableHeader(file, headers, column_widths);
+    for (const auto& row : data) {
+        writeTableRow(file, row, column_widths);
+    }
+    
+    // Azimuth histogram (rose diagram sectors)
+    file << std::endl;
+    headers = {"Azimuth_From", "Azimuth_To", "Traces", "Percent"};
+    data.clear();
+    const double sector = stats.azimuth_histogram.empty() ? 0.0 : 360.0 / stats.azimuth_histogram.size();
+    for (size_t i = 0; i < stats.azimuth_histogram.size(); ++i) {
+        addTableRow(data, {fixed(i * sector, 1), fixed((i + 1) * sector, 1),
+                           std::to_string(stats.azimuth_histogram[i]), percent(stats.azimuth_histogram[i])});
+    }
+    column_widths = calculateColumnWidths(headers, data);
     writeTableHeader(file, headers, column_widths);
     for (const auto& row : data) {
         writeTableRow(file, row, column_widths);
     }
 }
 
-void SegyScanner::generateMaps(const std::string& output_dir, const std::vector<std::string>& processed_files, const std::set<std::string>& domains) {
-    std::vector<std::string> colors = {"b", "r", "g", "m", "c", "y", "k"};
+void SegyScanner::generateGatherTable(const std::string& filepath, const GatherSegmentation& gathers) {
+    ProfileScope write_scope("write_gathers");
+    std::ofstream file(filepath);
     
-    // Generate sources map
-    if (domains.find("sou") != domains.end()) {
-        auto f1 = figure(true);
-        f1->position(0, 0, 1200, 800);
-        hold(on);
-        
-        std::vector<std::string> legend_labels;
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot create file: " + filepath);
+    }
+    
+    // First_Trace is 0-based, as in the query output and SegyReader::getTrace
+    std::vector<std::string> headers = {"Gather", gathers.key, "First_Trace", "Traces"};
+    ArenaTable table(gathers.gathers.size());
+    int number = 1;
+    for (const auto& gather : gathers.gathers) {
+        table.add({std::to_string(number++), std::to_string(gather.key),
+                   std::to_string(gather.first_trace), std::to_string(gather.num_traces)});
+    }
+    
+    auto column_widths = calculateColumnWidths(headers, table.rows());
+    writeTableHeader(file, headers, column_widths);
+    for (const auto& row : table.rows()) {
+        writeTableRow(file, row, column_widths);
+    }
+}
+
+void SegyScanner::generateDuplicateTables(const std::string& output_dir, const std::vector<std::string>& processed_files) {
+    std::vector<std::string> names;
+    std::vector<DuplicateInput> inputs;
+    for (const auto& filename : processed_files) {
+        auto it = all_fingerprints_.find(filename);
+        if (it == all_fingerprints_.end()) continue;
+        auto columns = all_traces_.find(filename);
+        names.push_back(filename);
+        inputs.push_back({&it->second, columns != all_traces_.end() ? &columns->second : nullptr});
+    }
+    
+    std::vector<FileDuplicates> found;
+    {
+        ProfileScope scope("duplicates");
+        found = findDuplicates(inputs);
+    }
+    
+    ProfileScope write_scope("write_duplicates");
+    std::vector<std::string> headers = {"File", "Traces", "Duplicates", "Runs", "Unverified"};
+    TableData data;
+    uint64_t total = 0;
+    for (size_t f = 0; f < found.size(); ++f) {
+        const FileDuplicates& dups = found[f];
+        total += dups.duplicates;
+        addTableRow(data, {names[f], std::to_string(dups.num_traces), std::to_string(dups.duplicates),
+                           std::to_string(dups.runs.size()), std::to_string(dups.unverified)});
         
-        for (size_t i = 0; i < processed_files.size(); ++i) {
-            const auto& filename = processed_files[i];
-            const auto& sources = all_sources_[filename];
-            
-            if (sources.empty()) continue;
-            
-            std::vector<double> x, y;
-            for (const auto& source : sources) {
-                x.push_back(static_cast<double>(source.sou_x));
-                y.push_back(static_cast<double>(source.sou_y));
-            }
-            
-            auto h = scatter(x, y);
-            h->marker_size(2);
-            h->color(colors[i % colors.size()]);
-            h->marker_face(true);
-            h->display_name(filename);
-            
-            legend_labels.push_back(filename);
+        // Per-file runs; a file without duplicates has no table (a stale one is removed)
+        const std::string filepath = output_dir + "/" + names[f] + "_dups.txt";
+        if (dups.runs.empty()) {
+            std::filesystem::remove(filepath);
+            continue;
         }
-        
-        title("Source Locations");
-        xlabel("X Coordinate");
-        ylabel("Y Coordinate");
-        gca()->x_axis().tick_label_format("%.0f");
-        gca()->y_axis().tick_label_format("%.0f");
-        
-        if (!legend_labels.empty()) {
-            auto leg = legend(legend_labels);
-            leg->font_size(10);
-            leg->location(legend::general_alignment::topright);
+        std::ofstream file(filepath);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot create file: " + filepath);
+        }
+        // Traces are 0-based, as in the query output and SegyReader::getTrace
+        std::vector<std::string> run_headers = {"Run", "First_Trace", "Traces", "Original_File", "Original_First_Trace"};
+        ArenaTable runs(dups.runs.size());
+        int number = 1;
+        for (const auto& run : dups.runs) {
+            runs.add({std::to_string(number++), std::to_string(run.first_trace), std::to_string(run.num_traces),
+                      names[run.original_file], std::to_string(run.original_first_trace)});
+        }
+        auto run_widths = calculateColumnWidths(run_headers, runs.rows());
+        writeTableHeader(file, run_headers, run_widths);
+        for (const auto& row : runs.rows()) {
+            writeTableRow(file, row, run_widths);
         }
-        
-        grid(on);
-        save(output_dir + "/sources.png");
     }
     
-    // Generate receivers map
-    if (domains.find("rec") != domains.end()) {
-        auto f2 = figure(true);
-        f2->position(0, 0, 1200, 800);
-        hold(on);
-        
-        std::vector<std::string> legend_labels;
-        
-        for (size_t i = 0; i < processed_files.size(); ++i) {
-            const auto& filename = processed_files[i];
-            const auto& receivers = all_receivers_[filename];
-            
-            if (receivers.empty()) continue;
-            
-            std::vector<double> x, y;
-            for (const auto& receiver : receivers) {
-                x.push_back(static_cast<double>(receiver.rec_x));
-                y.push_back(static_cast<double>(receiver.rec_y));
-            }
-            
-            auto h = scatter(x, y);
-            h->marker_size(2);
-            h->color(colors[i % colors.size()]);
-            h->marker_face(true);
-            h->display_name(filename);
-            
-            legend_labels.push_back(filename);
+    std::string filepath = output_dir + "/dups.txt";
+    std::ofstream file(filepath);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot create file: " + filepath);
+    }
+    auto column_widths = calculateColumnWidths(headers, data);
+    writeTableHeader(file, headers, column_widths);
+    for (const auto& row : data) {
+        writeTableRow(file, row, column_widths);
+    }
+    std::cout << total << " duplicate traces found" << std::endl;
+}
+
+void SegyScanner::generateGridTable(const std::string& filepath, const BinGrid& grid) {
+    ProfileScope write_scope("write_grid");
+    std::ofstream file(filepath);
+    
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot create file: " + filepath);
+    }
+    
+    auto fixed = [](double value, int precision) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(precision) << value;
+        return out.str();
+    };
+    
+    std::vector<std::string> headers = {"Parameter", "Value"};
+    TableData data = {
+        {"Inline_Range", std::to_string(grid.il_min) + "-" + std::to_string(grid.il_max)},
+        {"Xline_Range", std::to_string(grid.xl_min) + "-" + std::to_string(grid.xl_max)},
+        {"Origin_X", fixed(grid.origin_x, 2)},
+        {"Origin_Y", fixed(grid.origin_y, 2)},
+        {"Inline_Spacing", fixed(grid.il_spacing, 3)},
+        {"Xline_Spacing", fixed(grid.xl_spacing, 3)},
+        {"Inline_Azimuth", fixed(grid.inline_azimuth, 3)},
+        {"Xline_Azimuth", fixed(grid.crossline_azimuth, 3)},
+        {"RMS_Residual", fixed(grid.rms_residual, 3)},
+        {"Max_Residual", fixed(grid.max_residual, 3)},
+        {"Regular", grid.regular ? "yes" : "no"},
+        {"Storage", grid.dense ? "dense" : "hashed"},
+        {"Traces", std::to_string(grid.num_traces)},
+        {"Cells_Total", std::to_string(grid.cells_total)},
+        {"Cells_Occupied", std::to_string(grid.cells_occupied)},
+        {"Coverage_Pct", fixed(grid.cells_total > 0 ? 100.0 * grid.cells_occupied / grid.cells_total : 0.0, 2)},
+        {"Fold_Min", std::to_string(grid.fold_min)},
+        {"Fold_Max", std::to_string(grid.fold_max)},
+        {"Fold_Mean", fixed(grid.cells_occupied > 0 ? static_cast<double>(grid.num_traces) / grid.cells_occupied : 0.0, 2)},
+    };
+    
+    auto column_widths = calculateColumnWidths(headers, data);
+    writeTableHeader(file, headers, column_widths);
+    for (const auto& row : data) {
+        writeTableRow(file, row, column_widths);
+    }
+    
+    // Fold distribution over occupied cells
+    file << std::endl;
+    headers = {"Fold", "Cells"};
+    data.clear();
+    for (size_t fold = 1; fold < grid.fold_histogram.size(); ++fold) {
+        if (grid.fold_histogram[fold] > 0) {
+            addTableRow(data, {std::to_string(fold), std::to_string(grid.fold_histogram[fold])});
         }
+    }
+    column_widths = calculateColumnWidths(headers, data);
+    writeTableHeader(file, headers, column_widths);
+    for (const auto& row : data) {
+        writeTableRow(file, row, column_widths);
+    }
+}
+
+namespace {
+
+// Scatter series of one file
+struct MapSeries {
+    std::string name;
+    size_t color;  // index of the file in the processed list
+    std::vector<double> x, y;
+};
+
+struct MapJob {
+    const char* stage;  // profiler stage name
+    std::string title;
+    std::string path;
+    std::vector<MapSeries> series;
+    figure_handle figure;
+};
+
+template <typename Info, typename Position>
+std::vector<MapSeries> collectSeries(const std::vector<std::string>& processed_files,
+                                     const std::map<std::string, std::vector<Info>>& positions, Position position) {
+    std::vector<MapSeries> series;
+    for (size_t i = 0; i < processed_files.size(); ++i) {
+        auto it = positions.find(processed_files[i]);
+        if (it == positions.end() || it->second.empty()) continue;
         
-        title("Receiver Locations");
-        xlabel("X Coordinate");
-        ylabel("Y Coordinate");
-        gca()->x_axis().tick_label_format("%.0f");
-        gca()->y_axis().tick_label_format("%.0f");
-        
-        if (!legend_labels.empty()) {
-            auto leg = legend(legend_labels);
-            leg->font_size(10);
-            leg->location(legend::general_alignment::topright);
+        MapSeries file{processed_files[i], i, {}, {}};
+        file.x.reserve(it->second.size());
+        file.y.reserve(it->second.size());
+        for (const auto& info : it->second) {
+            auto [x, y] = position(info);
+            file.x.push_back(static_cast<double>(x));
+            file.y.push_back(static_cast<double>(y));
         }
+        series.push_back(std::move(file));
+    }
+    return series;
+}
+
+void renderMap(const MapJob& job) {
+    static const std::vector<std::string> colors = {"b", "r", "g", "m", "c", "y", "k"};
+    
+    auto ax = job.figure->current_axes();
+    ax->hold(true);
+    
+    std::vector<std::string> legend_labels;
+    for (const auto& file : job.series) {
+        auto h = ax->scatter(file.x, file.y);
+        h->marker_size(2);
+        h->color(colors[file.color % colors.size()]);
+        h->marker_face(true);
+        h->display_name(file.name);
         
-        grid(on);
-        save(output_dir + "/receivers.png");
+        legend_labels.push_back(file.name);
     }
     
-    // Generate CDPs map
+    ax->title(job.title);
+    ax->xlabel("X Coordinate");
+    ax->ylabel("Y Coordinate");
+    ax->x_axis().tick_label_format("%.0f");
+    ax->y_axis().tick_label_format("%.0f");
+    
+    if (!legend_labels.empty()) {
+        auto leg = ax->legend(legend_labels);
+        leg->font_size(10);
+        leg->location(legend::general_alignment::topright);
+    }
+    
+    ax->grid(true);
+    job.figure->save(job.path);
+}
+
+} // namespace
+
+void SegyScanner::generateMaps(const std::string& output_dir, const std::vector<std::string>& processed_files, const std::set<std::string>& domains) {
+    std::vector<MapJob> jobs;
+    
+    if (domains.find("sou") != domains.end()) {
+        jobs.push_back({"map_sou", "Source Locations", output_dir + "/sources.png",
+                        collectSeries(processed_files, all_sources_,
+                                      [](const SourceInfo& s) { return std::make_pair(s.sou_x, s.sou_y); }), nullptr});
+    }
+    if (domains.find("rec") != domains.end()) {
+        jobs.push_back({"map_rec", "Receiver Locations", output_dir + "/receivers.png",
+                        collectSeries(processed_files, all_receivers_,
+                                      [](const ReceiverInfo& r) { return std::make_pair(r.rec_x, r.rec_y); }), nullptr});
+    }
     if (domains.find("cdp") != domains.end()) {
-        auto f3 = figure(true);
-        f3->position(0, 0, 1200, 800);
-        hold(on);
-        
-        std::vector<std::string> legend_labels;
-        
-        for (size_t i = 0; i < processed_files.size(); ++i) {
-            const auto& filename = processed_files[i];
-            const auto& cdps = all_cdps_[filename];
-            
-            if (cdps.empty()) continue;
-            
-            std::vector<double> x, y;
-            for (const auto& cdp : cdps) {
-                x.push_back(static_cast<double>(cdp.cdp_x));
-                y.push_back(static_cast<double>(cdp.cdp_y));
+        jobs.push_back({"map_cdp", "CDP Locations", output_dir + "/cdps.png",
+                        collectSeries(processed_files, all_cdps_,
+                                      [](const CdpInfo& c) { return std::make_pair(c.cdp_x, c.cdp_y); }), nullptr});
+    }
+    
+    // matplot++ tracks the current figure globally: figures are created here, one at a
+    // time. Drawing and saving use only the figure's own axes and gnuplot process, so the
+    // maps render concurrently.
+    for (auto& job : jobs) {
+        job.figure = figure(true);
+        job.figure->position(0, 0, 1200, 800);
+    }
+    
+    std::vector<std::exception_ptr> errors(jobs.size());
+    std::vector<std::thread> renderers;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        renderers.emplace_back([&, i]() {
+            try {
+                ProfileScope scope(jobs[i].stage);
+                renderMap(jobs[i]);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (auto& renderer : renderers) {
+        renderer.join();
+    }
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+void SegyScanner::generateTiles(const std::string& output_dir, const std::vector<std::string>& processed_files, const std::set<std::string>& domains) {
+    // One layer per domain with the positions of all files
+    std::vector<TileSource> sources;
+    auto collect = [&](const char* name, const auto& positions, auto position) {
+        TileSource source{name, {}};
+        for (const auto& filename : processed_files) {
+            auto it = positions.find(filename);
+            if (it == positions.end()) continue;
+            for (const auto& info : it->second) {
+                source.positions.push_back(position(info));
             }
-            
-            auto h = scatter(x, y);
-            h->marker_size(2);
-            h->color(colors[i % colors.size()]);
-            h->marker_face(true);
-            h->display_name(filename);
-            
-            legend_labels.push_back(filename);
-        }
-        
-        title("CDP Locations");
-        xlabel("X Coordinate");
-        ylabel("Y Coordinate");
-        gca()->x_axis().tick_label_format("%.0f");
-        gca()->y_axis().tick_label_format("%.0f");
-        
-        if (!legend_labels.empty()) {
-            auto leg = legend(legend_labels);
-            leg->font_size(10);
-            leg->location(legend::general_alignment::topright);
         }
-        
-        grid(on);
-        save(output_dir + "/cdps.png");
+        sources.push_back(std::move(source));
+    };
+    if (domains.find("sou") != domains.end()) {
+        collect("sou", all_sources_, [](const SourceInfo& s) { return Coord{s.sou_x, s.sou_y}; });
+    }
+    if (domains.find("rec") != domains.end()) {
+        collect("rec", all_receivers_, [](const ReceiverInfo& r) { return Coord{r.rec_x, r.rec_y}; });
+    }
+    if (domains.find("cdp") != domains.end()) {
+        collect("cdp", all_cdps_, [](const CdpInfo& c) { return Coord{c.cdp_x, c.cdp_y}; });
     }
+    
+    TilePyramid pyramid = buildTilePyramid(sources);
+    writeTilePyramid(output_dir, pyramid);
 }
 
 std::string SegyScanner::getFilenameWithoutPath(const std::string& filepath) {
@@ -664,7 +1429,21 @@ std::string SegyScanner::getFilenameWithoutPath(const std::string& filepath) {
 }
 
 std::string SegyScanner::getFilenameWithoutExtension(const std::string& filepath) {
-    return std::filesystem::path(filepath).stem().string();
+    std::filesystem::path path(stripCompressionExtension(filepath));
+    std::string name = path.stem().string();
+    // Files in subdirectories of a recursive scan: "line1/a.sgy" -> "line1_a",
+    // so equal names in different directories get their own tables
+    if (!input_root_.empty()) {
+        std::filesystem::path parent = path.parent_path().lexically_relative(input_root_);
+        if (!parent.empty() && parent != "." && *parent.begin() != "..") {
+            std::string prefix;
+            for (const auto& part : parent) {
+                prefix += part.string() + "_";
+            }
+            name = prefix + name;
+        }
+    }
+    return name;
 }
 
 void SegyScanner::writeTableHeader(std::ofstream& file, const std::vector<std::string>& headers, const std::vector<int>& column_widths) {
@@ -675,7 +1454,7 @@ void SegyScanner::writeTableHeader(std::ofstream& file, const std::vector<std::s
     file << std::endl;
 }
 
-void SegyScanner::writeTableRow(std::ofstream& file, const std::vector<std::string>& values, const std::vector<int>& column_widths) {
+void SegyScanner::writeTableRow(std::ofstream& file, const TableRow& values, const std::vector<int>& column_widths) {
     for (size_t i = 0; i < values.size(); ++i) {
         if (i > 0) file << " ";
         file << formatCell(values[i], column_widths[i]);
@@ -683,7 +1462,7 @@ void SegyScanner::writeTableRow(std::ofstream& file, const std::vector<std::stri
     file << std::endl;
 }
 
-std::vector<int> SegyScanner::calculateColumnWidths(const std::vector<std::string>& headers, const std::vector<std::vector<std::string>>& data) {
+std::vector<int> SegyScanner::calculateColumnWidths(const std::vector<std::string>& headers, const TableData& data) {
     std::vector<int> widths(headers.size(), 0);
     
     // Calculate width for headers
@@ -710,34 +1489,3 @@ std::string SegyScanner::formatCell(const std::string& value, int width) {
     return result;
 }
 
-void SegyScanner::print_progress_bar(const std::string& label, int current, int total, int width) {
-    if (total == 0) return;
-
-    // Скрываем курсор в начале отрисовки прогресс-бара
-    if (current == 1) {
-        std::cout << "\x1b[?25l";
-    }
-
-    // Используем double для большей точности и добавляем 0.5 для правильного математического округления
-    double progress = static_cast<double>(current) / total;
-    int bar_width = static_cast<int>(progress * width + 0.5);
-
-    std::cout << "\r" // Возврат каретки
-              << std::left << std::setw(30) << label // Устанавливаем фиксированную ширину метки и выравниваем по левому краю
-              << ": [";
-
-    for (int i = 0; i < width; ++i) {
-        std::cout << (i < bar_width ? '#' : '.');
-    }
-    std::cout << "] " 
-              << std::right << std::setw(3) << static_cast<int>(progress * 100.0) << "%" // Фиксированная ширина для процентов
-              << " (" << current << "/" << total << ")"
-              << std::flush; // Принудительный сброс буфера в консоль
-
-    // --- ИСПРАВЛЕНИЕ 3: Перевод строки только ПОСЛЕ финального вывода ---
-    if (current >= total) {
-        std::cout << std::endl;
-        // Показываем курсор обратно в конце
-        std::cout << "\x1b[?25h";
-    }
-}
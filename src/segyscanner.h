@@ -6,8 +6,17 @@
 #include <set>
 #include <map>
 #include <memory>
+#include <memory_resource>
+#include <atomic>
 #include "basetypes.h"
-#include "segyread/SegyReader.hpp"
+#include "segyscan.h"
+#include "discovery.h"
+#include "segyextract.h"
+
+// Rows of the text tables. Cells are short numbers, which std::string stores inline;
+// the rows come from the table's memory resource, a ScanArena for the large tables.
+typedef std::pmr::vector<std::string> TableRow;
+typedef std::pmr::vector<TableRow> TableData;
 
 class SegyScanner {
 public:
@@ -17,87 +26,140 @@ public:
     // Main processing function
     int process(const std::string& input_path, const std::set<std::string>& domains = {"sou", "rec", "cdp"});
     
+    // Scan the directory, then keep ingesting .sgy/.segy files as they are closed
+    // after writing or moved in. Per-file tables are written immediately; info,
+    // ranges and maps are regenerated at most every debounce_ms. Stops on SIGINT/SIGTERM.
+    int watch(const std::string& input_path, const std::set<std::string>& domains, int debounce_ms = 5000);
+    
+    // Scan a deterministic subset (every shard_count-th file of the sorted list, starting
+    // at shard_index) and write segyscan/partials/shard_<i>_of_<N>.sspart
+    int processShard(const std::string& input_path, const std::set<std::string>& domains,
+                     uint32_t shard_index, uint32_t shard_count);
+    
+    // Combine all partials under segyscan/partials into the usual tables and maps
+    int mergeShards(const std::string& input_path, const std::set<std::string>& domains);
+    
+    // Trace ranges matching FIELD=VALUE / FIELD=LO-HI predicates (AND), answered from the
+    // indexes in segyscan/index written by a scan with index fields
+    int query(const std::string& input_path, const std::vector<std::string>& predicates);
+    
+    // Options passed to every SegyReader (e.g. direct I/O)
+    void setReaderOptions(const SegyReaderOptions& options) { reader_options_ = options; }
+    // User-defined header fields and built-in field overrides
+    void setHeaderFields(const std::vector<HeaderFieldSpec>& fields) { header_fields_ = fields; }
+    // Offset/azimuth/midpoint statistics: <file>_geometry.txt and geometry.txt
+    void setGeometryOptions(const GeometryOptions& options) { geometry_ = true; geometry_options_ = options; }
+    // Persist secondary indexes of these fields to segyscan/index/<file>.<FIELD>.idx
+    void setIndexFields(const std::vector<std::string>& fields) { index_fields_ = fields; }
+    // Per-file gather index <file>_gathers.txt (FFID or CDP ensembles)
+    void setGathers(bool enabled) { gathers_ = enabled; }
+    // Level-of-detail tiles and a browser viewer of the survey positions in maps/tiles
+    void setTiles(bool enabled) { tiles_ = enabled; }
+    // Duplicate traces within and across files: dups.txt and <file>_dups.txt
+    void setDuplicateMode(DuplicateMode mode) { duplicates_ = mode; }
+    // Recursive walk and content sniffing of files without a SEG-Y extension
+    void setDiscoveryOptions(const DiscoveryOptions& options) { discovery_options_ = options; }
+    // Copy the traces matching all predicates (AND) into a new SEG-Y file during process()
+    void setExtract(const std::string& output_path, const std::vector<IndexPredicate>& predicates) {
+        extract_path_ = output_path;
+        extract_predicates_ = predicates;
+    }
+    // Header reading progress: bar on a terminal, key=value lines otherwise, or off
+    void setProgressMode(ProgressMode mode) { progress_ = std::make_unique<ProgressReporter>(mode); }
+    
 private:
+    // Microbenchmarks (bench/scansegy_bench.cpp) time the individual stages
+    friend class SegyScannerBench;
+    
     // File discovery and validation
     std::vector<std::string> discoverFiles(const std::string& input_path);
     bool validateFile(const std::string& filepath);
     
     // Directory management
     void createOutputDirectories(const std::string& base_path);
+    std::string getOutputBase(const std::string& input_path);
+    
+    // Scan options for the selected domains and the configured reader/fields/geometry
+    ScanOptions makeScanOptions(const std::set<std::string>& domains) const;
+    
+    // scanSegyFile with a progress task for the header reading
+    FileScanResult scanFile(const std::string& filepath, ScanOptions options);
+    
+    // Scan files, write their domain tables and merge them into the survey aggregates.
+    // Tables of one file are written on a writer thread while the next file is scanned.
+    // Returns the number of files stored.
+    size_t processFiles(const std::vector<std::string>& files, const std::string& output_base, const std::set<std::string>& domains);
+    
+    // Keep one file's results in the aggregates and write its domain tables
+    void storeResult(const std::string& filename, FileScanResult& result, const std::string& output_base, const std::set<std::string>& domains);
+    
+    // Append the file's traces matching the extract predicates to the extract output
+    void extractTraces(const std::string& filepath, const FileScanResult& result);
+    // Commit the extract output unless a file failed; returns the exit status
+    int finishExtract();
+    
+    // Write and release the file's header indexes
+    void writeIndexes(const std::string& output_base, const std::string& filename, FileScanResult& result);
+    
+    // Survey-wide info and ranges tables and maps from the current aggregates
+    void writeSummary(const std::string& output_base, const std::set<std::string>& domains);
     
-    // SEG-Y file analysis
-    struct FileInfo {
-        std::string filename;
-        int num_traces;
-        int num_samples;
-        int sample_interval_ms;  // в миллисекундах
-        int max_time_ms;         // максимальное время в миллисекундах
-    };
-    
-    FileInfo analyzeFile(const std::string& filepath);
-    
-    // Data extraction and processing
-    struct TraceData {
-        int32_t ffid;
-        int32_t trace_number;
-        int32_t cdp;
-        int32_t source;
-        int32_t sou_x, sou_y, sou_elev;
-        int32_t rec_x, rec_y, rec_elev;
-        int32_t cdp_x, cdp_y;
-        int32_t iline, xline;
-    };
-    
-    struct TraceDataResult {
-        std::vector<TraceData> traces;
-        FileInfo file_info;
-    };
-    
-    TraceDataResult extractTraceData(const std::string& filepath);
-    
-    // Table generation
+    // Table generation (extraction, ranges and dedupe are done by scanSegyFile in segyscan.h)
     void generateInfoTable(const std::string& output_dir, const std::vector<std::string>& processed_files);
     void generateRangesTable(const std::string& output_dir, const std::vector<std::string>& processed_files);
-    void generateSourceTable(const std::string& output_dir, const std::string& filename, const std::vector<TraceData>& traces);
-    void generateReceiverTable(const std::string& output_dir, const std::string& filename, const std::vector<TraceData>& traces);
-    void generateCdpTable(const std::string& output_dir, const std::string& filename, const std::vector<TraceData>& traces);
+    // ranges_ext.txt: percentiles and distinct counts per file and survey-wide
+    void generateRangesExtTable(const std::string& output_dir, const std::vector<std::string>& processed_files);
+    void generateSourceTable(const std::string& output_dir, const std::string& filename, const std::vector<SourceInfo>& sources);
+    void generateReceiverTable(const std::string& output_dir, const std::string& filename, const std::vector<ReceiverInfo>& receivers);
+    void generateCdpTable(const std::string& output_dir, const std::string& filename, const std::vector<CdpInfo>& cdps);
+    // Survey-wide sou.txt, rec.txt and cdp.txt merged from the per-file unique sets
+    void generateSurveyTables(const std::string& output_dir, const std::vector<std::string>& processed_files, const std::set<std::string>& domains);
+    void generateGeometryTable(const std::string& filepath, const GeometryStats& stats);
+    void generateGridTable(const std::string& filepath, const BinGrid& grid);
+    void generateGatherTable(const std::string& filepath, const GatherSegmentation& gathers);
+    // Survey-wide duplicate search over the fingerprints of all processed files
+    void generateDuplicateTables(const std::string& output_dir, const std::vector<std::string>& processed_files);
     
     // Map generation
     void generateMaps(const std::string& output_dir, const std::vector<std::string>& processed_files, const std::set<std::string>& domains);
+    void generateTiles(const std::string& output_dir, const std::vector<std::string>& processed_files, const std::set<std::string>& domains);
     
     // Utility functions
     std::string getFilenameWithoutPath(const std::string& filepath);
     std::string getFilenameWithoutExtension(const std::string& filepath);
     void writeTableHeader(std::ofstream& file, const std::vector<std::string>& headers, const std::vector<int>& column_widths);
-    void writeTableRow(std::ofstream& file, const std::vector<std::string>& values, const std::vector<int>& column_widths);
-    std::vector<int> calculateColumnWidths(const std::vector<std::string>& headers, const std::vector<std::vector<std::string>>& data);
+    void writeTableRow(std::ofstream& file, const TableRow& values, const std::vector<int>& column_widths);
+    std::vector<int> calculateColumnWidths(const std::vector<std::string>& headers, const TableData& data);
     std::string formatCell(const std::string& value, int width);
-    void calculateRanges(const std::string& filename, const std::vector<TraceData>& traces);
     
-    // Progress bar utility
-    void print_progress_bar(const std::string& label, int current, int total, int width = 50);
+    SegyReaderOptions reader_options_;
+    std::vector<HeaderFieldSpec> header_fields_;
+    bool geometry_ = false;
+    GeometryOptions geometry_options_;
+    DiscoveryOptions discovery_options_;
+    std::vector<std::string> index_fields_;
+    bool gathers_ = false;
+    bool tiles_ = false;
+    DuplicateMode duplicates_ = DuplicateMode::Off;
+    std::string input_root_;  // names of files in subdirectories are prefixed relative to it
+    std::unique_ptr<ProgressReporter> progress_;
+    std::string extract_path_;
+    std::vector<IndexPredicate> extract_predicates_;
+    std::unique_ptr<SegyExtractWriter> extractor_;  // open during process() with an extract path
+    std::atomic<bool> extract_failed_{false};  // a file's traces are missing from the output
     
     // Data storage for map generation and ranges
-    std::map<std::string, std::set<SourceInfo>> all_sources_;
-    std::map<std::string, std::set<ReceiverInfo>> all_receivers_;
-    std::map<std::string, std::set<CdpInfo>> all_cdps_;
-    std::map<std::string, std::vector<TraceData>> all_traces_;
+    std::map<std::string, std::vector<SourceInfo>> all_sources_;
+    std::map<std::string, std::vector<ReceiverInfo>> all_receivers_;
+    std::map<std::string, std::vector<CdpInfo>> all_cdps_;
+    std::map<std::string, GeometryStats> all_geometry_;
+    std::map<std::string, HeaderColumns> all_traces_;
+    std::map<std::string, TraceFingerprints> all_fingerprints_;
     std::map<std::string, FileInfo> all_file_info_;
+    std::vector<std::string> processed_files_;
     
-    // Range calculation
-    struct Range {
-        int32_t min_val, max_val;
-        Range() : min_val(0), max_val(0) {}
-        Range(int32_t min, int32_t max) : min_val(min), max_val(max) {}
-        std::string toString() const {
-            if (min_val == max_val) {
-                return std::to_string(min_val);
-            }
-            return std::to_string(min_val) + "-" + std::to_string(max_val);
-        }
-    };
-    
-    std::map<std::string, std::map<std::string, Range>> header_ranges_;
+    std::map<std::string, RangeMap> header_ranges_;
+    std::map<std::string, SketchMap> header_sketches_;
 };
 
 #endif // SEGYSCANNER_H
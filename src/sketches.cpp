@@ -0,0 +1,438 @@
+#include "sketches.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <omp.h>
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+// Values buffered before they are folded into the centroids, about 5x the compression
+const size_t kBufferSize = 1024;
+
+// Rows per column pass of sketchColumns: 4096 rows of TraceData stay in L2
+const size_t kRowBlock = 4096;
+
+// Fewer rows are not worth another thread
+const size_t kMinRowsPerThread = 65536;
+
+// splitmix64 finalizer: full avalanche of the 32-bit value into 64 bits
+uint64_t hashValue(int32_t value) {
+    uint64_t x = static_cast<uint32_t>(value) + 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// Arcsine scale function k1: k(q) = delta / (2 pi) * asin(2q - 1)
+double scale(double q) {
+    return TDigest::kCompression / (2.0 * kPi) * std::asin(2.0 * q - 1.0);
+}
+
+// Largest quantile a centroid starting at quantile q may reach: k grows by at most 1
+double quantileLimit(double q) {
+    const double k = scale(q) + 1.0;
+    if (k >= TDigest::kCompression / 4.0) return 1.0;
+    return (std::sin(k * 2.0 * kPi / TDigest::kCompression) + 1.0) / 2.0;
+}
+
+// Order-preserving integer key of a double: sign bit flipped for positives, all bits for negatives
+uint64_t sortKey(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 63) != 0 ? ~bits : bits | (uint64_t(1) << 63);
+}
+
+// LSD radix sort by mean, one pass per key byte. Comparison sorts mispredict about every
+// other branch on random values, which made the sort the bulk of the insert cost. Bytes
+// equal in all keys are skipped: the low mantissa bytes of int32 values are always zero.
+void sortByMean(std::vector<TDigest::Centroid>& values) {
+    const size_t n = values.size();
+    if (n < 2) return;
+    std::vector<uint64_t> keys(n);
+    size_t counts[8][256] = {};
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = sortKey(values[i].mean);
+        for (int b = 0; b < 8; ++b) ++counts[b][(keys[i] >> (8 * b)) & 0xFF];
+    }
+    std::vector<TDigest::Centroid> sorted_values(n);
+    std::vector<uint64_t> sorted_keys(n);
+    for (int b = 0; b < 8; ++b) {
+        size_t* count = counts[b];
+        const int shift = 8 * b;
+        if (count[keys[0] >> shift & 0xFF] == n) continue;
+        size_t offset = 0;
+        for (int d = 0; d < 256; ++d) {
+            const size_t c = count[d];
+            count[d] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            const size_t pos = count[keys[i] >> shift & 0xFF]++;
+            sorted_values[pos] = values[i];
+            sorted_keys[pos] = keys[i];
+        }
+        values.swap(sorted_values);
+        keys.swap(sorted_keys);
+    }
+}
+
+// One merging pass over the sorted centroids and the buffered values (sorted here)
+std::vector<TDigest::Centroid> mergeCentroids(std::vector<TDigest::Centroid>& buffer,
+                                              const std::vector<TDigest::Centroid>& centroids, double total_weight) {
+    sortByMean(buffer);
+    std::vector<TDigest::Centroid> all(buffer.size() + centroids.size());
+    std::merge(buffer.begin(), buffer.end(), centroids.begin(), centroids.end(), all.begin(),
+               [](const TDigest::Centroid& a, const TDigest::Centroid& b) { return a.mean < b.mean; });
+
+    std::vector<TDigest::Centroid> merged;
+    if (all.empty()) return merged;
+    merged.reserve(std::min(all.size(), static_cast<size_t>(TDigest::kCompression)));
+    TDigest::Centroid current = all[0];
+    double weight_so_far = 0.0;
+    double limit = total_weight * quantileLimit(0.0);
+    for (size_t i = 1; i < all.size(); ++i) {
+        const TDigest::Centroid& next = all[i];
+        if (weight_so_far + current.weight + next.weight <= limit) {
+            current.point = current.point && next.point && next.mean == current.mean;
+            current.weight += next.weight;
+            current.mean += (next.mean - current.mean) * next.weight / current.weight;
+        } else {
+            weight_so_far += current.weight;
+            merged.push_back(current);
+            limit = total_weight * quantileLimit(weight_so_far / total_weight);
+            current = next;
+        }
+    }
+    merged.push_back(current);
+    return merged;
+}
+
+// Column values of rows [begin, end) into sketches, one column at a time over blocks of
+// rows. Runs of equal values (shot-sorted files repeat the source fields for every
+// channel) are added once with their length as count.
+void sketchRows(const int32_t* rows, size_t begin, size_t end, size_t stride, std::vector<FieldSketch>& sketches) {
+    const size_t num_columns = sketches.size();
+    if (begin >= end) return;
+    std::vector<int32_t> run_values(num_columns);
+    std::vector<uint64_t> run_lengths(num_columns, 0);
+    for (size_t block = begin; block < end; block += kRowBlock) {
+        const size_t block_end = std::min(end, block + kRowBlock);
+        for (size_t c = 0; c < num_columns; ++c) {
+            FieldSketch& sketch = sketches[c];
+            int32_t run_value = run_values[c];
+            uint64_t run_length = run_lengths[c];
+            for (size_t r = block; r < block_end; ++r) {
+                const int32_t value = rows[r * stride + c];
+                if (run_length > 0 && value == run_value) {
+                    ++run_length;
+                    continue;
+                }
+                sketch.add(run_value, run_length);
+                run_value = value;
+                run_length = 1;
+            }
+            run_values[c] = run_value;
+            run_lengths[c] = run_length;
+        }
+    }
+    for (size_t c = 0; c < num_columns; ++c) {
+        sketches[c].add(run_values[c], run_lengths[c]);
+    }
+}
+
+} // namespace
+
+bool ValueCounts::add(int32_t value, uint64_t count) {
+    if (count == 0) return true;
+    if (values_.empty()) grow();
+    const size_t mask = values_.size() - 1;
+    size_t slot = static_cast<size_t>(hashValue(value)) & mask;
+    for (; counts_[slot] != 0; slot = (slot + 1) & mask) {
+        if (values_[slot] == value) {
+            counts_[slot] += count;
+            return true;
+        }
+    }
+    if (size_ == kMaxValues) return false;
+    // Load factor at most 1/2
+    if (2 * (size_ + 1) > values_.size()) {
+        grow();
+        return add(value, count);
+    }
+    values_[slot] = value;
+    counts_[slot] = count;
+    ++size_;
+    return true;
+}
+
+void ValueCounts::grow() {
+    std::vector<int32_t> values;
+    std::vector<uint64_t> counts;
+    values.swap(values_);
+    counts.swap(counts_);
+    const size_t capacity = std::max<size_t>(16, 2 * values.size());
+    values_.assign(capacity, 0);
+    counts_.assign(capacity, 0);
+    size_ = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (counts[i] != 0) add(values[i], counts[i]);
+    }
+}
+
+std::vector<std::pair<int32_t, uint64_t>> ValueCounts::sorted() const {
+    std::vector<std::pair<int32_t, uint64_t>> result;
+    result.reserve(size_);
+    for (size_t i = 0; i < values_.size(); ++i) {
+        if (counts_[i] != 0) result.emplace_back(values_[i], counts_[i]);
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+void ValueCounts::clear() {
+    std::vector<int32_t>().swap(values_);
+    std::vector<uint64_t>().swap(counts_);
+    size_ = 0;
+}
+
+void HyperLogLog::add(int32_t value) {
+    if (registers_.empty()) registers_.assign(kRegisters, 0);
+    const uint64_t hash = hashValue(value);
+    const size_t index = static_cast<size_t>(hash >> (64 - kPrecision));
+    const uint64_t rest = hash << kPrecision;
+    // Position of the first 1 bit after the index bits
+    const uint8_t rank = rest == 0 ? static_cast<uint8_t>(64 - kPrecision + 1)
+                                   : static_cast<uint8_t>(__builtin_clzll(rest) + 1);
+    if (rank > registers_[index]) registers_[index] = rank;
+}
+
+void HyperLogLog::merge(const HyperLogLog& other) {
+    if (other.registers_.empty()) return;
+    if (registers_.empty()) {
+        registers_ = other.registers_;
+        return;
+    }
+    for (size_t i = 0; i < kRegisters; ++i) {
+        registers_[i] = std::max(registers_[i], other.registers_[i]);
+    }
+}
+
+uint64_t HyperLogLog::estimate() const {
+    if (registers_.empty()) return 0;
+    const double m = static_cast<double>(kRegisters);
+    double sum = 0.0;
+    size_t zeros = 0;
+    for (uint8_t rank : registers_) {
+        sum += std::ldexp(1.0, -rank);
+        if (rank == 0) ++zeros;
+    }
+    double estimate = 0.7213 / (1.0 + 1.079 / m) * m * m / sum;
+    // Linear counting while registers are still empty: more accurate for small counts
+    if (estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * std::log(m / static_cast<double>(zeros));
+    }
+    return static_cast<uint64_t>(std::llround(estimate));
+}
+
+void HyperLogLog::restore(std::vector<uint8_t> registers) {
+    if (!registers.empty() && registers.size() != kRegisters) {
+        throw std::invalid_argument("HyperLogLog expects " + std::to_string(kRegisters) + " registers, got " +
+                                    std::to_string(registers.size()));
+    }
+    registers_ = std::move(registers);
+}
+
+void TDigest::add(double value, double weight) {
+    if (total_weight() == 0.0) {
+        min_ = max_ = value;
+    } else {
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+    buffer_.push_back({value, weight, true});
+    buffered_weight_ += weight;
+    if (buffer_.size() >= kBufferSize) compress();
+}
+
+void TDigest::merge(const TDigest& other) {
+    if (other.total_weight() == 0.0) return;
+    if (total_weight() == 0.0) {
+        min_ = other.min_;
+        max_ = other.max_;
+    } else {
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+    buffer_.insert(buffer_.end(), other.centroids_.begin(), other.centroids_.end());
+    buffer_.insert(buffer_.end(), other.buffer_.begin(), other.buffer_.end());
+    buffered_weight_ += other.total_weight();
+    compress();
+}
+
+void TDigest::compress() {
+    if (buffer_.empty()) return;
+    total_weight_ += buffered_weight_;
+    centroids_ = mergeCentroids(buffer_, centroids_, total_weight_);
+    buffer_.clear();
+    buffered_weight_ = 0.0;
+}
+
+std::vector<TDigest::Centroid> TDigest::centroids() const {
+    if (buffer_.empty()) return centroids_;
+    std::vector<Centroid> buffer = buffer_;
+    return mergeCentroids(buffer, centroids_, total_weight());
+}
+
+void TDigest::setCentroids(const std::vector<Centroid>& centroids, double min, double max) {
+    centroids_ = centroids;
+    std::stable_sort(centroids_.begin(), centroids_.end(), [](const Centroid& a, const Centroid& b) { return a.mean < b.mean; });
+    buffer_.clear();
+    buffered_weight_ = 0.0;
+    total_weight_ = 0.0;
+    for (const Centroid& c : centroids_) total_weight_ += c.weight;
+    min_ = min;
+    max_ = max;
+}
+
+double TDigest::quantile(double q) const {
+    const std::vector<Centroid> centroids = this->centroids();
+    if (centroids.empty()) return 0.0;
+    const double total = total_weight();
+    const double target = std::min(std::max(q, 0.0), 1.0) * total;
+
+    // Piecewise linear through (rank, value) points: the minimum at rank 0, the center of
+    // every centroid (both ends of its span for point centroids), the maximum at the end
+    double prev_rank = 0.0;
+    double prev_value = min_;
+    auto interpolate = [&](double rank, double value, double* result) {
+        if (rank > target) {
+            *result = prev_value + (target - prev_rank) / (rank - prev_rank) * (value - prev_value);
+            return true;
+        }
+        prev_rank = rank;
+        prev_value = value;
+        return false;
+    };
+    double result;
+    double cumulative = 0.0;
+    for (const Centroid& c : centroids) {
+        if (c.point) {
+            if (interpolate(cumulative, c.mean, &result)) return result;
+            if (interpolate(cumulative + c.weight, c.mean, &result)) return result;
+        } else if (interpolate(cumulative + c.weight / 2.0, c.mean, &result)) {
+            return result;
+        }
+        cumulative += c.weight;
+    }
+    if (interpolate(total, max_, &result)) return result;
+    return max_;
+}
+
+void FieldSketch::add(int32_t value, uint64_t count) {
+    if (count == 0) return;
+    if (count_ == 0) {
+        min_ = max_ = value;
+    } else {
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+    count_ += count;
+    if (exact_) {
+        if (exact_counts_.add(value, count)) return;
+        dropExactCounts();
+    }
+    distinct_.add(value);
+    percentiles_.add(value, static_cast<double>(count));
+}
+
+void FieldSketch::merge(const FieldSketch& other) {
+    if (other.count_ == 0) return;
+    if (!other.exact_) {
+        if (count_ == 0) {
+            *this = other;
+            return;
+        }
+        if (exact_) dropExactCounts();
+        count_ += other.count_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+        distinct_.merge(other.distinct_);
+        percentiles_.merge(other.percentiles_);
+        return;
+    }
+    for (const auto& entry : other.exact_counts_.sorted()) {
+        add(entry.first, entry.second);
+    }
+}
+
+uint64_t FieldSketch::distinct() const {
+    return exact_ ? exact_counts_.size() : distinct_.estimate();
+}
+
+int32_t FieldSketch::percentile(double q) const {
+    if (count_ == 0) return 0;
+    if (!exact_) return static_cast<int32_t>(std::llround(percentiles_.quantile(q)));
+    const double target = std::min(std::max(q, 0.0), 1.0) * static_cast<double>(count_);
+    uint64_t cumulative = 0;
+    for (const auto& entry : exact_counts_.sorted()) {
+        cumulative += entry.second;
+        if (static_cast<double>(cumulative) > target) return entry.first;
+    }
+    return max_;
+}
+
+void FieldSketch::restoreExact(const std::vector<std::pair<int32_t, uint64_t>>& counts) {
+    *this = FieldSketch();
+    for (const auto& entry : counts) add(entry.first, entry.second);
+}
+
+void FieldSketch::restoreApproximate(uint64_t count, int32_t min, int32_t max, HyperLogLog distinct, TDigest percentiles) {
+    exact_ = false;
+    exact_counts_.clear();
+    count_ = count;
+    min_ = min;
+    max_ = max;
+    distinct_ = std::move(distinct);
+    percentiles_ = std::move(percentiles);
+}
+
+void FieldSketch::dropExactCounts() {
+    for (const auto& entry : exact_counts_.sorted()) {
+        distinct_.add(entry.first);
+        percentiles_.add(entry.first, static_cast<double>(entry.second));
+    }
+    exact_counts_.clear();
+    exact_ = false;
+}
+
+void sketchColumns(const int32_t* rows, size_t num_rows, size_t stride, const std::vector<std::string>& names,
+                   SketchMap& sketches) {
+    const size_t num_columns = names.size();
+    if (num_rows == 0 || num_columns == 0) return;
+
+    const int num_threads = static_cast<int>(std::max<size_t>(1, std::min<size_t>(static_cast<size_t>(omp_get_max_threads()),
+                                                                                  num_rows / kMinRowsPerThread)));
+    std::vector<std::vector<FieldSketch>> partial(num_threads, std::vector<FieldSketch>(num_columns));
+    #pragma omp parallel num_threads(num_threads)
+    {
+        const size_t thread = static_cast<size_t>(omp_get_thread_num());
+        const size_t count = static_cast<size_t>(omp_get_num_threads());
+        sketchRows(rows, num_rows * thread / count, num_rows * (thread + 1) / count, stride, partial[thread]);
+    }
+    for (const auto& thread_sketches : partial) {
+        for (size_t c = 0; c < num_columns; ++c) {
+            sketches[names[c]].merge(thread_sketches[c]);
+        }
+    }
+    for (const auto& name : names) sketches[name].compress();
+}
+
+void mergeSketches(SketchMap& sketches, const SketchMap& other) {
+    for (const auto& field : other) {
+        sketches[field.first].merge(field.second);
+    }
+    for (auto& field : sketches) field.second.compress();
+}
@@ -0,0 +1,157 @@
+#ifndef SKETCHES_H
+#define SKETCHES_H
+
+// Streaming summaries of header fields that min-max ranges miss: a single zero
+// coordinate stretches Sou_X to 0-650000, while p1/p99 and the distinct count show
+// the field as it really is. A field is counted exactly while it has at most
+// ValueCounts::kMaxValues distinct values (FFID, Chan, elevations, inline numbers);
+// beyond that a HyperLogLog estimates the distinct count and a merging t-digest the
+// percentiles. Memory per field is bounded (about 30 KB at most, usually far less)
+// regardless of the number of traces, and sketches merge across threads, files and
+// shards.
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Exact value -> trace count table, open addressing, grown on demand up to kMaxValues
+class ValueCounts {
+public:
+    static const size_t kMaxValues = 1024;
+
+    // false once the table would exceed kMaxValues: the value is not added and the
+    // table has to be drained into the approximate sketches
+    bool add(int32_t value, uint64_t count);
+    size_t size() const { return size_; }
+    // (value, count) by ascending value
+    std::vector<std::pair<int32_t, uint64_t>> sorted() const;
+    void clear();
+
+private:
+    void grow();
+
+    std::vector<int32_t> values_;
+    std::vector<uint64_t> counts_;  // 0 for an empty slot
+    size_t size_ = 0;
+};
+
+// Distinct count estimate, standard error 1.04 / sqrt(2^kPrecision) (1.6%), with linear
+// counting for small counts. Registers are allocated on the first value.
+class HyperLogLog {
+public:
+    static const int kPrecision = 12;
+    static const size_t kRegisters = size_t(1) << kPrecision;
+
+    void add(int32_t value);
+    void merge(const HyperLogLog& other);
+    uint64_t estimate() const;
+
+    // Serialized form (scanpartial): empty or kRegisters ranks. restore throws
+    // std::invalid_argument on any other size.
+    const std::vector<uint8_t>& registers() const { return registers_; }
+    void restore(std::vector<uint8_t> registers);
+
+private:
+    std::vector<uint8_t> registers_;
+};
+
+// Merging t-digest (Dunning) with the arcsine scale function: centroids are small at
+// both tails, so p1 and p99 are accurate to a fraction of a percent in rank.
+// Holds at most about kCompression centroids plus an insert buffer.
+class TDigest {
+public:
+    static constexpr double kCompression = 200.0;
+
+    struct Centroid {
+        double mean;
+        double weight;
+        bool point;  // all values equal to mean (a run of one value, or a single trace)
+    };
+
+    // weight > 0; runs of equal values are added with their length as weight
+    void add(double value, double weight = 1.0);
+    void merge(const TDigest& other);
+
+    // q in [0, 1]; 0 without values. Interpolates between centroid centers, with the
+    // exact minimum and maximum at the ends. Point centroids cover their whole rank
+    // span, so one outlier next to a long run of equal values does not pull the
+    // percentiles of the run towards it.
+    double quantile(double q) const;
+
+    double total_weight() const { return total_weight_ + buffered_weight_; }
+    double min() const { return min_; }
+    double max() const { return max_; }
+
+    // Compressed centroids by ascending mean, including values still in the insert
+    // buffer. Serialized form for scanpartial.
+    std::vector<Centroid> centroids() const;
+    void setCentroids(const std::vector<Centroid>& centroids, double min, double max);
+
+    // Folds the insert buffer into the centroids. Kept results are compressed, so a
+    // digest merges the same whether it stayed in memory or went through a partial.
+    void compress();
+
+private:
+    std::vector<Centroid> centroids_;
+    std::vector<Centroid> buffer_;
+    double total_weight_ = 0.0;     // in centroids_
+    double buffered_weight_ = 0.0;  // in buffer_
+    double min_ = 0.0;
+    double max_ = 0.0;
+};
+
+// Sketches of one header field
+class FieldSketch {
+public:
+    void add(int32_t value, uint64_t count = 1);
+    void merge(const FieldSketch& other);
+    // See TDigest::compress
+    void compress() { percentiles_.compress(); }
+
+    uint64_t count() const { return count_; }
+    int32_t min() const { return min_; }
+    int32_t max() const { return max_; }
+    // Distinct count and percentiles are exact while the field has at most
+    // ValueCounts::kMaxValues distinct values
+    bool exact() const { return exact_; }
+    uint64_t distinct() const;
+    // q in [0, 1]: the value at rank q * count (0 without values); t-digest estimates
+    // are rounded to the nearest integer, as the fields are
+    int32_t percentile(double q) const;
+
+    // Serialized form (scanpartial)
+    std::vector<std::pair<int32_t, uint64_t>> exact_counts() const { return exact_counts_.sorted(); }
+    const HyperLogLog& distinct_sketch() const { return distinct_; }
+    const TDigest& percentile_sketch() const { return percentiles_; }
+    void restoreExact(const std::vector<std::pair<int32_t, uint64_t>>& counts);
+    void restoreApproximate(uint64_t count, int32_t min, int32_t max, HyperLogLog distinct, TDigest percentiles);
+
+private:
+    // Moves the exact counts into the approximate sketches
+    void dropExactCounts();
+
+    bool exact_ = true;
+    ValueCounts exact_counts_;
+    HyperLogLog distinct_;
+    TDigest percentiles_;
+    uint64_t count_ = 0;
+    int32_t min_ = 0;
+    int32_t max_ = 0;
+};
+
+// Header field name -> sketches, named as in the ranges table
+typedef std::map<std::string, FieldSketch> SketchMap;
+
+// Sketches of num_columns int32 columns of row-major rows (stride values per row,
+// columns first). Threads sketch contiguous row ranges and their sketches are merged
+// in row order, so the result depends only on the thread count.
+void sketchColumns(const int32_t* rows, size_t num_rows, size_t stride, const std::vector<std::string>& names,
+                   SketchMap& sketches);
+
+// Merges every field of other into sketches (fields missing in sketches are copied)
+void mergeSketches(SketchMap& sketches, const SketchMap& other);
+
+#endif // SKETCHES_H
@@ -0,0 +1,127 @@
+#include "surveymerge.h"
+#include <algorithm>
+#include <queue>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+// Below this many input rows per partition the splitting overhead is not worth it
+const size_t kMinPartitionSize = 1 << 16;
+
+template <typename T>
+bool sameKey(const T& a, const T& b) {
+    return !(a < b) && !(b < a);
+}
+
+// Merge of [begin[k], end[k]) of every input; equal keys are combined in file order
+template <typename T, typename Combine>
+void mergeRange(const std::vector<const T*>& begin, const std::vector<const T*>& end, Combine combine,
+                std::vector<MergedPosition<T>>& out) {
+    std::vector<const T*> cursor = begin;
+
+    // Min-heap of input indices by (key, file index)
+    auto later = [&cursor](size_t a, size_t b) {
+        if (*cursor[b] < *cursor[a]) return true;
+        if (*cursor[a] < *cursor[b]) return false;
+        return a > b;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+    for (size_t k = 0; k < cursor.size(); ++k) {
+        if (cursor[k] != end[k]) heap.push(k);
+    }
+
+    while (!heap.empty()) {
+        size_t k = heap.top();
+        heap.pop();
+        const T& item = *cursor[k];
+        if (!out.empty() && sameKey(out.back().info, item)) {
+            combine(out.back().info, item);
+            out.back().num_files++;
+        } else {
+            out.push_back({item, 1});
+        }
+        if (++cursor[k] != end[k]) heap.push(k);
+    }
+}
+
+template <typename T, typename Combine>
+std::vector<MergedPosition<T>> mergeSorted(const std::vector<const std::vector<T>*>& inputs, Combine combine) {
+    size_t total = 0;
+    for (const auto* input : inputs) total += input->size();
+    if (total == 0) return {};
+
+    size_t num_parts = 1;
+#ifdef _OPENMP
+    num_parts = std::min<size_t>(static_cast<size_t>(omp_get_max_threads()) * 4,
+                                 std::max<size_t>(1, total / kMinPartitionSize));
+#endif
+
+    // Splitters: evenly spaced samples of every input, sorted and evenly picked
+    std::vector<T> splitters;
+    if (num_parts > 1) {
+        std::vector<T> samples;
+        const size_t per_input = num_parts * 8;
+        for (const auto* input : inputs) {
+            size_t step = std::max<size_t>(1, input->size() / per_input);
+            for (size_t i = step / 2; i < input->size(); i += step) {
+                samples.push_back((*input)[i]);
+            }
+        }
+        std::sort(samples.begin(), samples.end());
+        for (size_t p = 1; p < num_parts; ++p) {
+            const T& s = samples[p * samples.size() / num_parts];
+            if (splitters.empty() || splitters.back() < s) splitters.push_back(s);
+        }
+        num_parts = splitters.size() + 1;
+    }
+
+    // bounds[p][k]: start of partition p in input k; equal keys never straddle a boundary
+    std::vector<std::vector<const T*>> bounds(num_parts + 1, std::vector<const T*>(inputs.size()));
+    for (size_t k = 0; k < inputs.size(); ++k) {
+        const T* first = inputs[k]->data();
+        const T* last = first + inputs[k]->size();
+        bounds[0][k] = first;
+        bounds[num_parts][k] = last;
+        for (size_t p = 1; p < num_parts; ++p) {
+            bounds[p][k] = std::lower_bound(bounds[p - 1][k], last, splitters[p - 1]);
+        }
+    }
+
+    std::vector<std::vector<MergedPosition<T>>> parts(num_parts);
+    #pragma omp parallel for schedule(dynamic, 1) if (num_parts > 1)
+    for (long p = 0; p < static_cast<long>(num_parts); ++p) {
+        mergeRange(bounds[p], bounds[p + 1], combine, parts[p]);
+    }
+
+    if (num_parts == 1) return std::move(parts[0]);
+
+    size_t merged_size = 0;
+    for (const auto& part : parts) merged_size += part.size();
+    std::vector<MergedPosition<T>> merged;
+    merged.reserve(merged_size);
+    for (auto& part : parts) {
+        merged.insert(merged.end(), part.begin(), part.end());
+        std::vector<MergedPosition<T>>().swap(part);
+    }
+    return merged;
+}
+
+} // namespace
+
+std::vector<MergedPosition<SourceInfo>> mergeSurveySources(const std::vector<const std::vector<SourceInfo>*>& per_file) {
+    return mergeSorted(per_file, [](SourceInfo& acc, const SourceInfo& next) {
+        acc.sou_elev = std::max(acc.sou_elev, next.sou_elev);
+    });
+}
+
+std::vector<MergedPosition<ReceiverInfo>> mergeSurveyReceivers(const std::vector<const std::vector<ReceiverInfo>*>& per_file) {
+    return mergeSorted(per_file, [](ReceiverInfo& acc, const ReceiverInfo& next) {
+        acc.rec_elev = std::max(acc.rec_elev, next.rec_elev);
+    });
+}
+
+std::vector<MergedPosition<CdpInfo>> mergeSurveyCdps(const std::vector<const std::vector<CdpInfo>*>& per_file) {
+    return mergeSorted(per_file, [](CdpInfo&, const CdpInfo&) {});
+}
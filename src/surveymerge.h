@@ -0,0 +1,28 @@
+#ifndef SURVEYMERGE_H
+#define SURVEYMERGE_H
+
+// Survey-wide unique positions from the per-file unique sets.
+// Every per-file set is already unique and sorted by (X, Y), so the survey set is
+// a k-way merge of them: memory is bounded by the union, not by the sum of files.
+// The key space is split into ranges by splitters sampled from the inputs and
+// the ranges are merged in parallel (OpenMP).
+
+#include <cstdint>
+#include <vector>
+#include "basetypes.h"
+
+template <typename T>
+struct MergedPosition {
+    T info;
+    uint32_t num_files;  // number of files containing this position
+};
+
+// Inputs are given in file order; "first" values come from the earliest file.
+// Sources: first FFID/source number, maximum elevation
+std::vector<MergedPosition<SourceInfo>> mergeSurveySources(const std::vector<const std::vector<SourceInfo>*>& per_file);
+// Receivers: maximum elevation
+std::vector<MergedPosition<ReceiverInfo>> mergeSurveyReceivers(const std::vector<const std::vector<ReceiverInfo>*>& per_file);
+// CDPs: first CDP number and inline/crossline
+std::vector<MergedPosition<CdpInfo>> mergeSurveyCdps(const std::vector<const std::vector<CdpInfo>*>& per_file);
+
+#endif // SURVEYMERGE_H